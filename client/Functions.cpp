@@ -26,7 +26,14 @@
 #include "project/Project.h"
 #include "package/PackageSource.h"
 #include "package/PackageGroup.h"
+#include "package/PackageStore.h"
+#include "package/BuildCache.h"
+#include "package/BuildTrees.h"
+#include "package/InstallScheduler.h"
+#include "package/steps/CMakeInstallationSteps.h"
+#include "package/DependencyResolver.h"
 #include "task/Network.h"
+#include "task/DownloadManager.h"
 #include "git/GitRepo.h"
 #include "TermUtil.h"
 #include "FileSystem.h"
@@ -55,6 +62,7 @@ PackageSource *sourceFromUrl(const QString &url)
 
 	GitRepoPackageSource *src = new GitRepoPackageSource;
 	src->setUrl(parsed);
+	src->setBare(true);
 	return src;
 }
 Term::Color lastUpdatedColor(const PackageSource *source)
@@ -69,14 +77,23 @@ Term::Color lastUpdatedColor(const PackageSource *source)
 	}
 }
 
-const Package *queryPackage(const PackageDatabase *db, const QString &query)
+QPair<QString, VersionRequirement> parseQuery(const QString &query)
 {
 	const int splitIndex = query.indexOf('@');
 	const QString name = query.mid(0, splitIndex);
 	const VersionRequirement version = splitIndex == -1 ? VersionRequirement() : VersionRequirement::fromString(query.mid(splitIndex + 1));
+	return qMakePair(name, version);
+}
 
+const Package *queryPackage(const PackageDatabase *db, const QString &query)
+{
+	const QPair<QString, VersionRequirement> parsed = parseQuery(query);
+	const QString name = parsed.first;
+	const VersionRequirement version = parsed.second;
+
+	// newest first
 	QVector<const Package *> candidates = db->findPackages(name, version);
-	std::sort(candidates.begin(), candidates.end(), [](const Package *a, const Package *b) { return a->version() < b->version(); });
+	std::sort(candidates.begin(), candidates.end(), [](const Package *a, const Package *b) { return b->version() < a->version(); });
 
 	if (candidates.isEmpty()) {
 		const bool haveOtherVersions = !db->findPackages(name).isEmpty();
@@ -94,6 +111,12 @@ const Package *queryPackage(const PackageDatabase *db, const QString &query)
 State::State()
 {
 	Network::init();
+	Network::DownloadManager::instance()->setCache(std::make_shared<Network::DownloadCache>(
+			QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).absoluteFilePath("downloads")));
+	PackageStore::setInstance(std::make_shared<PackageStore>(
+			QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).absoluteFilePath("store")));
+	BuildCache::setInstance(std::make_shared<BuildCache>(
+			QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).absoluteFilePath("builds")));
 	Git::GitRepo::setCredentialsCallback([](const Git::GitCredentialQuery &query) -> Git::GitCredentialResponse
 	{
 		if (query.allowedTypes() & Git::GitCredentialQuery::UsernamePassword) {
@@ -127,10 +150,29 @@ void State::installPackage(const CommandLine::Result &result)
 	const QString group = result.value("group");
 
 	const PackageConfiguration config = PackageConfiguration::fromItems(result.values("config"));
+	BuildTrees::setEnabled(result.value<bool>("keep-builds"));
+	CMakeBuildStep::setJobs(result.value<unsigned int>("build-jobs"));
+	CMakeConfigStep::setGenerator(result.value("generator") == "ninja" ? CMakeConfigStep::Generator::Ninja : CMakeConfigStep::Generator::Default);
+	Network::DownloadManager::instance()->setSegments(result.value<int>("download-segments"));
+	if (!result.value("remote-build-cache").isEmpty()) {
+		BuildCache::setInstance(std::make_shared<BuildCache>(BuildCache::instance()->dir(), result.value("remote-build-cache")));
+	}
 
+	DependencyResolver resolver(db, config);
 	Functional::collection(result.argumentMulti("packages"))
-			.map([db](const QString &query) { return queryPackage(db, query); })
-			.each([db, group, config](const Package *pkg) { awaitTerminal(db->group(group).install(pkg, config)); });
+			.map([](const QString &query) { return parseQuery(query); })
+			.each([&resolver](const QPair<QString, VersionRequirement> &query) { resolver.require(query.first, query.second); });
+	const QVector<const Package *> packages = resolver.resolve();
+
+	InstallScheduler scheduler(db, db->group(group), config);
+	scheduler.pin(packages);
+	Functional::each(packages, [&scheduler](const Package *pkg) { scheduler.add(pkg); });
+	awaitTerminal(scheduler.install(result.value<unsigned int>("jobs")));
+
+	const BuildCache::Statistics stats = BuildCache::instance()->statistics();
+	if (stats.hits + stats.remoteHits + stats.misses > 0) {
+		std::cout << QString("Build cache: %1 hits, %2 remote hits, %3 misses\n") % stats.hits % stats.remoteHits % stats.misses;
+	}
 }
 void State::checkPackage(const CommandLine::Result &result)
 {
@@ -141,6 +183,16 @@ void State::checkPackage(const CommandLine::Result &result)
 			.map([db](const QString &query) { return queryPackage(db, query); })
 			.each([db, group](const Package *pkg) { if (!db->group(group).isInstalled(pkg)) { throw Exception("%1 is not installed" % pkg->name()); } });
 }
+void State::prunePackages(const CommandLine::Result &result)
+{
+	PackageDatabase *db = awaitTerminal(createDB());
+	const QDateTime unusedSince = QDateTime::currentDateTimeUtc().addDays(-qint64(result.value<unsigned int>("max-age")));
+	BuildTrees trees(db->cacheDir().absoluteFilePath("builds"));
+	const int builds = trees.prune(unusedSince);
+	const int cached = BuildCache::instance()->prune(unusedSince);
+	const int entries = PackageStore::instance()->prune();
+	std::cout << QString("Removed %1 build directories, %2 cached builds and %3 unused packages from the store\n") % builds % cached % entries;
+}
 void State::searchPackages(const CommandLine::Result &result)
 {
 	const QRegExp query{result.argument("query"), Qt::CaseInsensitive, QRegExp::WildcardUnix};
@@ -183,8 +235,6 @@ void State::updateProject(const CommandLine::Result &result)
 
 void State::updateSources(const CommandLine::Result &result)
 {
-	using namespace Term;
-
 	PackageDatabase *db = awaitTerminal(createDatabase(result.value("database")));
 	if (!db) {
 		throw Exception("Database does not exists and unable to create it");
@@ -194,10 +244,7 @@ void State::updateSources(const CommandLine::Result &result)
 				Functional::map(result.argumentMulti("names"), [db](const QString &name) { return db->source(name); })
 			  : db->sources();
 
-	for (PackageSource *source : sources) {
-		std::cout << "Updating " << source->typeString() << " source " << fg(Cyan, source->name()) << "...\n";
-		awaitTerminal(source->update());
-	}
+	awaitTerminal(db->updateSources(sources));
 }
 void State::addSource(const CommandLine::Result &result)
 {
@@ -41,6 +41,7 @@ public:
 	void installPackage(const Common::CommandLine::Result &result);
 	void checkPackage(const Common::CommandLine::Result &result);
 	void searchPackages(const Common::CommandLine::Result &result);
+	void prunePackages(const Common::CommandLine::Result &result);
 
 	void verifyProject();
 	void newProject(const Common::CommandLine::Result &result);
@@ -55,6 +55,23 @@ int main(int argc, char **argv) {
 					  .add(Option({"config", "c"}, "KEY:VALUE")
 						   .setDescription("Sets an option to be used during installation")
 						   .setArgumentRequired(true).setAllowMultiple(true))
+					  .add(Option({"jobs", "j"}, "N")
+						   .setDescription("How many packages to install at the same time (default: one per core)")
+						   .setArgumentRequired(true).setDefaultValue("0"))
+					  .add(Option("build-jobs", "N")
+						   .setDescription("How many jobs all package builds together may run at the same time (default: one per core)")
+						   .setArgumentRequired(true).setDefaultValue("0"))
+					  .add(Option("generator", "GENERATOR")
+						   .setDescription("Which CMake generator to build packages with, ninja is only used if it is installed")
+						   .setArgumentRequired(true).setDefaultValue("default").setAllowedValues({"default", "ninja"}))
+					  .add(Option("keep-builds")
+						   .setDescription("Keep the build directories of source packages, so that upgrades only rebuild what changed"))
+					  .add(Option("download-segments", "N")
+						   .setDescription("Download large files in N parts at the same time, if the server supports it")
+						   .setArgumentRequired(true).setDefaultValue("1"))
+					  .add(Option("remote-build-cache", "DIR")
+						   .setDescription("Additional directory to look for builds in and store builds to, for example on a network share")
+						   .setArgumentRequired(true).setDefaultValue(QString()))
 					  .then(state, &State::installPackage))
 				 .add(Command("remove", "Remove the specified packages")
 					  .add(PositionalArgument("packages", "The packages to remove").setMulti(true))
@@ -68,6 +85,11 @@ int main(int argc, char **argv) {
 						   .setDescription("Which package group to check in")
 						   .setArgumentRequired(true).setDefaultValue(QString()))
 					  .then(state, &State::checkPackage))
+				 .add(Command("prune", "Removes kept build directories, cached builds and packages in the package store that are no longer used")
+					  .add(Option("max-age", "DAYS")
+						   .setDescription("Build directories and cached builds that have not been used for this many days are removed, 0 removes all")
+						   .setArgumentRequired(true).setDefaultValue("30"))
+					  .then(state, &State::prunePackages))
 				 .add(Command("search", "Searches for a package")
 					  .add(PositionalArgument("query", "Filter packages by this query."))
 					  .then(state, &State::searchPackages)))
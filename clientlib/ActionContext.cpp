@@ -30,6 +30,11 @@ ConfigurationContextItem::ConfigurationContextItem(const PackageConfiguration &c
 
 ConfigurationContextItem::~ConfigurationContextItem() {}
 
+CacheContextItem::CacheContextItem(const QDir &dir)
+	: dir(dir) {}
+
+CacheContextItem::~CacheContextItem() {}
+
 }
 }
 
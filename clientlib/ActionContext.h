@@ -40,6 +40,8 @@ class ActionContext
 public:
 	template <typename T>
 	const T &get() const { return *std::dynamic_pointer_cast<T>(m_items.at(key<T>())); }
+	template <typename T>
+	bool has() const { return m_items.find(key<T>()) != m_items.end(); }
 
 	template <typename T>
 	void insert(const T &t) { m_items[key<T>()] = std::make_shared<T>(t); }
@@ -67,5 +69,15 @@ public:
 	const PackageConfiguration config;
 };
 
+/// Location for caches that are shared between installations, for example mirrors of git repositories
+class CacheContextItem : public BaseContextItem
+{
+public:
+	explicit CacheContextItem(const QDir &dir);
+	virtual ~CacheContextItem();
+
+	QDir dir;
+};
+
 }
 }
@@ -15,6 +15,8 @@
 
 #include "Requirement.h"
 
+#include <QDataStream>
+
 #include "Json.h"
 #include "Functional.h"
 #include "ActionContext.h"
@@ -38,7 +40,7 @@ QVector<Requirement::Ptr> Requirement::fromJson(const QJsonArray &array)
 		} else if (type == "and") {
 			return std::make_shared<AndRequirement>(fromJson(ensureArray(obj, "and")));
 		} else if (type == "or") {
-			return std::make_shared<OrRequirement>(fromJson(ensureArray(obj, "and")));
+			return std::make_shared<OrRequirement>(fromJson(ensureArray(obj, "or")));
 		} else {
 			throw Exception("Unknown requirement type: %1" % type);
 		}
@@ -92,7 +94,7 @@ OsRequirement::Os OsRequirement::fromString(const QString &str)
 
 QJsonObject AndRequirement::toJson() const
 {
-	return QJsonObject({qMakePair(QStringLiteral("os"), Requirement::toJson(m_children))});
+	return QJsonObject({qMakePair(QStringLiteral("and"), Requirement::toJson(m_children))});
 }
 bool AndRequirement::isSatisfied(const ActionContext &ctxt) const
 {
@@ -103,7 +105,7 @@ bool AndRequirement::isSatisfied(const ActionContext &ctxt) const
 
 QJsonObject OrRequirement::toJson() const
 {
-	return QJsonObject({qMakePair(QStringLiteral("os"), Requirement::toJson(m_children))});
+	return QJsonObject({qMakePair(QStringLiteral("or"), Requirement::toJson(m_children))});
 }
 bool OrRequirement::isSatisfied(const ActionContext &ctxt) const
 {
@@ -117,7 +119,10 @@ BuildTypeRequirement::BuildTypeRequirement(const QString &configuration)
 
 QJsonObject BuildTypeRequirement::toJson() const
 {
-	return QJsonObject({qMakePair(QStringLiteral("os"), m_configuration)});
+	return QJsonObject({
+						   qMakePair(QStringLiteral("type"), QJsonValue(QStringLiteral("buildType"))),
+						   qMakePair(QStringLiteral("config"), QJsonValue(m_configuration))
+					   });
 }
 
 bool BuildTypeRequirement::isSatisfied(const ActionContext &ctxt) const
@@ -132,5 +137,20 @@ bool BuildTypeRequirement::isSatisfied(const ActionContext &ctxt) const
 	}
 }
 
+// requirements are polymorphic, so we go through their (binary) JSON representation
+QDataStream &operator<<(QDataStream &str, const RequirementPtr &requirement)
+{
+	const QVector<Requirement::Ptr> requirements = requirement ? QVector<Requirement::Ptr>({requirement}) : QVector<Requirement::Ptr>();
+	return str << Json::toBinary(Requirement::toJson(requirements));
+}
+QDataStream &operator>>(QDataStream &str, RequirementPtr &requirement)
+{
+	QByteArray data;
+	str >> data;
+	const QVector<Requirement::Ptr> requirements = Requirement::fromJson(Json::ensureArray(QJsonDocument::fromBinaryData(data)));
+	requirement = requirements.isEmpty() ? nullptr : requirements.first();
+	return str;
+}
+
 }
 }
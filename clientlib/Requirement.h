@@ -20,6 +20,7 @@
 #include <memory>
 
 QT_BEGIN_NAMESPACE
+class QDataStream;
 class QJsonArray;
 class QJsonObject;
 class QJsonValue;
@@ -29,6 +30,8 @@ namespace Ralph {
 namespace ClientLib {
 class ActionContext;
 
+using RequirementPtr = std::shared_ptr<class Requirement>;
+
 class Requirement
 {
 public:
@@ -107,5 +110,8 @@ private:
 	QString m_configuration;
 };
 
+QDataStream &operator<<(QDataStream &str, const RequirementPtr &requirement);
+QDataStream &operator>>(QDataStream &str, RequirementPtr &requirement);
+
 }
 }
@@ -15,11 +15,13 @@
 
 #include "Version.h"
 
-#include "Functional.h"
+#include <QDataStream>
+#include <QtEndian>
+#include <algorithm>
+
 #include "Exception.h"
 
 namespace Ralph {
-using namespace Common;
 namespace ClientLib {
 
 VersionRequirement::VersionRequirement() {}
@@ -109,13 +111,17 @@ QString Version::toString() const
 	if (!m_typeString.isEmpty()) {
 		result = m_typeString + '@';
 	}
-	return Functional::collection(m_sections)
-			.map([](const QVector<Section> &sections)
-	{
-		return Functional::collection(sections)
-				.map([](const Section &section) { return section.first.isNull() ? QString::number(section.second) : section.first; })
-				.join('.');
-	}).join('-');
+	for (const Segment &segment : m_segments) {
+		if (segment.offset < 0) {
+			result += QString::number(segment.integer);
+		} else {
+			result += m_strings.midRef(segment.offset, segment.length);
+		}
+		if (&segment != &m_segments.last()) {
+			result += segment.lastInSection ? '-' : '.';
+		}
+	}
+	return result;
 }
 
 Version Version::fromString(const QString &string)
@@ -127,21 +133,127 @@ Version Version::fromString(const QString &string)
 		result.m_type = typeFromString(result.m_typeString);
 	}
 
-	result.m_sections = Functional::map(string.mid(string.indexOf('@')+1).split('-').toVector(), [](const QString &section)
-	{
-		return Functional::map(section.split('.').toVector(), [](const QString &subsection)
-		{
+	for (const QString &section : string.mid(string.indexOf('@')+1).split('-')) {
+		for (const QString &subsection : section.split('.')) {
 			bool ok = false;
 			const int integer = subsection.toInt(&ok);
-			return ok ? qMakePair(QString(), integer) : qMakePair(subsection, 0);
-		});
-	});
+			if (ok) {
+				result.m_segments.append(Segment{integer, -1, 0, false});
+			} else {
+				result.m_segments.append(Segment{0, result.m_strings.size(), subsection.size(), false});
+				result.m_strings += subsection;
+			}
+		}
+		result.m_segments.last().lastInSection = true;
+	}
+	result.m_segments.squeeze();
+
+	// missing segments count as 0, so only the first section can contribute
+	result.m_hasKey = true;
+	for (int i = 0; i < 4; ++i) {
+		const bool present = i < result.m_segments.size() && (i == 0 || !result.m_segments.at(i - 1).lastInSection);
+		if (!present) {
+			break;
+		}
+		const Segment &segment = result.m_segments.at(i);
+		if (segment.offset >= 0 || segment.integer < 0 || segment.integer > 0xffff) {
+			result.m_hasKey = false;
+			break;
+		}
+		result.m_key |= quint64(segment.integer) << (48 - 16 * i);
+	}
 
 	result.m_isValid = true;
 
 	return result;
 }
 
+// all integers are little endian quint32: flags, type, key (high and low half), type string, strings,
+// segment count and then integer, offset, length and last in section for each segment
+QByteArray Version::toPacked() const
+{
+	QByteArray out;
+	const auto append = [&out](const quint32 value)
+	{
+		uchar buffer[4];
+		qToLittleEndian(value, buffer);
+		out.append(reinterpret_cast<const char *>(buffer), 4);
+	};
+	const auto appendString = [&out, &append](const QString &string)
+	{
+		const QByteArray utf8 = string.toUtf8();
+		append(quint32(utf8.size()));
+		out.append(utf8);
+	};
+
+	append(quint32(m_isValid) | (quint32(m_hasKey) << 1));
+	append(quint32(m_type));
+	append(quint32(m_key >> 32));
+	append(quint32(m_key));
+	appendString(m_typeString);
+	appendString(m_strings);
+	append(quint32(m_segments.size()));
+	for (const Segment &segment : m_segments) {
+		append(quint32(segment.integer));
+		append(quint32(segment.offset));
+		append(quint32(segment.length));
+		append(quint32(segment.lastInSection));
+	}
+	return out;
+}
+Version Version::fromPacked(const QByteArray &data)
+{
+	const uchar *begin = reinterpret_cast<const uchar *>(data.constData());
+	const uchar *it = begin;
+	const uchar *end = begin + data.size();
+	const auto read = [&it, end]()
+	{
+		if (end - it < 4) {
+			throw Exception("Invalid packed version");
+		}
+		const quint32 value = qFromLittleEndian<quint32>(it);
+		it += 4;
+		return value;
+	};
+	const auto readString = [&it, end, &read]()
+	{
+		const quint32 size = read();
+		if (quint64(end - it) < size) {
+			throw Exception("Invalid packed version");
+		}
+		const QString string = QString::fromUtf8(reinterpret_cast<const char *>(it), int(size));
+		it += size;
+		return string;
+	};
+
+	Version result;
+	const quint32 flags = read();
+	result.m_isValid = flags & 1;
+	result.m_hasKey = flags & 2;
+	result.m_type = Type(read());
+	result.m_key = quint64(read()) << 32;
+	result.m_key |= read();
+	result.m_typeString = readString();
+	result.m_strings = readString();
+	const quint32 count = read();
+	if (quint64(end - it) < quint64(count) * 16) {
+		throw Exception("Invalid packed version");
+	}
+	result.m_segments.reserve(int(count));
+	for (quint32 i = 0; i < count; ++i) {
+		Segment segment;
+		segment.integer = int(read());
+		segment.offset = int(read());
+		segment.length = int(read());
+		segment.lastInSection = read() != 0;
+		if (segment.offset >= 0 && segment.offset + segment.length > result.m_strings.size()) {
+			throw Exception("Invalid packed version");
+		}
+		result.m_segments.append(segment);
+	}
+	return result;
+}
+
 Version::Type Version::typeFromString(const QString &string)
 {
 	if (string == "alpha") {
@@ -157,64 +269,88 @@ Version::Type Version::typeFromString(const QString &string)
 	}
 }
 
-static char compareIntegers(const int a, const int b) {
-	if (a == b) {
-		return 0;
-	} else if (a < b) {
-		return -1;
-	} else /* if (a > b) */ {
-		return 1;
-	}
-}
-
-char Version::compareWith(const Version &other) const
-{
-	static const QVector<Section> defaultSection = QVector<Section>();
-
-	for (int i = 0; i < std::max(m_sections.size(), other.m_sections.size()); ++i) {
-		const QVector<Section> a = m_sections.size() > i ? m_sections.at(i) : defaultSection;
-		const QVector<Section> b = other.m_sections.size() > i ? other.m_sections.at(i) : defaultSection;
-
-		const char value = compareSections(a, b);
-		if (value != 0) {
-			return value;
-		}
-	}
-	return 0;
-}
-
 /* Some notes on this algorithm:
  *
- * #1 Empty sections use the default value of 0 (1.0 and 1.0.0.0 are equal)
- * #2 String sections are worth "less" than integer sections (1.0-a is less than 1.0, since 1.0 is equivalent with 1.0-0)
+ * #1 Missing sections and segments use the default value of 0 (1.0 and 1.0.0.0 are equal)
+ * #2 Integer segments are worth less than string segments (1.0-a is more than 1.0, since 1.0 is equivalent with 1.0-0)
  */
-char Version::compareSections(const QVector<Version::Section> &a, const QVector<Version::Section> &b)
+int Version::compareWith(const Version &other) const
 {
-	static const Section defaultSubsection = qMakePair(QString(), 0); // #1
+	if (m_hasKey && other.m_hasKey && m_key != other.m_key) {
+		return m_key < other.m_key ? -1 : 1;
+	}
 
-	for (int i = 0; i < std::max(a.size(), b.size()); ++i) {
-		const Section secA = a.size() > i ? a.at(i) : defaultSubsection; // #1
-		const Section secB = b.size() > i ? b.at(i) : defaultSubsection; // #1
+	static const Segment zero = Segment{0, -1, 0, true}; // #1
 
-		if (secA.first.isNull() && secB.first.isNull()) { // both are integers
-			const char value = compareIntegers(secA.second, secB.second);
+	const Segment *a = m_segments.constBegin();
+	const Segment *aEnd = m_segments.constEnd();
+	const Segment *b = other.m_segments.constBegin();
+	const Segment *bEnd = other.m_segments.constEnd();
+	while (a != aEnd || b != bEnd) {
+		// one section at a time, whichever runs out first continues with zeros
+		bool aDone = a == aEnd;
+		bool bDone = b == bEnd;
+		while (!aDone || !bDone) {
+			const int value = compareSegments(aDone ? zero : *a, other, bDone ? zero : *b);
 			if (value != 0) {
 				return value;
 			}
-		} else if (secA.first.isNull()) { // only secB is integer
-			return -1; // #2
-		} else if (secB.first.isNull()) { // only secA is integer
-			return 1; // #2
-		} else { // both are strings
-			const char value = static_cast<const char>(secA.first.compare(secB.first));
-			if (value != 0) {
-				return value;
+			if (!aDone) {
+				aDone = a++->lastInSection;
+			}
+			if (!bDone) {
+				bDone = b++->lastInSection;
 			}
 		}
 	}
-
 	return 0;
 }
 
+int Version::compareSegments(const Segment &a, const Version &other, const Segment &b) const
+{
+	if (a.offset < 0 && b.offset < 0) {
+		return a.integer == b.integer ? 0 : (a.integer < b.integer ? -1 : 1);
+	} else if (a.offset < 0) {
+		return -1; // #2
+	} else if (b.offset < 0) {
+		return 1; // #2
+	}
+
+	const QChar *strA = m_strings.constData() + a.offset;
+	const QChar *strB = other.m_strings.constData() + b.offset;
+	const int length = std::min(a.length, b.length);
+	for (int i = 0; i < length; ++i) {
+		if (strA[i] != strB[i]) {
+			return strA[i].unicode() < strB[i].unicode() ? -1 : 1;
+		}
+	}
+	return a.length == b.length ? 0 : (a.length < b.length ? -1 : 1);
+}
+
+QDataStream &operator<<(QDataStream &str, const Version &version)
+{
+	return str << version.isValid() << (version.isValid() ? version.toString() : QString());
+}
+QDataStream &operator>>(QDataStream &str, Version &version)
+{
+	bool valid;
+	QString string;
+	str >> valid >> string;
+	version = valid ? Version::fromString(string) : Version();
+	return str;
+}
+QDataStream &operator<<(QDataStream &str, const VersionRequirement &requirement)
+{
+	return str << requirement.isValid() << (requirement.isValid() ? requirement.toString() : QString());
+}
+QDataStream &operator>>(QDataStream &str, VersionRequirement &requirement)
+{
+	bool valid;
+	QString string;
+	str >> valid >> string;
+	requirement = valid ? VersionRequirement::fromString(string) : VersionRequirement();
+	return str;
+}
+
 }
 }
@@ -15,16 +15,18 @@
 
 #pragma once
 
-#include <QPair>
+#include <QString>
 #include <QVector>
 
+QT_BEGIN_NAMESPACE
+class QDataStream;
+QT_END_NAMESPACE
+
 namespace Ralph {
 namespace ClientLib {
 
 class Version
 {
-	using Section = QPair<QString, int>;
-
 public:
 	enum Type
 	{
@@ -43,10 +45,10 @@ public:
 	QString typeString() const { return m_typeString; }
 	Type type() const { return m_type; }
 
-	inline bool operator<(const Version &other) const { return compareWith(other) == -1; }
-	inline bool operator<=(const Version &other) const { return compareWith(other) != 1; }
-	inline bool operator>(const Version &other) const { return compareWith(other) == 1; }
-	inline bool operator>=(const Version &other) const { return compareWith(other) != -1; }
+	inline bool operator<(const Version &other) const { return compareWith(other) < 0; }
+	inline bool operator<=(const Version &other) const { return compareWith(other) <= 0; }
+	inline bool operator>(const Version &other) const { return compareWith(other) > 0; }
+	inline bool operator>=(const Version &other) const { return compareWith(other) >= 0; }
 	inline bool operator==(const Version &other) const { return compareWith(other) == 0; }
 	inline bool operator!=(const Version &other) const { return compareWith(other) != 0; }
 
@@ -55,16 +57,34 @@ public:
 	static Version fromString(const QString &string);
 	static Type typeFromString(const QString &string);
 
+	/// Already parsed binary representation, as stored in the package index
+	QByteArray toPacked() const;
+	static Version fromPacked(const QByteArray &data);
+
 private:
-	char compareWith(const Version &other) const;
-	static char compareSections(const QVector<Section> &a, const QVector<Section> &b);
+	/// One of the dot separated parts of a version, sections are separated by dashes
+	struct Segment
+	{
+		int integer;
+		int offset; // into m_strings if this is a string, -1 if it is an integer
+		int length;
+		bool lastInSection;
+	};
+
+	/// @returns -1, 0 or 1
+	int compareWith(const Version &other) const;
+	int compareSegments(const Segment &a, const Version &other, const Segment &b) const;
 
 private:
 	bool m_isValid = false;
 
 	QString m_typeString;
 	Type m_type = Custom;
-	QVector<QVector<Section>> m_sections;
+	QVector<Segment> m_segments;
+	QString m_strings;
+	// the first four segments as 16 bit numbers, if they are numbers and fit, which is usually enough to order versions
+	quint64 m_key = 0;
+	bool m_hasKey = false;
 };
 
 class VersionRequirement
@@ -97,10 +117,15 @@ public:
 
 private:
 	Version m_version;
-	Type m_type;
+	Type m_type = Equal;
 	QString m_allowedTypeString;
-	Version::Type m_allowedType;
+	Version::Type m_allowedType = Version::Custom;
 };
 
+QDataStream &operator<<(QDataStream &str, const Version &version);
+QDataStream &operator>>(QDataStream &str, Version &version);
+QDataStream &operator<<(QDataStream &str, const VersionRequirement &requirement);
+QDataStream &operator>>(QDataStream &str, VersionRequirement &requirement);
+
 }
 }
@@ -0,0 +1,134 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <random>
+
+#include <KArchive/KTar>
+#include <KArchive/K7Zip>
+#include <KArchive/KZip>
+
+#include "task/Archive.h"
+
+using namespace Ralph::ClientLib;
+
+// an SDK has many small headers and some larger libraries, a header-only library just the
+// headers, all reasonably compressible
+static qint64 generate(KArchive *archive, const int files, const bool headerOnly)
+{
+	std::mt19937 random(42);
+	std::uniform_int_distribution<int> word(0, 255);
+	std::lognormal_distribution<double> size(headerOnly ? 7.5 : 9.0, headerOnly ? 0.8 : 1.5);
+
+	QVector<QByteArray> words;
+	for (int i = 0; i < 256; ++i) {
+		words.append(QByteArray::number(random(), 36) + ' ');
+	}
+
+	qint64 total = 0;
+	archive->open(QIODevice::WriteOnly);
+	for (int i = 0; i < files; ++i) {
+		const int bytes = std::min(int(size(random)), 32 * 1024 * 1024);
+		QByteArray data;
+		data.reserve(bytes + 16);
+		while (data.size() < bytes) {
+			data.append(words.at(word(random)));
+		}
+		archive->writeFile("include/dir%1/file%2" % (i % 50) % i, data);
+		total += data.size();
+	}
+	archive->close();
+	return total;
+}
+
+static std::unique_ptr<KArchive> openArchive(const QString &filename)
+{
+	if (filename.endsWith(".zip")) {
+		return std::make_unique<KZip>(filename);
+	} else if (filename.endsWith(".7z")) {
+		return std::make_unique<K7Zip>(filename);
+	} else {
+		return std::make_unique<KTar>(filename);
+	}
+}
+
+// KArchive reading everything into its directory first, what extract() used to do
+static void runReference(QTextStream &out, const QString &filename)
+{
+	QTemporaryDir dir;
+	QElapsedTimer timer;
+	timer.start();
+	std::unique_ptr<KArchive> archive = openArchive(filename);
+	archive->open(QIODevice::ReadOnly);
+	archive->directory()->copyTo(dir.path());
+	out << QFileInfo(filename).fileName() << " with KArchive: " << timer.elapsed() << " ms" << endl;
+}
+
+static void run(QTextStream &out, const QString &filename, const qint64 size, const QVector<int> &threads)
+{
+	for (const int count : threads) {
+		QTemporaryDir dir;
+		QElapsedTimer timer;
+		timer.start();
+		extract(filename, QDir(dir.path()), count).result();
+		const qint64 elapsed = std::max(qint64(1), timer.elapsed());
+		out << QFileInfo(filename).fileName() << " with " << count << " threads: " << elapsed << " ms";
+		if (size > 0) {
+			out << ", " << (size / 1024 / 1024) * 1000 / elapsed << " MiB/s";
+		}
+		out << endl;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	QCoreApplication app(argc, argv);
+	QTextStream out(stdout);
+
+	const int maxThreads = int(Executor::instance()->threadCount());
+	QVector<int> threads;
+	for (int count = 1; count < maxThreads; count *= 2) {
+		threads.append(count);
+	}
+	threads.append(maxThreads);
+
+	// pass an archive of a real SDK to measure that instead
+	if (argc > 1 && QFile::exists(argv[1])) {
+		runReference(out, argv[1]);
+		run(out, argv[1], 0, threads);
+		return 0;
+	}
+
+	const int files = argc > 1 ? QString(argv[1]).toInt() : 2000;
+	QTemporaryDir dir;
+	for (const QString &shape : {QStringLiteral("sdk"), QStringLiteral("headers")}) {
+		const bool headerOnly = shape == "headers";
+		const int count = headerOnly ? files * 10 : files;
+		for (const QString &suffix : {QStringLiteral(".zip"), QStringLiteral(".7z"), QStringLiteral(".tar.gz"), QStringLiteral(".tar.xz")}) {
+			const QString filename = dir.filePath(shape + suffix);
+			const qint64 size = generate(openArchive(filename).get(), count, headerOnly);
+			out << shape + suffix << ": " << count << " files, " << size / 1024 / 1024 << " MiB uncompressed, "
+				<< QFileInfo(filename).size() / 1024 / 1024 << " MiB compressed" << endl;
+			runReference(out, filename);
+			// tar is always sequential, the thread count doesn't matter
+			run(out, filename, size, suffix.startsWith(".tar") ? QVector<int>{1} : threads);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,114 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <atomic>
+#include <thread>
+
+#include "task/Coroutine.h"
+
+using namespace Ralph::ClientLib;
+
+#ifdef RALPH_HAS_COROUTINES
+
+// the same chain of depth tasks awaiting each other, once blocking and once suspending
+static Future<int> awaitChain(const int depth)
+{
+	return async(std::launch::async, [depth](Notifier notifier)
+	{
+		return depth == 0 ? 0 : 1 + notifier.await(awaitChain(depth - 1));
+	});
+}
+static Future<int> coroutineChain(const int depth)
+{
+	if (depth == 0) {
+		co_return 0;
+	}
+	co_return 1 + co_await coroutineChain(depth - 1);
+}
+
+static int currentThreads()
+{
+	QFile file("/proc/self/status");
+	if (!file.open(QFile::ReadOnly)) {
+		return -1;
+	}
+	for (const QByteArray &line : file.readAll().split('\n')) {
+		if (line.startsWith("Threads:")) {
+			return line.mid(8).trimmed().toInt();
+		}
+	}
+	return -1;
+}
+
+static void run(QTextStream &out, const char *name, Future<int> (*chain)(int), const int count, const int depth)
+{
+	std::atomic<bool> done(false);
+	std::atomic<int> peakThreads(currentThreads());
+	std::thread monitor([&done, &peakThreads]()
+	{
+		while (!done) {
+			peakThreads = std::max(peakThreads.load(), currentThreads());
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+
+	QElapsedTimer timer;
+	timer.start();
+	QVector<Future<qint64>> latencies;
+	for (int i = 0; i < count; ++i) {
+		latencies.append(chain(depth).then([&timer](const int) { return timer.nsecsElapsed(); }));
+	}
+	const QVector<qint64> results = whenAll(latencies).result();
+	const qint64 total = timer.nsecsElapsed();
+
+	done = true;
+	monitor.join();
+
+	qint64 sum = 0;
+	qint64 max = 0;
+	for (const qint64 latency : results) {
+		sum += latency;
+		max = std::max(max, latency);
+	}
+	out << name << ": " << count << " chains of depth " << depth << " in " << total / 1000000 << " ms, latency mean "
+		<< sum / count / 1000 << " us, max " << max / 1000 << " us, peak threads " << peakThreads << " (monitor included)" << endl;
+}
+
+int main(int argc, char **argv)
+{
+	QCoreApplication app(argc, argv);
+	const int count = argc > 1 ? QString(argv[1]).toInt() : 1000;
+	const int depth = argc > 2 ? QString(argv[2]).toInt() : 10;
+
+	QTextStream out(stdout);
+	out << "executor threads: " << Executor::instance()->threadCount() << endl;
+	run(out, "Notifier::await", &awaitChain, count, depth);
+	run(out, "co_await", &coroutineChain, count, depth);
+	return 0;
+}
+
+#else
+
+int main()
+{
+	QTextStream(stdout) << "built without coroutine support, configure with -DWITH_COROUTINES=ON" << endl;
+	return 0;
+}
+
+#endif
@@ -0,0 +1,79 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <random>
+
+#include "package/DependencyResolver.h"
+#include "package/Package.h"
+
+using namespace Ralph::ClientLib;
+
+// a registry of count packages with versions 1 to versions each, where every version depends on a
+// few packages with a lower index, with version ranges that rule out larger and larger parts of them
+static QHash<QString, QVector<const Package *>> generate(const int count, const int versions)
+{
+	std::mt19937 random(42);
+	QHash<QString, QVector<const Package *>> registry;
+	for (int i = 0; i < count; ++i) {
+		const QString name = QString("package%1").arg(i);
+		for (int v = 1; v <= versions; ++v) {
+			Package *pkg = new Package;
+			pkg->setName(name);
+			pkg->setVersion(Version::fromString(QString("%1.0").arg(v)));
+
+			QVector<PackageDependency> dependencies;
+			for (int d = 0; d < std::min(i, 3); ++d) {
+				PackageDependency dependency(QString("package%1").arg(std::uniform_int_distribution<int>(std::max(0, i - 50), i - 1)(random)));
+				const int bound = std::uniform_int_distribution<int>(1, versions)(random);
+				dependency.setVersion(VersionRequirement::fromString(QString(random() % 4 == 0 ? "<%1.0" : ">=%1.0").arg(bound)));
+				dependencies.append(dependency);
+			}
+			pkg->setDependencies(dependencies);
+			registry[name].append(pkg);
+		}
+	}
+	return registry;
+}
+
+int main(int argc, char **argv)
+{
+	QCoreApplication app(argc, argv);
+	const int count = argc > 1 ? QString(argv[1]).toInt() : 3000;
+	const int versions = argc > 2 ? QString(argv[2]).toInt() : 20;
+	const int roots = argc > 3 ? QString(argv[3]).toInt() : 20;
+
+	const QHash<QString, QVector<const Package *>> registry = generate(count, versions);
+
+	DependencyResolver resolver([&registry](const QString &name) { return registry.value(name); });
+	for (int i = count - roots; i < count; ++i) {
+		resolver.require(QString("package%1").arg(i));
+	}
+
+	QTextStream out(stdout);
+	QElapsedTimer timer;
+	timer.start();
+	try {
+		const QVector<const Package *> result = resolver.resolve();
+		out << "resolved " << result.size() << " packages";
+	} catch (UnresolvableException &) {
+		out << "no solution";
+	}
+	out << " in " << timer.elapsed() << " ms (" << resolver.decisions() << " decisions, " << resolver.conflicts() << " conflicts)" << endl;
+
+	return 0;
+}
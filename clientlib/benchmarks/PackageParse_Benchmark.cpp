@@ -0,0 +1,65 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include "package/Package.h"
+#include "package/PackageSource.h"
+#include "Functional.h"
+
+using namespace Ralph::ClientLib;
+
+// creates count package files roughly the size of the ones in the main repository
+static QVector<QByteArray> generate(const int count)
+{
+	QVector<QByteArray> files;
+	for (int i = 0; i < count; ++i) {
+		const QString name = QString("package%1").arg(i);
+		const QByteArray json = QString(R"({
+			"name": "%1",
+			"version": "1.%2.0",
+			"paths": { "cmake": "lib/cmake/%1", "include": "include" },
+			"dependencies": [ { "name": "dep%2", "version": ">=1.0", "optional": true }, { "name": "other%2", "version": "2.1.3" } ],
+			"mirrors": [ { "git": "https://github.com/example/%1.git#v1.%2.0", "steps": [ "cmake-config", { "type": "cmake-build", "targets": ["install"] } ] },
+						 { "git": "https://gitlab.com/example/%1.git#v1.%2.0", "steps": [ "cmake-config", { "type": "cmake-build", "targets": ["install"] } ],
+						   "requirements": [ { "os": "linux" } ] } ]
+		})").arg(name).arg(i).toUtf8();
+		files.append(json);
+	}
+	return files;
+}
+
+int main(int argc, char **argv)
+{
+	QCoreApplication app(argc, argv);
+	const int count = argc > 1 ? QString(argv[1]).toInt() : 20000;
+
+	const QVector<QByteArray> files = generate(count);
+
+	QTextStream out(stdout);
+	const std::size_t cores = Ralph::Common::Functional::parallelThreadCount();
+	for (const std::size_t threads : {std::size_t(1), std::size_t(2), std::size_t(4), cores}) {
+		QElapsedTimer timer;
+		timer.start();
+		const QVector<const Package *> packages = GitRepoPackageSource::parsePackages(files, threads);
+		const qint64 elapsed = std::max<qint64>(1, timer.elapsed());
+		out << threads << " threads: " << qRound64(double(packages.size()) * 1000 / elapsed) << " files/sec (" << elapsed << " ms)" << endl;
+		qDeleteAll(packages);
+	}
+
+	return 0;
+}
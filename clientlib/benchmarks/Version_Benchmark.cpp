@@ -0,0 +1,139 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QPair>
+#include <QTextStream>
+#include <algorithm>
+#include <random>
+
+#include "Version.h"
+
+using namespace Ralph::ClientLib;
+
+// the way versions used to be stored and compared, as a reference
+namespace Reference {
+using Section = QPair<QString, int>;
+
+static QVector<QVector<Section>> parse(const QString &string)
+{
+	QVector<QVector<Section>> out;
+	for (const QString &section : string.split('-')) {
+		QVector<Section> sections;
+		for (const QString &subsection : section.split('.')) {
+			bool ok = false;
+			const int integer = subsection.toInt(&ok);
+			sections.append(ok ? qMakePair(QString(), integer) : qMakePair(subsection, 0));
+		}
+		out.append(sections);
+	}
+	return out;
+}
+static int compareSections(const QVector<Section> &a, const QVector<Section> &b)
+{
+	static const Section defaultSubsection = qMakePair(QString(), 0);
+	for (int i = 0; i < std::max(a.size(), b.size()); ++i) {
+		const Section secA = a.size() > i ? a.at(i) : defaultSubsection;
+		const Section secB = b.size() > i ? b.at(i) : defaultSubsection;
+		if (secA.first.isNull() && secB.first.isNull()) {
+			if (secA.second != secB.second) {
+				return secA.second < secB.second ? -1 : 1;
+			}
+		} else if (secA.first.isNull()) {
+			return -1;
+		} else if (secB.first.isNull()) {
+			return 1;
+		} else {
+			const int value = secA.first.compare(secB.first);
+			if (value != 0) {
+				return value < 0 ? -1 : 1;
+			}
+		}
+	}
+	return 0;
+}
+static int compare(const QVector<QVector<Section>> &a, const QVector<QVector<Section>> &b)
+{
+	static const QVector<Section> defaultSection = QVector<Section>();
+	for (int i = 0; i < std::max(a.size(), b.size()); ++i) {
+		const QVector<Section> secA = a.size() > i ? a.at(i) : defaultSection;
+		const QVector<Section> secB = b.size() > i ? b.at(i) : defaultSection;
+		const int value = compareSections(secA, secB);
+		if (value != 0) {
+			return value;
+		}
+	}
+	return 0;
+}
+}
+
+// versions as they are found in the wild: mostly x.y.z, sometimes with pre-release suffixes or dates
+static QVector<QString> corpus(const int count)
+{
+	std::mt19937 random(42);
+	auto number = [&random](const int max) { return std::uniform_int_distribution<int>(0, max)(random); };
+	const QVector<QString> suffixes = {"alpha", "beta", "rc1", "rc2", "pre", "dev"};
+
+	QVector<QString> out;
+	for (int i = 0; i < count; ++i) {
+		QString version;
+		switch (number(9)) {
+		case 0: version = QString("%1.%2").arg(number(5)).arg(number(20)); break;
+		case 1: version = QString("%1%2%3").arg(2010 + number(10)).arg(number(11) + 1, 2, 10, QChar('0')).arg(number(27) + 1, 2, 10, QChar('0')); break;
+		case 2: version = QString("%1.%2.%3-%4").arg(number(5)).arg(number(20)).arg(number(30)).arg(suffixes.at(number(suffixes.size() - 1))); break;
+		case 3: version = QString("%1.%2.%3.%4").arg(number(5)).arg(number(20)).arg(number(30)).arg(number(200)); break;
+		default: version = QString("%1.%2.%3").arg(number(5)).arg(number(20)).arg(number(30)); break;
+		}
+		out.append(version);
+	}
+	return out;
+}
+
+int main(int argc, char **argv)
+{
+	QCoreApplication app(argc, argv);
+	const int count = argc > 1 ? QString(argv[1]).toInt() : 100000;
+	const QVector<QString> strings = corpus(count);
+
+	QVector<Version> versions;
+	QVector<QVector<QVector<Reference::Section>>> references;
+	for (const QString &string : strings) {
+		versions.append(Version::fromString(string));
+		references.append(Reference::parse(string));
+	}
+
+	QTextStream out(stdout);
+	QElapsedTimer timer;
+
+	std::size_t comparisons = 0;
+	timer.start();
+	std::sort(versions.begin(), versions.end(), [&comparisons](const Version &a, const Version &b) { ++comparisons; return a < b; });
+	const qint64 current = std::max<qint64>(1, timer.nsecsElapsed());
+	out << "Version:   sorted " << count << " versions in " << current / 1000000 << " ms (" << current / qint64(comparisons) << " ns per comparison)" << endl;
+
+	comparisons = 0;
+	timer.restart();
+	std::sort(references.begin(), references.end(), [&comparisons](const QVector<QVector<Reference::Section>> &a, const QVector<QVector<Reference::Section>> &b)
+	{
+		++comparisons;
+		return Reference::compare(a, b) < 0;
+	});
+	const qint64 reference = std::max<qint64>(1, timer.nsecsElapsed());
+	out << "Reference: sorted " << count << " versions in " << reference / 1000000 << " ms (" << reference / qint64(comparisons) << " ns per comparison)" << endl;
+	out << "Speedup: " << QString::number(double(reference) / current, 'f', 1) << "x" << endl;
+
+	return 0;
+}
@@ -15,6 +15,10 @@
 
 #include "Future.h"
 
+#include <atomic>
+
+#include "task/Executor.h"
+
 namespace Ralph {
 namespace ClientLib {
 namespace Private {
@@ -22,6 +26,32 @@ namespace Private {
 BaseFutureData::~BaseFutureData() {}
 BaseFuture::~BaseFuture() {}
 
+/// @returns false if somebody else already waits for the std::future
+static bool claim(const std::shared_ptr<BaseFutureData> &data)
+{
+	std::unique_lock<std::mutex> lock(data->mutex);
+	if (data->claimed) {
+		return false;
+	}
+	data->claimed = true;
+	return true;
+}
+/// Waits for a claimed std::future, which runs it if it is deferred, and then runs the continuations
+static void finish(const std::shared_ptr<BaseFutureData> &data)
+{
+	data->future.wait();
+	std::vector<std::function<void()>> continuations;
+	{
+		std::unique_lock<std::mutex> lock(data->mutex);
+		data->completed = true;
+		continuations.swap(data->continuations);
+	}
+	data->completedCondition.notify_all();
+	for (const std::function<void()> &continuation : continuations) {
+		continuation();
+	}
+}
+
 void BaseFuture::addWatcher(BaseFutureWatcher *watcher)
 {
 	d->watchers.insert(watcher);
@@ -32,23 +62,131 @@ void BaseFuture::removeWatcher(BaseFutureWatcher *watcher)
 }
 void BaseFuture::start()
 {
-	d->start();
+	std::function<void()> job = d->start();
+	if (job) {
+		d->executor->post(std::move(job));
+	}
 }
 void BaseFuture::waitForFinished()
 {
-	d->start();
-	d->future.wait();
+	start();
+	if (d->executor) {
+		const std::shared_ptr<BaseFutureData> data = d;
+		d->executor->wait([data]()
+		{
+			std::unique_lock<std::mutex> lock(data->mutex);
+			return data->completed;
+		});
+	} else if (claim(d)) {
+		finish(d);
+	} else {
+		// whoever claimed it is busy running it, so this will not take longer than that
+		std::unique_lock<std::mutex> lock(d->mutex);
+		d->completedCondition.wait(lock, [this]() { return d->completed; });
+	}
 }
 
-void BaseFutureData::start()
+void BaseFuture::onFinished(std::function<void()> &&callback)
 {
-	std::unique_lock<std::mutex> lock(mutex);
-	if (state != BaseFutureData::Scheduled) {
+	start();
+	bool completed = false;
+	bool post = false;
+	{
+		std::unique_lock<std::mutex> lock(d->mutex);
+		completed = d->completed;
+		if (!completed) {
+			d->continuations.push_back(std::move(callback));
+			// nobody tells us when a std::future is ready, so it gets run (if deferred) or waited for as a job
+			post = !d->executor && !d->claimed;
+		}
+	}
+	if (completed) {
+		callback();
+	} else if (post) {
+		const std::shared_ptr<BaseFutureData> data = d;
+		Executor::instance()->post([data]()
+		{
+			if (claim(data)) {
+				finish(data);
+			}
+		});
+	}
+}
+
+void onAllFinished(const QVector<Future<void>> &futures, std::function<void()> &&callback)
+{
+	if (futures.isEmpty()) {
+		callback();
 		return;
 	}
-	state = BaseFutureData::Running;
-	// reporting will be done from the other thread
-	startupMutex.unlock();
+	const auto remaining = std::make_shared<std::atomic<int>>(futures.size());
+	const auto shared = std::make_shared<std::function<void()>>(std::move(callback));
+	for (Future<void> future : futures) {
+		future.onFinished([remaining, shared]()
+		{
+			if (--*remaining == 0) {
+				(*shared)();
+			}
+		});
+	}
+}
+void onAnyFinished(const QVector<Future<void>> &futures, std::function<void(int)> &&callback)
+{
+	const auto called = std::make_shared<std::atomic<bool>>(false);
+	const auto shared = std::make_shared<std::function<void(int)>>(std::move(callback));
+	for (int i = 0; i < futures.size(); ++i) {
+		Future<void> future = futures.at(i);
+		future.onFinished([called, shared, i]()
+		{
+			if (!called->exchange(true)) {
+				(*shared)(i);
+			}
+		});
+	}
+}
+
+void BaseFuture::cancel()
+{
+	d->cancelRequested = true;
+}
+void BaseFuture::setDeadline(const std::chrono::steady_clock::time_point &deadline)
+{
+	d->deadline = deadline.time_since_epoch().count();
+}
+bool BaseFuture::isCanceled() const
+{
+	return d->isCanceled();
+}
+
+void BaseFuture::hold()
+{
+	std::unique_lock<std::mutex> lock(d->mutex);
+	d->ready = false;
+}
+void BaseFuture::release()
+{
+	{
+		std::unique_lock<std::mutex> lock(d->mutex);
+		d->ready = true;
+	}
+	start();
+}
+
+std::function<void()> BaseFutureData::start()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (state == BaseFutureData::Scheduled) {
+		state = BaseFutureData::Running;
+		// reporting will be done from the other thread
+		startupMutex.unlock();
+	} else if (state != BaseFutureData::Running) {
+		return {};
+	}
+	std::function<void()> out;
+	if (ready) {
+		out.swap(job);
+	}
+	return out;
 }
 
 }
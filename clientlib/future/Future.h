@@ -17,6 +17,8 @@
 
 #include <QObject>
 #include <QPointer>
+#include <QVector>
+#include <chrono>
 #include <unordered_set>
 #include <exception>
 #include <memory>
@@ -51,6 +53,28 @@ public:
 	void start();
 
 	void waitForFinished();
+	/** Calls callback once the future has finished (successfully or not), without blocking
+	 *
+	 * Starts the future. The callback is called from the thread that finishes the future, or right
+	 * away if that already happened. Futures that do not run on an executor are run (if deferred)
+	 * or waited for by a job on the shared executor.
+	 */
+	void onFinished(std::function<void()> &&callback);
+	/// Keeps the job of a future scheduled on an executor from running, even if started, until release is called
+	void hold();
+	/// Lets a held future run, and starts it
+	void release();
+
+	/** Asks the task to stop, it will finish as canceled if it notices
+	 *
+	 * Tasks check for it through their Notifier. Network transfers, git operations and processes
+	 * are aborted, as are all futures awaited by the task.
+	 */
+	void cancel();
+	/// Cancels the future once deadline has passed
+	void setDeadline(const std::chrono::steady_clock::time_point &deadline);
+	void setTimeout(const std::chrono::milliseconds &timeout) { setDeadline(std::chrono::steady_clock::now() + timeout); }
+	bool isCanceled() const;
 
 protected:
 	friend class BasePromise;
@@ -77,9 +101,16 @@ public:
 		std::unique_lock<std::mutex> lock(d->mutex);
 		if (d->state == Private::FutureData<T>::Exception && d->exception) {
 			d->exception->rethrow();
+		} else if (d->state == Private::FutureData<T>::Canceled) {
+			throw CanceledException("Canceled");
 		}
 		return d_func<T>()->result;
 	}
+
+	/// @returns a future for func called with the result once this future finished, see async(Executor *, Func)
+	// in task/Task.h
+	template <typename Func>
+	Future<typename Common::Functional::FunctionTraits<Func>::ReturnType> then(Func &&func, Executor *executor = nullptr);
 };
 template <>
 class Future<void> : public Private::BaseFuture
@@ -96,8 +127,14 @@ public:
 		std::unique_lock<std::mutex> lock(d->mutex);
 		if (d->state == Private::FutureData<void>::Exception && d->exception) {
 			d->exception->rethrow();
+		} else if (d->state == Private::FutureData<void>::Canceled) {
+			throw CanceledException("Canceled");
 		}
 	}
+
+	// in task/Task.h
+	template <typename Func>
+	Future<typename Common::Functional::FunctionTraits<Func>::ReturnType> then(Func &&func, Executor *executor = nullptr);
 };
 QT_WARNING_POP
 
@@ -114,9 +151,9 @@ template <typename OtherT>
 OtherT Private::BasePromise::await(const Future<OtherT> &other)
 {
 	Future<OtherT> future{other};
-	future.d->delegateTo = std::make_shared<BasePromise>(*this);
+	delegateFrom(future);
 	future.waitForFinished();
-	future.d->delegateTo.reset();
+	stopDelegatingFrom(future);
 	return future.result();
 }
 
@@ -126,5 +163,12 @@ T await(Future<T> future)
 	return future.result();
 }
 
+namespace Private {
+/// Calls callback once all futures have finished, see BaseFuture::onFinished
+void onAllFinished(const QVector<Future<void>> &futures, std::function<void()> &&callback);
+/// Calls callback with the index of the first future to finish, see BaseFuture::onFinished
+void onAnyFinished(const QVector<Future<void>> &futures, std::function<void(int)> &&callback);
+}
+
 }
 }
@@ -19,16 +19,25 @@
 #include <QPointer>
 #include <QSemaphore>
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <future>
 #include <mutex>
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "Functional.h"
 #include "WrappedException.h"
 
 namespace Ralph {
 namespace ClientLib {
+class Executor;
+
+DECLARE_EXCEPTION(Canceled);
+
 namespace Private {
 class BaseFutureWatcher;
 }
@@ -46,15 +55,34 @@ public:
 
 	std::future<void> future;
 	std::mutex mutex;
+	// whoever claims future waits for it (running it if deferred) and then completes it like a scheduled job
+	bool claimed = false;
+	std::condition_variable completedCondition;
 
-	void start();
+	// alternative to future: job gets posted to executor once started, and reports completion itself
+	Executor *executor = nullptr;
+	std::function<void()> job;
+	bool completed = false;
+	bool ready = true; // see BaseFuture::hold
+	std::vector<std::function<void()>> continuations;
+
+	/// @returns the job to post to the executor, if there is one and it is ready and hasn't been posted yet
+	std::function<void()> start();
 	std::mutex startupMutex;
 
+	std::atomic<bool> cancelRequested{false};
+	std::atomic<std::int64_t> deadline{0}; // steady_clock nanoseconds, 0 if there is none
+	bool isCanceled() const; // in Promise.cpp
+
 	std::size_t progressCurrent = 0;
 	std::size_t progressTotal = 0;
 	std::shared_ptr<WrappedException> exception;
 	QString status;
 
+	// set and reset while the future runs, so only accessed through delegate and setDelegate
+	std::shared_ptr<Private::BasePromise> delegate() const; // in Promise.cpp
+	void setDelegate(const std::shared_ptr<Private::BasePromise> &promise); // in Promise.cpp
+	mutable std::mutex delegateMutex;
 	std::shared_ptr<Private::BasePromise> delegateTo;
 	std::unordered_set<std::shared_ptr<void>> tasks;
 
@@ -20,42 +20,53 @@
 
 namespace Ralph {
 namespace ClientLib {
+namespace Private {
+// runs func(a.result(), b.result()) on the shared executor once both have finished
+template <typename A, typename B, typename Func>
+inline auto combine(Future<A> a, Future<B> b, Func &&func)
+{
+	auto future = async(Executor::instance(), [a, b, func]() mutable { return func(a.result(), b.result()); });
+	future.hold();
+	onAllFinished({a, b}, [future]() mutable { future.release(); });
+	return future;
+}
+}
 
 template <typename A, typename B>
 inline auto operator +(Future<A> a, Future<B> b)
 {
-	return async(std::launch::deferred, [&a, &b]() { return a.result() + b.result(); });
+	return Private::combine(a, b, [](const A &x, const B &y) { return x + y; });
 }
 template <typename A, typename B>
 inline auto operator -(Future<A> a, Future<B> b)
 {
-	return async(std::launch::deferred, [&a, &b]() { return a.result() - b.result(); });
+	return Private::combine(a, b, [](const A &x, const B &y) { return x - y; });
 }
 template <typename A, typename B>
 inline auto operator *(Future<A> a, Future<B> b)
 {
-	return async(std::launch::deferred, [&a, &b]() { return a.result() * b.result(); });
+	return Private::combine(a, b, [](const A &x, const B &y) { return x * y; });
 }
 template <typename A, typename B>
 inline auto operator /(Future<A> a, Future<B> b)
 {
-	return async(std::launch::deferred, [&a, &b]() { return a.result() / b.result(); });
+	return Private::combine(a, b, [](const A &x, const B &y) { return x / y; });
 }
 template <typename A, typename B>
 inline auto operator %(Future<A> a, Future<B> b)
 {
-	return async(std::launch::deferred, [&a, &b]() { return a.result() % b.result(); });
+	return Private::combine(a, b, [](const A &x, const B &y) { return x % y; });
 }
 
 template <typename A, typename B>
 inline auto operator &&(Future<A> a, Future<B> b)
 {
-	return async(std::launch::deferred, [&a, &b]() { return a.result() && b.result(); });
+	return Private::combine(a, b, [](const A &x, const B &y) { return x && y; });
 }
 template <typename A, typename B>
 inline auto operator ||(Future<A> a, Future<B> b)
 {
-	return async(std::launch::deferred, [&a, &b]() { return a.result() || b.result(); });
+	return Private::combine(a, b, [](const A &x, const B &y) { return x || y; });
 }
 
 }
@@ -15,7 +15,10 @@
 
 #include "Promise.h"
 
+#include <chrono>
+
 #include "FutureWatcher.h"
+#include "task/Executor.h"
 
 namespace Ralph {
 namespace ClientLib {
@@ -42,6 +45,69 @@ void BasePromise::prime(std::future<void> &&future)
 	Q_ASSERT(!d->future.valid());
 	d->future = std::forward<std::future<void>>(future);
 }
+void BasePromise::schedule(Executor *executor, std::function<void()> &&job)
+{
+	std::unique_lock<std::mutex> lock(d->mutex);
+	Q_ASSERT(!d->future.valid() && !d->executor);
+	d->executor = executor;
+	d->job = std::move(job);
+}
+bool BaseFutureData::isCanceled() const
+{
+	if (cancelRequested) {
+		return true;
+	}
+	const std::int64_t end = deadline;
+	if (end != 0 && std::chrono::steady_clock::now().time_since_epoch().count() > end) {
+		return true;
+	}
+	const std::shared_ptr<BasePromise> parent = delegate();
+	return parent && parent->isCanceled();
+}
+
+std::shared_ptr<BasePromise> BaseFutureData::delegate() const
+{
+	std::unique_lock<std::mutex> lock(delegateMutex);
+	return delegateTo;
+}
+void BaseFutureData::setDelegate(const std::shared_ptr<BasePromise> &promise)
+{
+	std::unique_lock<std::mutex> lock(delegateMutex);
+	delegateTo = promise;
+}
+
+bool BasePromise::isCanceled() const
+{
+	return d->isCanceled();
+}
+void BasePromise::checkCanceled() const
+{
+	if (isCanceled()) {
+		throw CanceledException("Canceled");
+	}
+}
+
+void BasePromise::delegateFrom(const BaseFuture &future)
+{
+	future.d->setDelegate(std::make_shared<BasePromise>(*this));
+}
+void BasePromise::stopDelegatingFrom(const BaseFuture &future)
+{
+	future.d->setDelegate(nullptr);
+}
+void BasePromise::complete()
+{
+	std::vector<std::function<void()>> continuations;
+	{
+		std::unique_lock<std::mutex> lock(d->mutex);
+		d->completed = true;
+		continuations.swap(d->continuations);
+	}
+	d->executor->notify();
+	for (const std::function<void()> &continuation : continuations) {
+		continuation();
+	}
+}
 void BasePromise::reportStarted()
 {
 	// setting the state is done from BaseFutureData::start
@@ -73,8 +139,8 @@ void BasePromise::reportProgress(const std::size_t current, const std::size_t to
 	}
 	report(&BaseFutureWatcher::progress, current, total);
 
-	if (d->delegateTo) {
-		d->delegateTo->reportProgress(current, total);
+	if (const std::shared_ptr<BasePromise> parent = d->delegate()) {
+		parent->reportProgress(current, total);
 	}
 }
 void BasePromise::reportStatus(const QString &message)
@@ -85,8 +151,8 @@ void BasePromise::reportStatus(const QString &message)
 	}
 	report(&BaseFutureWatcher::status, message);
 
-	if (d->delegateTo) {
-		d->delegateTo->reportStatus(message);
+	if (const std::shared_ptr<BasePromise> parent = d->delegate()) {
+		parent->reportStatus(message);
 	}
 }
 void BasePromise::reportException(const std::exception_ptr &exception)
@@ -98,8 +164,8 @@ void BasePromise::reportException(const std::exception_ptr &exception)
 	}
 	report(&BaseFutureWatcher::exception);
 
-	if (d->delegateTo) {
-		d->delegateTo->reportException(exception);
+	if (const std::shared_ptr<BasePromise> parent = d->delegate()) {
+		parent->reportException(exception);
 	}
 }
 
@@ -25,6 +25,8 @@ namespace ClientLib {
 template <typename> class Future;
 
 namespace Private {
+class BaseFuture;
+
 class BasePromise
 {
 public:
@@ -36,15 +38,28 @@ public:
 	void addTask(const std::shared_ptr<T> &task) { d->tasks.insert(task); }
 
 	void prime(std::future<void> &&future);
+	/// Instead of prime, runs job on executor once the future is started, job has to call complete when done
+	void schedule(Executor *executor, std::function<void()> &&job);
+	/// For scheduled promises, wakes up waiters and runs continuations, after everything else has been reported
+	void complete();
 	void reportStarted();
 	void reportFinished();
 	void reportCanceled();
 	void reportProgress(const std::size_t current, const std::size_t total);
 	void reportStatus(const QString &message);
 	void reportException(const std::exception_ptr &exception);
+
+	/// @returns true if cancellation of this or of whatever is awaiting it was requested, or a deadline passed
+	bool isCanceled() const;
+	/// Throws CanceledException if isCanceled
+	void checkCanceled() const;
 	// in Future.h
 	template <typename OtherT>
 	OtherT await(const Future<OtherT> &other);
+	/// Passes status, progress and exceptions reported by future on to this promise, like await does
+	void delegateFrom(const BaseFuture &future);
+	/// Undoes delegateFrom, once future has finished
+	void stopDelegatingFrom(const BaseFuture &future);
 
 protected:
 	template <typename T> std::shared_ptr<Private::FutureData<T>> d_func() const { return std::static_pointer_cast<Private::FutureData<T>>(d); }
@@ -63,7 +78,7 @@ class Promise : public Private::BasePromise
 {
 public:
 	explicit Promise() : Private::BasePromise(std::make_shared<Private::FutureData<T>>()) {}
-	Promise(const Promise<T> &other) : Private::BasePromise(other.d) {}
+	Promise(const Promise<T> &other) : Private::BasePromise(other) {}
 
 	void reportResult(T &&result)
 	{
@@ -79,7 +94,7 @@ class Promise<void> : public Private::BasePromise
 {
 public:
 	explicit Promise() : Private::BasePromise(std::make_shared<Private::FutureData<void>>()) {}
-	Promise(const Promise<void> &other) : Private::BasePromise(other.d) {}
+	Promise(const Promise<void> &other) : Private::BasePromise(other) {}
 
 	// in Future.h
 	inline Future<void> future() const;
@@ -74,12 +74,31 @@ Future<GitRepo *> GitRepo::open(const QDir &dir)
 	});
 }
 
+bool GitRepo::supportsShallow()
+{
+#if LIBGIT2_VER_MAJOR > 1 || (LIBGIT2_VER_MAJOR == 1 && LIBGIT2_VER_MINOR >= 7)
+	return true;
+#else
+	return false;
+#endif
+}
+bool GitRepo::isCommitish(const QString &id)
+{
+	for (const QChar &c : id.toLower()) {
+		if (c < '0' || c > 'f') {
+			return false;
+		}
+	}
+	return id.size() >= 3;
+}
+
 struct GitPayload
 {
 	Notifier notifier;
 	QString identifier;
 	QVariant payload;
 	enum { Initial, Fetching, CheckingOut } state = Initial;
+	bool reportedSize = false;
 };
 
 static void gitCheckoutNotifier(const char *, const size_t current, const size_t total, void *payload)
@@ -91,6 +110,19 @@ static void gitCheckoutNotifier(const char *, const size_t current, const size_t
 	}
 	pl->notifier.progress(current, total);
 }
+// progress_cb can't abort a checkout, but notify_cb (called before each file is written) can
+static int gitCheckoutCancel(git_checkout_notify_t, const char *, const git_diff_file *, const git_diff_file *, const git_diff_file *, void *payload)
+{
+	return static_cast<GitPayload *>(payload)->notifier.isCanceled() ? GIT_EUSER : 0;
+}
+static void setCheckoutCallbacks(git_checkout_options &opts, GitPayload *payload)
+{
+	opts.progress_cb = &gitCheckoutNotifier;
+	opts.progress_payload = payload;
+	opts.notify_flags = GIT_CHECKOUT_NOTIFY_UPDATED;
+	opts.notify_cb = &gitCheckoutCancel;
+	opts.notify_payload = payload;
+}
 static int gitFetchNotifier(const git_transfer_progress *stats, void *payload)
 {
 	GitPayload *pl = static_cast<GitPayload *>(payload);
@@ -99,13 +131,26 @@ static int gitFetchNotifier(const git_transfer_progress *stats, void *payload)
 		pl->state = GitPayload::Fetching;
 	}
 	pl->notifier.progress(stats->received_objects, stats->total_objects);
+	if (!pl->reportedSize && stats->total_objects > 0 && stats->received_objects == stats->total_objects) {
+		pl->notifier.status("Fetched %1 objects (%2 MiB)" % stats->total_objects % QString::number(double(stats->received_bytes) / (1024 * 1024), 'f', 1));
+		pl->reportedSize = true;
+	}
 
-	return 0;
+	return pl->notifier.isCanceled() ? GIT_EUSER : 0;
+}
+static void setFetchDepth(git_fetch_options &opts, const int depth)
+{
+#if LIBGIT2_VER_MAJOR > 1 || (LIBGIT2_VER_MAJOR == 1 && LIBGIT2_VER_MINOR >= 7)
+	opts.depth = depth;
+#else
+	Q_UNUSED(opts)
+	Q_UNUSED(depth)
+#endif
 }
 
-Future<GitRepo *> GitRepo::clone(const QDir &dir, const QUrl &url)
+Future<GitRepo *> GitRepo::clone(const QDir &dir, const QUrl &url, const bool bare, const int depth)
 {
-	return async([dir, url](Notifier notifier)
+	return async([dir, url, bare, depth](Notifier notifier)
 	{
 		initGit();
 
@@ -116,12 +161,13 @@ Future<GitRepo *> GitRepo::clone(const QDir &dir, const QUrl &url)
 		GitPayload payload{notifier};
 
 		git_clone_options opts = GIT_CLONE_OPTIONS_INIT;
+		opts.bare = bare ? 1 : 0;
 		opts.checkout_opts.checkout_strategy = GIT_CHECKOUT_FORCE | GIT_CHECKOUT_USE_THEIRS;
-		opts.checkout_opts.progress_cb = &gitCheckoutNotifier;
-		opts.checkout_opts.progress_payload = &payload;
+		setCheckoutCallbacks(opts.checkout_opts, &payload);
 		opts.fetch_opts.callbacks.transfer_progress = &gitFetchNotifier;
 		opts.fetch_opts.callbacks.payload = &payload;
 		opts.fetch_opts.callbacks.credentials = &credentialsCallback;
+		setFetchDepth(opts.fetch_opts, depth);
 
 		repo->m_repo = GitResource<git_repository>::create(&git_clone, &git_repository_free,
 														   url.toString().toLocal8Bit(), dir.absolutePath().toLocal8Bit(), &opts);
@@ -129,10 +175,71 @@ Future<GitRepo *> GitRepo::clone(const QDir &dir, const QUrl &url)
 		return repo.release();
 	});
 }
+Future<GitRepo *> GitRepo::mirror(const QDir &dir, const QUrl &url)
+{
+	return async([dir, url](Notifier notifier)
+	{
+		initGit();
+
+		std::unique_ptr<GitRepo> repo = std::make_unique<GitRepo>(dir);
+		if (dir.exists()) {
+			repo->m_repo = GitResource<git_repository>::create(&git_repository_open_ext, &git_repository_free,
+															   dir.absolutePath().toLocal8Bit(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr);
+		} else {
+			git_repository_init_options opts = GIT_REPOSITORY_INIT_OPTIONS_INIT;
+			opts.flags |= GIT_REPOSITORY_INIT_MKPATH | GIT_REPOSITORY_INIT_BARE;
+			repo->m_repo = GitResource<git_repository>::create(&git_repository_init_ext, &git_repository_free,
+															   dir.absolutePath().toLocal8Bit(), &opts);
+			GitResource<git_remote>::create(&git_remote_create_with_fetchspec, &git_remote_free, repo->m_repo,
+											"origin", url.toString().toLocal8Bit().constData(), "+refs/heads/*:refs/heads/*");
+		}
+
+		notifier.status("Updating mirror of %1..." % url.toString());
 
-Future<void> GitRepo::fetch() const
+		auto remote = GitResource<git_remote>::create(&git_remote_lookup, &git_remote_free, repo->m_repo, "origin");
+
+		GitPayload payload{notifier};
+
+		git_fetch_options opts = GIT_FETCH_OPTIONS_INIT;
+		opts.callbacks.transfer_progress = &gitFetchNotifier;
+		opts.callbacks.payload = &payload;
+		opts.callbacks.credentials = &credentialsCallback;
+		opts.download_tags = GIT_REMOTE_DOWNLOAD_TAGS_ALL;
+		opts.prune = GIT_FETCH_PRUNE;
+
+		GitException::checkAndThrow(git_remote_fetch(remote, nullptr, &opts, nullptr));
+
+		return repo.release();
+	});
+}
+Future<GitRepo *> GitRepo::cloneRef(const QDir &dir, const QUrl &url, const QString &ref, const int depth)
 {
-	return async([this](Notifier notifier)
+	return async([dir, url, ref, depth](Notifier notifier)
+	{
+		std::unique_ptr<GitRepo> repo(notifier.await(init(dir)));
+
+		notifier.status("Cloning %1 from %2..." % ref % url.toString());
+
+		GitResource<git_remote>::create(&git_remote_create, &git_remote_free, repo->m_repo,
+										"origin", url.toString().toLocal8Bit().constData());
+		notifier.await(repo->fetch(depth, ref));
+
+		return repo.release();
+	});
+}
+
+bool GitRepo::isShallow() const
+{
+	return git_repository_is_shallow(m_repo) == 1;
+}
+void GitRepo::setOriginUrl(const QUrl &url) const
+{
+	GitException::checkAndThrow(git_remote_set_url(m_repo, "origin", url.toString().toLocal8Bit().constData()));
+}
+
+Future<void> GitRepo::fetch(const int depth, const QString &ref) const
+{
+	return async([this, depth, ref](Notifier notifier)
 	{
 		auto remote = GitResource<git_remote>::create(&git_remote_lookup, &git_remote_free, m_repo, "origin");
 
@@ -142,8 +249,21 @@ Future<void> GitRepo::fetch() const
 		opts.callbacks.transfer_progress = &gitFetchNotifier;
 		opts.callbacks.payload = &payload;
 		opts.callbacks.credentials = &credentialsCallback;
+		setFetchDepth(opts, depth);
 
-		GitException::checkAndThrow(git_remote_fetch(remote, nullptr, &opts, nullptr));
+		if (ref.isEmpty()) {
+			GitException::checkAndThrow(git_remote_fetch(remote, nullptr, &opts, nullptr));
+			return;
+		}
+
+		// we don't know if it's a tag or a branch, but fetching something that doesn't exist is not an error
+		QByteArray tagSpec = "+refs/tags/" + ref.toUtf8() + ":refs/tags/" + ref.toUtf8();
+		QByteArray branchSpec = "+refs/heads/" + ref.toUtf8() + ":refs/heads/" + ref.toUtf8();
+		char *specs[] = {tagSpec.data(), branchSpec.data()};
+		git_strarray refspecs{specs, 2};
+		opts.download_tags = GIT_REMOTE_DOWNLOAD_TAGS_NONE;
+
+		GitException::checkAndThrow(git_remote_fetch(remote, &refspecs, &opts, nullptr));
 	});
 }
 Future<void> GitRepo::checkout(const QString &id) const
@@ -154,18 +274,21 @@ Future<void> GitRepo::checkout(const QString &id) const
 
 		git_checkout_options opts = GIT_CHECKOUT_OPTIONS_INIT;
 		opts.checkout_strategy = GIT_CHECKOUT_FORCE | GIT_CHECKOUT_USE_THEIRS;
-		opts.progress_cb = &gitCheckoutNotifier;
 		GitPayload payload{notifier, id};
-		opts.progress_payload = &payload;
+		setCheckoutCallbacks(opts, &payload);
 
 		GitException::checkAndThrow(git_checkout_tree(m_repo, treeish, &opts));
+
+		// HEAD has to follow, it is what the next checkout compares the working tree against
+		auto commit = GitResource<git_object>::create(&git_object_peel, &git_object_free, treeish.get(), GIT_OBJ_COMMIT);
+		GitException::checkAndThrow(git_repository_set_head_detached(m_repo, git_object_id(commit)));
 	});
 }
-Future<void> GitRepo::pull(const QString &id) const
+Future<void> GitRepo::pull(const QString &id, const int depth) const
 {
-	return async([this, id](Notifier notifier)
+	return async([this, id, depth](Notifier notifier)
 	{
-		notifier.await(fetch());
+		notifier.await(fetch(depth));
 		notifier.await(checkout(id));
 	});
 }
@@ -176,8 +299,7 @@ static int gitSubmoduleUpdate(git_submodule *sm, const char *, void *payload)
 
 	git_submodule_update_options opts = GIT_SUBMODULE_UPDATE_OPTIONS_INIT;
 	opts.checkout_opts.checkout_strategy = GIT_CHECKOUT_FORCE | GIT_CHECKOUT_USE_THEIRS;
-	opts.checkout_opts.progress_cb = &gitCheckoutNotifier;
-	opts.checkout_opts.progress_payload = payload;
+	setCheckoutCallbacks(opts.checkout_opts, pl);
 	opts.fetch_opts.callbacks.transfer_progress = &gitFetchNotifier;
 	opts.fetch_opts.callbacks.payload = payload;
 	opts.fetch_opts.callbacks.credentials = &GitRepo::credentialsCallback;
@@ -193,6 +315,111 @@ Future<void> GitRepo::submodulesUpdate(const bool init) const
 	});
 }
 
+static QString oidToString(const git_oid *oid)
+{
+	char buffer[GIT_OID_HEXSZ + 1];
+	git_oid_tostr(buffer, sizeof(buffer), oid);
+	return QString::fromLatin1(buffer);
+}
+static GitResource<git_tree> lookupTree(git_repository *repo, const QString &id)
+{
+	git_oid oid;
+	GitException::checkAndThrow(git_oid_fromstr(&oid, id.toLatin1().constData()));
+	return GitResource<git_tree>::create(&git_tree_lookup, &git_tree_free, repo, &oid);
+}
+
+Future<QString> GitRepo::treeId(const QString &id) const
+{
+	return async([this, id](Notifier)
+	{
+		const QString spec = id + "^{tree}";
+		auto tree = GitResource<git_object>::create(&git_revparse_single, &git_object_free, m_repo, spec.toLocal8Bit().constData());
+		return oidToString(git_object_id(tree));
+	});
+}
+Future<QVector<GitDiffEntry>> GitRepo::diff(const QString &fromTree, const QString &toTree) const
+{
+	return async([this, fromTree, toTree](Notifier)
+	{
+		auto from = lookupTree(m_repo, fromTree);
+		auto to = lookupTree(m_repo, toTree);
+
+		git_diff_options opts = GIT_DIFF_OPTIONS_INIT;
+		auto diff = GitResource<git_diff>::create(&git_diff_tree_to_tree, &git_diff_free, m_repo, from.get(), to.get(), &opts);
+
+		QVector<GitDiffEntry> out;
+		const size_t count = git_diff_num_deltas(diff);
+		for (size_t i = 0; i < count; ++i) {
+			const git_diff_delta *delta = git_diff_get_delta(diff, i);
+			const QString oldPath = QString::fromUtf8(delta->old_file.path);
+			const QString newPath = QString::fromUtf8(delta->new_file.path);
+			switch (delta->status) {
+			case GIT_DELTA_ADDED:
+			case GIT_DELTA_COPIED:
+				out.append(GitDiffEntry(GitDiffEntry::Added, newPath));
+				break;
+			case GIT_DELTA_DELETED:
+				out.append(GitDiffEntry(GitDiffEntry::Deleted, oldPath));
+				break;
+			case GIT_DELTA_RENAMED:
+				out.append(GitDiffEntry(GitDiffEntry::Deleted, oldPath));
+				out.append(GitDiffEntry(GitDiffEntry::Added, newPath));
+				break;
+			default:
+				out.append(GitDiffEntry(GitDiffEntry::Modified, newPath));
+				break;
+			}
+		}
+		return out;
+	});
+}
+
+struct GitBlobWalkPayload
+{
+	git_repository *repo;
+	const std::function<bool(const QString &)> &filter;
+	QVector<GitBlob> blobs;
+	std::exception_ptr exception;
+};
+static int gitBlobWalker(const char *root, const git_tree_entry *entry, void *payload)
+{
+	GitBlobWalkPayload *pl = static_cast<GitBlobWalkPayload *>(payload);
+	if (git_tree_entry_type(entry) != GIT_OBJ_BLOB) {
+		return 0;
+	}
+	try {
+		const QString path = QString::fromUtf8(root) + QString::fromUtf8(git_tree_entry_name(entry));
+		if (pl->filter(path)) {
+			pl->blobs.append(GitBlob(path, GitResource<git_blob>::create(&git_blob_lookup, &git_blob_free, pl->repo, git_tree_entry_id(entry))));
+		}
+		return 0;
+	} catch (...) {
+		pl->exception = std::current_exception();
+		return -1;
+	}
+}
+
+Future<QVector<GitBlob>> GitRepo::readBlobs(const QString &tree, const std::function<bool(const QString &)> &filter) const
+{
+	return async([this, tree, filter](Notifier)
+	{
+		auto root = lookupTree(m_repo, tree);
+
+		GitBlobWalkPayload payload{m_repo, filter, {}, nullptr};
+		const int error = git_tree_walk(root, GIT_TREEWALK_PRE, &gitBlobWalker, &payload);
+		if (payload.exception) {
+			std::rethrow_exception(payload.exception);
+		}
+		GitException::checkAndThrow(error);
+		return payload.blobs;
+	});
+}
+
+QByteArray GitBlob::data() const
+{
+	return QByteArray::fromRawData(static_cast<const char *>(git_blob_rawcontent(m_blob)), int(git_blob_rawsize(m_blob)));
+}
+
 GitCredentialResponse::GitCredentialResponse(git_cred *cred)
 	: m_cred(cred) {}
 GitCredentialResponse GitCredentialResponse::createForUsername(const QString &username)
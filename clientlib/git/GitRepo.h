@@ -17,6 +17,7 @@
 
 #include <QDir>
 #include <QUrl>
+#include <QVector>
 #include <functional>
 
 #include "task/Task.h"
@@ -25,6 +26,7 @@
 #include "Optional.h"
 
 struct git_repository;
+struct git_blob;
 struct git_cred;
 
 namespace Ralph {
@@ -109,6 +111,42 @@ private:
 	QString m_usernameFromUrl;
 };
 
+class GitDiffEntry
+{
+public:
+	enum Status
+	{
+		Added,
+		Modified,
+		Deleted
+	};
+
+	explicit GitDiffEntry(const Status status = Modified, const QString &path = QString())
+		: m_status(status), m_path(path) {}
+
+	Status status() const { return m_status; }
+	QString path() const { return m_path; }
+
+private:
+	Status m_status;
+	QString m_path;
+};
+
+class GitBlob
+{
+public:
+	explicit GitBlob(const QString &path = QString(), const GitResource<git_blob> &blob = GitResource<git_blob>())
+		: m_path(path), m_blob(blob) {}
+
+	QString path() const { return m_path; }
+	/// The content of the blob. Not a copy, so only valid as long as this (or a copy of this) object exists.
+	QByteArray data() const;
+
+private:
+	QString m_path;
+	GitResource<git_blob> m_blob;
+};
+
 class GitRepo
 {
 public:
@@ -116,15 +154,36 @@ public:
 
 	static Future<GitRepo *> init(const QDir &dir);
 	static Future<GitRepo *> open(const QDir &dir);
-	static Future<GitRepo *> clone(const QDir &dir, const QUrl &url);
+	/// A depth of 0 fetches the full history, anything else limits the history to that many commits
+	static Future<GitRepo *> clone(const QDir &dir, const QUrl &url, const bool bare = false, const int depth = 0);
+	/// Creates a bare mirror of all branches and tags of url in dir, or updates it if it already exists
+	static Future<GitRepo *> mirror(const QDir &dir, const QUrl &url);
+	/// Only fetches the given branch or tag (not a commit), which can afterwards be checked out using the same name
+	static Future<GitRepo *> cloneRef(const QDir &dir, const QUrl &url, const QString &ref, const int depth = 1);
+
+	/// Without support by libgit2 a depth is silently ignored, the full history is fetched instead
+	static bool supportsShallow();
+	static bool isCommitish(const QString &id);
 
 	QDir dir() const { return m_dir; }
+	/// @returns true if the history was cut off by a depth
+	bool isShallow() const;
+	void setOriginUrl(const QUrl &url) const;
 
-	Future<void> fetch() const;
+	/// With a ref only that branch or tag is fetched, like cloneRef does
+	Future<void> fetch(const int depth = 0, const QString &ref = QString()) const;
+	/// Checks out the commit id and detaches HEAD at it
 	Future<void> checkout(const QString &id) const;
-	Future<void> pull(const QString &id) const;
+	Future<void> pull(const QString &id, const int depth = 0) const;
 	Future<void> submodulesUpdate(const bool init = true) const;
 
+	/// @returns the id of the tree that id (anything git rev-parse understands) points to
+	Future<QString> treeId(const QString &id) const;
+	/// Files that differ between the two trees. Renames are reported as a deletion and an addition.
+	Future<QVector<GitDiffEntry>> diff(const QString &fromTree, const QString &toTree) const;
+	/// Reads all files of the tree (recursively, paths are relative to the tree) for which filter returns true
+	Future<QVector<GitBlob>> readBlobs(const QString &tree, const std::function<bool(const QString &)> &filter) const;
+
 	template <typename Func>
 	static void setCredentialsCallback(Func &&func)
 	{
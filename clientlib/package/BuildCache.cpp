@@ -0,0 +1,241 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BuildCache.h"
+
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QSysInfo>
+#include <QTemporaryFile>
+#include <mutex>
+
+#ifdef Q_OS_UNIX
+#include <utime.h>
+#endif
+
+#include <KArchive/KTar>
+
+#include "PackageMirror.h"
+#include "PackageConfiguration.h"
+#include "git/GitRepo.h"
+#include "task/Archive.h"
+#include "FileSystem.h"
+
+namespace Ralph {
+namespace ClientLib {
+
+// bump whenever the layout of the objects or what goes into the key changes
+static constexpr int cacheVersion = 2;
+
+static std::mutex instanceMutex;
+static std::shared_ptr<BuildCache> globalInstance;
+
+// the first line of --version is enough to tell different compilers and releases apart
+static QByteArray versionOf(const QString &program)
+{
+	QProcess proc;
+	proc.start(program, QStringList() << "--version", QProcess::ReadOnly);
+	if (!proc.waitForFinished(10000) || proc.exitStatus() != QProcess::NormalExit) {
+		proc.kill();
+		return QByteArray();
+	}
+	return proc.readAllStandardOutput().split('\n').first();
+}
+// everything outside of the package that influences the result of a build
+static QByteArray environment()
+{
+	static const QByteArray environment = [] {
+		const QString compiler = qEnvironmentVariableIsSet("CXX") ? QString::fromLocal8Bit(qgetenv("CXX")) : QStringLiteral("c++");
+		QByteArray out;
+		out += "os=" + QSysInfo::kernelType().toUtf8() + ' ' + QSysInfo::productType().toUtf8() + ' ' + QSysInfo::productVersion().toUtf8() + '\n';
+		out += "arch=" + QSysInfo::buildCpuArchitecture().toUtf8() + '\n';
+		out += "cc=" + qgetenv("CC") + '\n';
+		out += "cxx=" + compiler.toUtf8() + ' ' + versionOf(compiler) + '\n';
+		out += "cmake=" + versionOf("cmake") + '\n';
+		return out;
+	}();
+	return environment;
+}
+
+// the least recently used build is the one with the oldest modification time
+static void markUsed(const QString &filename)
+{
+#ifdef Q_OS_UNIX
+	::utime(QFile::encodeName(filename).constData(), nullptr);
+#else
+	Q_UNUSED(filename)
+#endif
+}
+
+// other processes may be looking for the same file, so it only ever appears through a rename
+static void publish(const QString &from, const QString &to)
+{
+	FS::ensureExists(QFileInfo(to).dir());
+	QTemporaryFile temp(to + ".XXXXXX");
+	if (!temp.open()) {
+		throw Exception("Unable to create a file next to %1: %2" % to % temp.errorString());
+	}
+	temp.close();
+	FS::copy(from, temp.fileName());
+	FS::move(temp.fileName(), to);
+}
+
+BuildCache::BuildCache(const QDir &dir, const QString &remote)
+	: m_dir(dir), m_remote(remote)
+{
+	FS::ensureExists(m_dir.absoluteFilePath("objects"));
+}
+
+std::shared_ptr<BuildCache> BuildCache::instance()
+{
+	std::lock_guard<std::mutex> lock(instanceMutex);
+	return globalInstance;
+}
+void BuildCache::setInstance(const std::shared_ptr<BuildCache> &cache)
+{
+	std::lock_guard<std::mutex> lock(instanceMutex);
+	globalInstance = cache;
+}
+
+Future<QString> BuildCache::sourceId(const QDir &dir)
+{
+	return async([dir](Notifier notifier)
+	{
+		if (!QFileInfo::exists(dir.absoluteFilePath(".git"))) {
+			return QString();
+		}
+		// submodules are part of the tree as the commits they point to
+		std::unique_ptr<Git::GitRepo> repo(notifier.await(Git::GitRepo::open(dir)));
+		return notifier.await(repo->treeId("HEAD"));
+	});
+}
+
+QString BuildCache::key(const PackageMirror &mirror, const PackageConfiguration &config, const QString &sourceId, const QDir &prefix)
+{
+	QCryptographicHash hash(QCryptographicHash::Sha256);
+	hash.addData(QByteArray::number(cacheVersion));
+	hash.addData(QByteArray(1, '\0'));
+	hash.addData(environment());
+	hash.addData(QByteArray(1, '\0'));
+	hash.addData(sourceId.toUtf8());
+	hash.addData(QByteArray(1, '\0'));
+	hash.addData(QJsonDocument(mirror.toJson()).toJson(QJsonDocument::Compact));
+	hash.addData(QByteArray(1, '\0'));
+	hash.addData(QJsonDocument(config.toJson()).toJson(QJsonDocument::Compact));
+	hash.addData(QByteArray(1, '\0'));
+	hash.addData(prefix.absolutePath().toUtf8());
+	return QString::fromLatin1(hash.result().toHex());
+}
+
+BuildCache::Statistics BuildCache::statistics() const
+{
+	return Statistics{m_hits, m_remoteHits, m_misses};
+}
+
+QString BuildCache::objectPath(const QString &key) const
+{
+	return m_dir.absoluteFilePath("objects/%1.tar.gz" % key);
+}
+QString BuildCache::remotePath(const QString &key) const
+{
+	return QDir(m_remote).absoluteFilePath("objects/%1.tar.gz" % key);
+}
+
+Future<bool> BuildCache::retrieve(const QString &key, const QDir &destination)
+{
+	return async([this, key, destination](Notifier notifier)
+	{
+		const QString object = objectPath(key);
+		bool remote = false;
+		if (!QFile::exists(object)) {
+			if (m_remote.isEmpty() || !QFile::exists(remotePath(key))) {
+				++m_misses;
+				return false;
+			}
+			notifier.status("Fetching the build from %1..." % m_remote);
+			publish(remotePath(key), object);
+			remote = true;
+		}
+
+		try {
+			notifier.await(Archive::extract(object, destination));
+		} catch (Archive::ArchiveException &e) {
+			notifier.status("Discarding the cached build: %1" % e.cause());
+			QFile::remove(object);
+			QDir(destination).removeRecursively();
+			FS::ensureExists(destination);
+			++m_misses;
+			return false;
+		}
+		markUsed(object);
+		if (remote) {
+			++m_remoteHits;
+		} else {
+			++m_hits;
+		}
+		return true;
+	});
+}
+
+Future<void> BuildCache::insert(const QString &key, const QDir &source)
+{
+	return async([this, key, source](Notifier notifier)
+	{
+		notifier.status("Storing the build in the build cache...");
+		const QString object = objectPath(key);
+		QTemporaryFile temp(object + ".XXXXXX");
+		if (!temp.open()) {
+			throw Exception("Unable to create a file next to %1: %2" % object % temp.errorString());
+		}
+		temp.close();
+
+		KTar tar(temp.fileName(), QStringLiteral("application/x-gzip"));
+		if (!tar.open(QIODevice::WriteOnly)) {
+			throw Exception("Unable to open %1 for writing" % temp.fileName());
+		}
+		if (!tar.addLocalDirectory(source.absolutePath(), QString()) || !tar.close()) {
+			throw Exception("Unable to pack %1" % source.absolutePath());
+		}
+		FS::move(temp.fileName(), object);
+		markUsed(object);
+
+		// the build is in the local cache already, the remote one is only a bonus
+		if (!m_remote.isEmpty()) {
+			try {
+				publish(object, remotePath(key));
+			} catch (Exception &e) {
+				notifier.status("Unable to store the build in %1: %2" % m_remote % e.cause());
+			}
+		}
+	});
+}
+
+int BuildCache::prune(const QDateTime &unusedSince)
+{
+	// leftovers of interrupted insertions are old too, the remote cache is left to whoever owns it
+	int removed = 0;
+	const QDir objects = m_dir.absoluteFilePath("objects");
+	for (const QFileInfo &object : objects.entryInfoList(QDir::Files)) {
+		if (object.lastModified() < unusedSince && QFile::remove(object.absoluteFilePath())) {
+			++removed;
+		}
+	}
+	return removed;
+}
+
+}
+}
@@ -0,0 +1,86 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <QDateTime>
+#include <QDir>
+#include <atomic>
+#include <memory>
+
+#include "task/Task.h"
+
+namespace Ralph {
+namespace ClientLib {
+class PackageMirror;
+class PackageConfiguration;
+
+/** Cache of install trees produced by source builds, so the same build only ever runs once
+ *
+ * A build is identified by its sources (the git tree that was checked out), the steps of the
+ * mirror, the configuration, the compiler, the operating system and the directory it is installed
+ * to, as install trees are not necessarily relocatable. Sources that are not under version control
+ * are not cached. The install tree is stored packed as objects/<key>.tar.gz, retrieving it marks
+ * it as used, and prune() removes what hasn't been used for a while.
+ *
+ * An optional remote directory, for example on a network share, is looked at if the local cache
+ * doesn't have a build, and receives a copy of everything that is built locally.
+ */
+class BuildCache
+{
+public:
+	explicit BuildCache(const QDir &dir, const QString &remote = QString());
+
+	/// The cache used by mirrors, nullptr (the default) to always build
+	static std::shared_ptr<BuildCache> instance();
+	static void setInstance(const std::shared_ptr<BuildCache> &cache);
+
+	/// Identifies the checked out sources in dir, an empty string if they aren't under version control
+	static Future<QString> sourceId(const QDir &dir);
+	static QString key(const PackageMirror &mirror, const PackageConfiguration &config, const QString &sourceId, const QDir &prefix);
+
+	struct Statistics
+	{
+		int hits;
+		int remoteHits;
+		int misses;
+	};
+
+	QDir dir() const { return m_dir; }
+	QString remote() const { return m_remote; }
+	Statistics statistics() const;
+
+	/// Unpacks the build for key into destination. @returns false on a miss
+	Future<bool> retrieve(const QString &key, const QDir &destination);
+	/// Packs the install tree in source as the build for key
+	Future<void> insert(const QString &key, const QDir &source);
+
+	/// Removes all local builds that have not been used since unusedSince. @returns the number of removed builds
+	int prune(const QDateTime &unusedSince);
+
+private:
+	const QDir m_dir;
+	const QString m_remote;
+
+	std::atomic<int> m_hits{0};
+	std::atomic<int> m_remoteHits{0};
+	std::atomic<int> m_misses{0};
+
+	QString objectPath(const QString &key) const;
+	QString remotePath(const QString &key) const;
+};
+
+}
+}
@@ -0,0 +1,114 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BuildTrees.h"
+
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLockFile>
+#include <QRegExp>
+#include <atomic>
+
+#include "Package.h"
+#include "PackageConfiguration.h"
+#include "FileSystem.h"
+#include "Json.h"
+
+namespace Ralph {
+namespace ClientLib {
+
+static std::atomic<bool> enabled{false};
+
+BuildTrees::BuildTrees(const QDir &dir)
+	: m_dir(dir)
+{
+	FS::ensureExists(m_dir);
+}
+
+bool BuildTrees::isEnabled()
+{
+	return enabled;
+}
+void BuildTrees::setEnabled(const bool enable)
+{
+	enabled = enable;
+}
+
+QString BuildTrees::key(const Package *pkg, const PackageConfiguration &config)
+{
+	// a build directory can only be reused with the same configuration
+	const QByteArray hash = QCryptographicHash::hash(QJsonDocument(config.toJson()).toJson(QJsonDocument::Compact), QCryptographicHash::Sha256);
+	const QString name = pkg->name().toLower().replace(QRegExp("[^a-z0-9_.+-]"), "_");
+	return "%1-%2" % name % QString::fromLatin1(hash.toHex().left(16));
+}
+
+QDir BuildTrees::treeDir(const QString &key) const
+{
+	return m_dir.absoluteFilePath(key);
+}
+QString BuildTrees::metadataFile(const QString &key) const
+{
+	return m_dir.absoluteFilePath(key + ".json");
+}
+
+Future<void> BuildTrees::use(const QString &key, const std::function<Future<void>(const QDir &)> &build)
+{
+	return async([this, key, build](Notifier notifier)
+	{
+		// installations into other groups, possibly in other processes, might want the same tree
+		QLockFile lock(treeDir(key).absolutePath() + ".lock");
+		lock.setStaleLockTime(0);
+		if (!lock.lock()) {
+			throw Exception("Unable to lock the build directory %1" % key);
+		}
+
+		// recorded up front, so a tree that is being used is never pruned
+		QJsonObject metadata;
+		metadata.insert("lastUsed", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+		Json::write(metadata, metadataFile(key));
+
+		// a failed build is kept too, the next attempt can continue from it
+		FS::ensureExists(treeDir(key));
+		notifier.await(build(treeDir(key)));
+	});
+}
+
+int BuildTrees::prune(const QDateTime &unusedSince)
+{
+	int removed = 0;
+	for (const QString &key : m_dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+		QDateTime lastUsed;
+		if (FS::exists(metadataFile(key))) {
+			lastUsed = QDateTime::fromString(Json::ensureString(Json::ensureObject(Json::ensureDocument(metadataFile(key))), "lastUsed", QString()), Qt::ISODate);
+		}
+		if (lastUsed.isValid() && lastUsed >= unusedSince) {
+			continue;
+		}
+
+		QLockFile lock(treeDir(key).absolutePath() + ".lock");
+		lock.setStaleLockTime(0);
+		if (!lock.tryLock()) {
+			continue;
+		}
+		FS::remove(treeDir(key));
+		QFile::remove(metadataFile(key));
+		++removed;
+	}
+	return removed;
+}
+
+}
+}
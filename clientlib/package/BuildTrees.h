@@ -0,0 +1,63 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <QDateTime>
+#include <QDir>
+#include <functional>
+
+#include "task/Task.h"
+
+namespace Ralph {
+namespace ClientLib {
+class Package;
+class PackageConfiguration;
+
+/** Build directories that are kept after an installation, so that an upgrade only rebuilds what changed
+ *
+ * There is one tree per package and configuration, independent of the version. The sources are
+ * updated in place (for git only the new commits are fetched), and the build tool picks up where
+ * the previous build left off. Every use is recorded in <key>.json, prune() removes the trees that
+ * haven't been used for a while.
+ */
+class BuildTrees
+{
+public:
+	explicit BuildTrees(const QDir &dir);
+
+	/// Whether package groups keep their build directories, off by default
+	static bool isEnabled();
+	static void setEnabled(const bool enabled);
+
+	static QString key(const Package *pkg, const PackageConfiguration &config);
+
+	QDir dir() const { return m_dir; }
+	QDir treeDir(const QString &key) const;
+
+	/// Calls build with the tree for key, nobody else uses that tree until build has finished
+	Future<void> use(const QString &key, const std::function<Future<void>(const QDir &)> &build);
+
+	/// Removes all trees that have not been used since unusedSince. @returns the number of removed trees
+	int prune(const QDateTime &unusedSince);
+
+private:
+	const QDir m_dir;
+
+	QString metadataFile(const QString &key) const;
+};
+
+}
+}
@@ -0,0 +1,282 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DependencyResolver.h"
+
+#include <QSet>
+#include <algorithm>
+
+#include "ActionContext.h"
+#include "Package.h"
+#include "PackageDatabase.h"
+#include "Requirement.h"
+
+namespace Ralph {
+namespace ClientLib {
+
+static bool satisfies(const VersionRequirement &requirement, const Version &version)
+{
+	return !requirement.isValid() || requirement.accepts(version);
+}
+static QString describe(const Package *pkg)
+{
+	return pkg->name() + ' ' + pkg->version().toString();
+}
+static QString describe(const QString &name, const VersionRequirement &requirement)
+{
+	return requirement.isValid() ? name + ' ' + requirement.toString() : name;
+}
+
+DependencyResolver::DependencyResolver(const Provider &provider, const PackageConfiguration &config)
+	: m_provider(provider), m_config(config) {}
+DependencyResolver::DependencyResolver(const PackageDatabase *db, const PackageConfiguration &config)
+	: DependencyResolver([db](const QString &name) { return db->findPackages(name); }, config) {}
+
+void DependencyResolver::require(const QString &name, const VersionRequirement &version)
+{
+	m_requirements.append(qMakePair(name, version));
+}
+
+QVector<PackageDependency> DependencyResolver::requiredDependencies(const Package *pkg, const PackageConfiguration &config)
+{
+	ActionContext ctxt;
+	ctxt.emplace<ConfigurationContextItem>(config);
+
+	QVector<PackageDependency> out;
+	for (const PackageDependency &dependency : pkg->dependencies()) {
+		if (!dependency.isOptional() && (!dependency.requirements() || dependency.requirements()->isSatisfied(ctxt))) {
+			out.append(dependency);
+		}
+	}
+	return out;
+}
+
+QVector<const Package *> DependencyResolver::candidates(const QString &name)
+{
+	auto it = m_candidates.find(name);
+	if (it == m_candidates.end()) {
+		QVector<const Package *> packages = m_provider(name);
+		std::stable_sort(packages.begin(), packages.end(), [](const Package *a, const Package *b) { return b->version() < a->version(); });
+		it = m_candidates.insert(name, packages);
+	}
+	return it.value();
+}
+QVector<PackageDependency> DependencyResolver::dependencies(const Package *pkg)
+{
+	auto it = m_dependencies.find(pkg);
+	if (it == m_dependencies.end()) {
+		it = m_dependencies.insert(pkg, requiredDependencies(pkg, m_config));
+	}
+	return it.value();
+}
+
+void DependencyResolver::addConstraint(const QString &name, const Constraint &constraint)
+{
+	auto it = m_constraints.find(name);
+	if (it == m_constraints.end()) {
+		m_names.append(name);
+		it = m_constraints.insert(name, {});
+	}
+	it.value().append(constraint);
+}
+void DependencyResolver::select(const Package *pkg)
+{
+	const int index = m_selected.size();
+	m_selectedIndex.insert(pkg->name().toLower(), index);
+	m_selected.append(pkg);
+	for (const PackageDependency &dependency : dependencies(pkg)) {
+		addConstraint(dependency.package().toLower(), Constraint{dependency.version(), index});
+	}
+}
+void DependencyResolver::backjump(const int index)
+{
+	// constraints are removed in the reverse order they were added in, so they are always the last ones
+	while (m_selected.size() > index) {
+		const Package *pkg = m_selected.takeLast();
+		m_selectedIndex.remove(pkg->name().toLower());
+		const QVector<PackageDependency> deps = dependencies(pkg);
+		for (auto it = deps.crbegin(); it != deps.crend(); ++it) {
+			m_constraints[it->package().toLower()].removeLast();
+		}
+	}
+}
+
+QVector<const Package *> DependencyResolver::resolve()
+{
+	m_conflicts.clear();
+	m_conflictsOf.clear();
+	m_decisions = 0;
+	m_selected.clear();
+	m_selectedIndex.clear();
+	m_constraints.clear();
+	m_names.clear();
+
+	for (const auto &requirement : m_requirements) {
+		addConstraint(requirement.first.toLower(), Constraint{requirement.second, -1});
+	}
+
+	while (true) {
+		QString name;
+		for (const QString &candidate : m_names) {
+			if (!m_selectedIndex.contains(candidate) && !m_constraints.value(candidate).isEmpty()) {
+				name = candidate;
+				break;
+			}
+		}
+		if (name.isNull()) {
+			break;
+		}
+
+		// the selections that (together) rule out versions of this package
+		QSet<int> reasons;
+		QVector<int> causes;
+		QStringList explanation;
+
+		const QVector<Constraint> constraints = m_constraints.value(name);
+		for (const Constraint &constraint : constraints) {
+			if (constraint.source < 0) {
+				explanation << "%1 is required" % describe(name, constraint.version);
+			} else {
+				reasons.insert(constraint.source);
+				explanation << "%1 depends on %2" % describe(m_selected.at(constraint.source)) % describe(name, constraint.version);
+			}
+		}
+
+		const QVector<const Package *> versions = candidates(name);
+		if (versions.isEmpty()) {
+			explanation << "there is no package named %1" % name;
+		}
+
+		const Package *choice = nullptr;
+		for (const Package *pkg : versions) {
+			if (!std::all_of(constraints.begin(), constraints.end(), [pkg](const Constraint &c) { return satisfies(c.version, pkg->version()); })) {
+				continue;
+			}
+
+			bool viable = true;
+			for (const PackageDependency &dependency : dependencies(pkg)) {
+				const int index = m_selectedIndex.value(dependency.package().toLower(), -1);
+				if (index >= 0 && !satisfies(dependency.version(), m_selected.at(index)->version())) {
+					reasons.insert(index);
+					explanation << "%1 depends on %2, but %3 is selected" % describe(pkg) % describe(dependency.package(), dependency.version()) % describe(m_selected.at(index));
+					viable = false;
+					break;
+				}
+			}
+
+			for (const int conflict : viable ? m_conflictsOf.value(pkg) : QVector<int>()) {
+				QVector<int> others;
+				const bool active = std::all_of(m_conflicts.at(conflict).packages.begin(), m_conflicts.at(conflict).packages.end(), [this, pkg, &others](const Package *other)
+				{
+					if (other == pkg) {
+						return true;
+					}
+					const int index = m_selectedIndex.value(other->name().toLower(), -1);
+					others.append(index);
+					return index >= 0 && m_selected.at(index) == other;
+				});
+				if (active) {
+					QStringList names;
+					for (const int other : others) {
+						reasons.insert(other);
+						names.append(describe(m_selected.at(other)));
+					}
+					causes.append(conflict);
+					if (names.isEmpty()) {
+						explanation << "%1 can not be used (conflict %2)" % describe(pkg) % (conflict + 1);
+					} else {
+						explanation << "%1 does not work together with %2 (conflict %3)" % describe(pkg) % names.join(", ") % (conflict + 1);
+					}
+					viable = false;
+					break;
+				}
+			}
+
+			if (viable) {
+				choice = pkg;
+				break;
+			}
+		}
+
+		if (choice) {
+			++m_decisions;
+			select(choice);
+			continue;
+		}
+
+		Conflict conflict;
+		conflict.explanation = QStringList("no version of %1 can be selected:" % name) + explanation;
+		conflict.causes = causes;
+		for (const int reason : reasons) {
+			conflict.packages.append(m_selected.at(reason));
+		}
+		m_conflicts.append(conflict);
+		const int index = m_conflicts.size() - 1;
+
+		if (reasons.isEmpty()) {
+			throw UnresolvableException(explain(index));
+		}
+		for (const Package *pkg : conflict.packages) {
+			m_conflictsOf[pkg].append(index);
+		}
+		backjump(*std::max_element(reasons.begin(), reasons.end()));
+	}
+
+	// dependencies first
+	QVector<const Package *> out;
+	QSet<const Package *> done;
+	std::function<void(const Package *)> visit = [this, &out, &done, &visit](const Package *pkg)
+	{
+		if (done.contains(pkg)) {
+			return;
+		}
+		done.insert(pkg);
+		for (const PackageDependency &dependency : dependencies(pkg)) {
+			visit(m_selected.at(m_selectedIndex.value(dependency.package().toLower())));
+		}
+		out.append(pkg);
+	};
+	for (const Package *pkg : m_selected) {
+		visit(pkg);
+	}
+	return out;
+}
+
+QString DependencyResolver::explain(const int conflict) const
+{
+	QVector<int> involved;
+	QVector<int> queue{conflict};
+	while (!queue.isEmpty()) {
+		const int current = queue.takeLast();
+		if (!involved.contains(current)) {
+			involved.append(current);
+			queue += m_conflicts.at(current).causes;
+		}
+	}
+	std::sort(involved.begin(), involved.end());
+
+	QStringList lines("Unable to find versions of all packages that fit together:");
+	for (const int index : involved) {
+		const QStringList explanation = m_conflicts.at(index).explanation;
+		lines << QString("%1 %2").arg(index == conflict ? QString("  =>") : "  (%1)" % (index + 1), explanation.first());
+		for (int i = 1; i < explanation.size(); ++i) {
+			lines << "        - " + explanation.at(i);
+		}
+	}
+	return lines.join('\n');
+}
+
+}
+}
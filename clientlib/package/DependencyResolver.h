@@ -0,0 +1,106 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QPair>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+
+#include "Exception.h"
+#include "Version.h"
+#include "PackageConfiguration.h"
+#include "PackageDependency.h"
+
+namespace Ralph {
+namespace ClientLib {
+class Package;
+class PackageDatabase;
+
+DECLARE_EXCEPTION(Unresolvable);
+
+/** Chooses one version of every package needed to fulfill a set of requirements
+ *
+ * Packages are selected one at a time, preferring newer versions. If no version of a package fits
+ * the selections that caused that are recorded as a conflict, which prevents trying the same
+ * combination again, and the search jumps back to the most recent of them. If a conflict does not
+ * depend on any selection there is no solution, and the chain of conflicts leading up to it is
+ * used to explain why.
+ */
+class DependencyResolver
+{
+public:
+	/// @returns all versions of the given package
+	using Provider = std::function<QVector<const Package *>(const QString &name)>;
+
+	explicit DependencyResolver(const Provider &provider, const PackageConfiguration &config = PackageConfiguration());
+	explicit DependencyResolver(const PackageDatabase *db, const PackageConfiguration &config = PackageConfiguration());
+
+	void require(const QString &name, const VersionRequirement &version = VersionRequirement());
+
+	/// @returns one package for every name that is (directly or indirectly) required, dependencies first
+	/// @throws UnresolvableException if there is no solution
+	QVector<const Package *> resolve();
+
+	// statistics about the last call to resolve
+	int decisions() const { return m_decisions; }
+	int conflicts() const { return m_conflicts.size(); }
+
+	/// @returns the dependencies of pkg that need to be installed in the given configuration
+	static QVector<PackageDependency> requiredDependencies(const Package *pkg, const PackageConfiguration &config);
+
+private:
+	struct Constraint
+	{
+		VersionRequirement version;
+		int source; // index into m_selected, -1 for requirements given to require()
+	};
+	struct Conflict
+	{
+		QVector<const Package *> packages; // may not all be selected at the same time
+		QStringList explanation;
+		QVector<int> causes; // earlier conflicts the explanation builds upon
+	};
+
+	Provider m_provider;
+	PackageConfiguration m_config;
+	QVector<QPair<QString, VersionRequirement>> m_requirements;
+
+	// caches, keys are lower case names
+	QHash<QString, QVector<const Package *>> m_candidates;
+	QHash<const Package *, QVector<PackageDependency>> m_dependencies;
+
+	QVector<Conflict> m_conflicts;
+	QHash<const Package *, QVector<int>> m_conflictsOf;
+	int m_decisions = 0;
+
+	// the current state of the search, keys are lower case names
+	QVector<const Package *> m_selected;
+	QHash<QString, int> m_selectedIndex;
+	QHash<QString, QVector<Constraint>> m_constraints;
+	QVector<QString> m_names;
+
+	QVector<const Package *> candidates(const QString &name);
+	QVector<PackageDependency> dependencies(const Package *pkg);
+	void addConstraint(const QString &name, const Constraint &constraint);
+	void select(const Package *pkg);
+	void backjump(const int index);
+	QString explain(const int conflict) const;
+};
+
+}
+}
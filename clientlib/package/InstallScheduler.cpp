@@ -0,0 +1,148 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "InstallScheduler.h"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+
+#include "DependencyResolver.h"
+#include "Functional.h"
+#include "Package.h"
+#include "PackageDatabase.h"
+#include "PackageDependency.h"
+
+namespace Ralph {
+using namespace Common;
+
+namespace ClientLib {
+
+InstallScheduler::InstallScheduler(const PackageDatabase *db, const PackageGroup &group, const PackageConfiguration &config)
+	: m_db(db), m_group(group), m_config(config) {}
+
+void InstallScheduler::add(const Package *pkg)
+{
+	if (m_dependencies.contains(pkg)) {
+		return;
+	}
+	// insert before recursing, so that cycles end here (they are reported by install)
+	m_dependencies.insert(pkg, {});
+	m_packages.append(pkg);
+
+	QVector<const Package *> dependencies;
+	for (const PackageDependency &dependency : DependencyResolver::requiredDependencies(pkg, m_config)) {
+		const Package *resolved = resolve(pkg, dependency);
+		add(resolved);
+		dependencies.append(resolved);
+	}
+	m_dependencies.insert(pkg, dependencies);
+}
+
+void InstallScheduler::pin(const QVector<const Package *> &packages)
+{
+	for (const Package *pkg : packages) {
+		m_pinned.insert(pkg->name().toLower(), pkg);
+	}
+}
+
+const Package *InstallScheduler::resolve(const Package *pkg, const PackageDependency &dependency) const
+{
+	const Package *pinned = m_pinned.value(dependency.package().toLower());
+	if (pinned && (!dependency.version().isValid() || dependency.version().accepts(pinned->version()))) {
+		return pinned;
+	}
+	const QVector<const Package *> candidates = m_db->findPackages(dependency.package(), dependency.version());
+	if (candidates.isEmpty()) {
+		throw Exception("No package found for the dependency %1 (%2) of %3" % dependency.package() % dependency.version().toString() % pkg->name());
+	}
+	return *std::max_element(candidates.begin(), candidates.end(), [](const Package *a, const Package *b) { return a->version() < b->version(); });
+}
+
+QVector<const Package *> InstallScheduler::order() const
+{
+	QVector<const Package *> out;
+	QHash<const Package *, bool> visited;
+	std::function<void(const Package *)> visit = [this, &out, &visited, &visit](const Package *pkg)
+	{
+		if (visited.contains(pkg)) {
+			if (!visited.value(pkg)) {
+				throw Exception("%1 depends on itself" % pkg->name());
+			}
+			return;
+		}
+		visited.insert(pkg, false);
+		Functional::each(m_dependencies.value(pkg), visit);
+		visited.insert(pkg, true);
+		out.append(pkg);
+	};
+	Functional::each(m_packages, visit);
+	return out;
+}
+
+Future<void> InstallScheduler::install(const std::size_t jobs) const
+{
+	return async([this, jobs](Notifier notifier)
+	{
+		// also checks for cycles, which would otherwise just leave packages uninstalled
+		const QVector<const Package *> packages = order();
+
+		// every installation runs once the installations of its dependencies finished, the executor limits how many run at once
+		Executor executor(jobs);
+		std::mutex mutex;
+		std::exception_ptr exception;
+		QHash<const Package *, Future<void>> futures;
+		for (const Package *pkg : packages) {
+			// order() puts dependencies first, so their futures exist already
+			QVector<Future<void>> dependencies;
+			for (const Package *dependency : m_dependencies.value(pkg)) {
+				dependencies.append(futures.constFind(dependency).value());
+			}
+			futures.insert(pkg, whenAll(dependencies, &executor).then([this, pkg, notifier, &mutex, &exception]()
+			{
+				{
+					// nothing new is started after a failure, but whatever is running is finished
+					std::lock_guard<std::mutex> lock(mutex);
+					if (exception) {
+						return;
+					}
+				}
+				try {
+					PackageGroup group = m_group;
+					notifier.await(group.install(pkg, m_config));
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(mutex);
+					if (!exception) {
+						exception = std::current_exception();
+					}
+				}
+			}, &executor));
+		}
+
+		// dependents of a failed installation fail with the same exception, which is reported below
+		for (Future<void> future : futures) {
+			try {
+				future.result();
+			} catch (...) {
+			}
+		}
+		if (exception) {
+			std::rethrow_exception(exception);
+		}
+	});
+}
+
+}
+}
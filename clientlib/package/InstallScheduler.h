@@ -0,0 +1,65 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QVector>
+
+#include "task/Task.h"
+#include "PackageGroup.h"
+#include "PackageConfiguration.h"
+
+namespace Ralph {
+namespace ClientLib {
+class Package;
+class PackageDatabase;
+class PackageDependency;
+
+/** Installs packages together with their dependencies into a group
+ *
+ * Installations that do not depend on each other run concurrently, but a package is only
+ * installed once all of its dependencies are.
+ */
+class InstallScheduler
+{
+public:
+	explicit InstallScheduler(const PackageDatabase *db, const PackageGroup &group, const PackageConfiguration &config);
+
+	/// Adds the package and (recursively) all dependencies of it that are required for the configuration
+	void add(const Package *pkg);
+	/// Dependencies on any of these packages (usually from DependencyResolver) use them instead of the newest version
+	void pin(const QVector<const Package *> &packages);
+
+	/// @returns all added packages, dependencies before the packages depending on them
+	QVector<const Package *> order() const;
+
+	/// @param jobs the maximum number of concurrent installations, 0 means one per core
+	Future<void> install(const std::size_t jobs = 0) const;
+
+private:
+	const PackageDatabase *m_db;
+	PackageGroup m_group;
+	PackageConfiguration m_config;
+
+	QVector<const Package *> m_packages;
+	QHash<const Package *, QVector<const Package *>> m_dependencies;
+	QHash<QString, const Package *> m_pinned;
+
+	const Package *resolve(const Package *pkg, const PackageDependency &dependency) const;
+};
+
+}
+}
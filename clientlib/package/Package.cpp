@@ -15,6 +15,8 @@
 
 #include "Package.h"
 
+#include <QDataStream>
+
 #include "Json.h"
 #include "Functional.h"
 #include "PackageMirror.h"
@@ -70,5 +72,26 @@ const Package *Package::fromJson(const QJsonDocument &doc, Package *package)
 	}
 }
 
+QDataStream &operator<<(QDataStream &str, const Package &package)
+{
+	return str << package.name() << package.version() << package.paths() << package.dependencies() << package.mirrors();
+}
+QDataStream &operator>>(QDataStream &str, Package &package)
+{
+	QString name;
+	Version version;
+	QHash<QString, QString> paths;
+	QVector<PackageDependency> dependencies;
+	QVector<PackageMirror> mirrors;
+	str >> name >> version >> paths >> dependencies >> mirrors;
+
+	package.setName(name);
+	package.setVersion(version);
+	package.setPaths(paths);
+	package.setDependencies(dependencies);
+	package.setMirrors(mirrors);
+	return str;
+}
+
 }
 }
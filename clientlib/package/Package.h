@@ -25,6 +25,7 @@
 
 class QJsonDocument;
 class QJsonObject;
+class QDataStream;
 
 namespace Ralph {
 namespace ClientLib {
@@ -63,5 +64,8 @@ private:
 	QHash<QString, QString> m_paths;
 };
 
+QDataStream &operator<<(QDataStream &str, const Package &package);
+QDataStream &operator>>(QDataStream &str, Package &package);
+
 }
 }
@@ -16,6 +16,7 @@
 #include "PackageConfiguration.h"
 
 #include <QRegularExpression>
+#include <QDataStream>
 
 #include "Json.h"
 
@@ -86,5 +87,14 @@ PackageConfiguration PackageConfiguration::fromJson(const QJsonObject &obj)
 	return config;
 }
 
+QDataStream &operator<<(QDataStream &str, const PackageConfiguration &config)
+{
+	return str << config.m_values;
+}
+QDataStream &operator>>(QDataStream &str, PackageConfiguration &config)
+{
+	return str >> config.m_values;
+}
+
 }
 }
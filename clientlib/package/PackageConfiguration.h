@@ -18,6 +18,10 @@
 #include <QHash>
 #include <QVariant>
 
+QT_BEGIN_NAMESPACE
+class QDataStream;
+QT_END_NAMESPACE
+
 namespace Ralph {
 namespace ClientLib {
 
@@ -60,6 +64,9 @@ public: // serialization
 	QJsonObject toJson() const;
 	static PackageConfiguration fromJson(const QJsonObject &obj);
 
+	friend QDataStream &operator<<(QDataStream &str, const PackageConfiguration &config);
+	friend QDataStream &operator>>(QDataStream &str, PackageConfiguration &config);
+
 private:
 	QHash<QString, QVariant> m_values;
 };
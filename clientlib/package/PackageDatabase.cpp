@@ -15,11 +15,11 @@
 
 #include "PackageDatabase.h"
 
-#include <QDataStream>
 #include <QStandardPaths>
 
 #include "Functional.h"
 #include "Exception.h"
+#include "FileSystem.h"
 #include "Json.h"
 #include "PackageSource.h"
 #include "PackageGroup.h"
@@ -117,7 +117,7 @@ void PackageDatabase::load()
 
 		m_groups = Functional::map(ensureIsArrayOf<QJsonObject>(root, "groups", QVector<QJsonObject>()), [this](const QJsonObject &obj)
 		{
-			return PackageGroup{ensureString(obj, "name"), m_dir.absoluteFilePath(ensureString(obj, "dir"))};
+			return PackageGroup{ensureString(obj, "name"), m_dir.absoluteFilePath(ensureString(obj, "dir")), cacheDir()};
 		});
 	}
 }
@@ -143,24 +143,23 @@ Future<void> PackageDatabase::build()
 	{
 		QMutexLocker locker(&m_mutex);
 
-		// step 1: read the cache and check if we actually changed
+		// step 1: open the index and check if we actually changed
 		{
-			QFile f(m_dir.absoluteFilePath("cache.dat"));
-			if (f.open(QFile::ReadOnly)) {
-				QDataStream str(&f);
-				QHash<QString, QDateTime> cacheSources;
-				str >> cacheSources;
-
-				QHash<QString, QDateTime> currentSources;
-				for (const PackageSource *src : m_sources) {
-					currentSources.insert(src->name(), src->lastUpdated());
-				}
-
-				if (cacheSources == currentSources) {
-					// TODO read the packages from the cache
-					return;
+			std::unique_ptr<PackageIndex> index = std::make_unique<PackageIndex>(m_dir.absoluteFilePath("cache.dat"));
+			if (index->open() && index->sources() == sourceTimestamps()) {
+				if (m_index) {
+					m_retiredPackages.append(m_index->takeMaterialized());
 				}
+				m_index = std::move(index);
+				m_packages.clear();
+				m_packageMapping.clear();
+				return;
+			}
+			// needs to be unmapped before it can be replaced, but packages that were handed out have to stay valid
+			if (m_index) {
+				m_retiredPackages.append(m_index->takeMaterialized());
 			}
+			m_index.reset();
 		}
 
 		// step 2: read all packages from all sources
@@ -176,18 +175,37 @@ Future<void> PackageDatabase::build()
 					.tap([this](const Package *pkg) { m_packageMapping.insert(pkg->name().toLower(), pkg); });
 		}
 
-		// step 3: write the cache
-		{
-			// TODO write packages into the cache.dat file
-			// wait until it's actually needed though
+		// step 3: write the index, and use it from now on like when it was up to date in the first place
+		if (!isReadonly()) {
+			PackageIndex::write(m_dir.absoluteFilePath("cache.dat"), sourceTimestamps(), m_packages);
+			std::unique_ptr<PackageIndex> index = std::make_unique<PackageIndex>(m_dir.absoluteFilePath("cache.dat"));
+			if (index->open()) {
+				m_index = std::move(index);
+				m_packages.clear();
+				m_packageMapping.clear();
+			}
 		}
 	});
 }
 
+QHash<QString, QDateTime> PackageDatabase::sourceTimestamps() const
+{
+	QHash<QString, QDateTime> timestamps;
+	for (const PackageSource *src : m_sources) {
+		timestamps.insert(src->name(), src->lastUpdated());
+	}
+	return timestamps;
+}
 const Package *PackageDatabase::getPackage(const QString &name, const Version &version) const
 {
 	QMutexLocker locker(&m_mutex);
-	for (const Package *pkg : m_packageMapping.values(name)) {
+	if (m_index) {
+		const Package *pkg = m_index->get(name, version);
+		if (pkg) {
+			return pkg;
+		}
+	}
+	for (const Package *pkg : m_packageMapping.values(name.toLower())) {
 		if (pkg->version() == version) {
 			return pkg;
 		}
@@ -204,6 +222,9 @@ QVector<const Package *> PackageDatabase::findPackages(const QString &name, cons
 {
 	QMutexLocker locker(&m_mutex);
 	QVector<const Package *> out;
+	if (m_index) {
+		out.append(m_index->find(name, version));
+	}
 	out.append(Functional::filter2<QVector<const Package *>>(m_packageMapping.values(name.toLower()), [version](const Package *pkg) { return !version.isValid() || version.accepts(pkg->version()); }));
 	for (const PackageDatabase *db : m_inherits) {
 		out.append(db->findPackages(name, version));
@@ -214,7 +235,7 @@ QVector<const Package *> PackageDatabase::findPackages(const QString &name, cons
 QVector<QString> PackageDatabase::packageNames() const
 {
 	QMutexLocker locker(&m_mutex);
-	return m_packageMapping.keys().toVector();
+	return m_index ? m_index->names() : m_packageMapping.uniqueKeys().toVector();
 }
 
 PackageSource *PackageDatabase::source(const QString &name) const
@@ -264,6 +285,22 @@ Future<void> PackageDatabase::unregisterPackageSource(const QString &name)
 	});
 }
 
+Future<void> PackageDatabase::updateSources(const QVector<PackageSource *> &sources)
+{
+	return async([this, sources](Notifier notifier)
+	{
+		QMutexLocker locker(&m_mutex);
+		for (PackageSource *source : sources) {
+			notifier.status("Updating %1 source %2..." % source->typeString() % source->name());
+			notifier.await(source->update());
+		}
+
+		// the new timestamps invalidate the cache
+		save();
+		notifier.await(build());
+	});
+}
+
 PackageGroup PackageDatabase::group(const QString &name)
 {
 	if (name.isNull()) {
@@ -276,7 +313,7 @@ PackageGroup PackageDatabase::group(const QString &name)
 		}
 	}
 
-	PackageGroup newGroup = PackageGroup{name, m_dir.absoluteFilePath("groups/%1" % name.toLower().replace(QRegExp("[^a-zA-Z0-9-_]"), ""))};
+	PackageGroup newGroup = PackageGroup{name, m_dir.absoluteFilePath("groups/%1" % name.toLower().replace(QRegExp("[^a-zA-Z0-9-_]"), "")), cacheDir()};
 	m_groups.append(newGroup);
 	save();
 	return newGroup;
@@ -20,6 +20,7 @@
 
 #include "task/Task.h"
 #include "PackageGroup.h"
+#include "PackageIndex.h"
 #include "Version.h"
 
 namespace Ralph {
@@ -50,15 +51,21 @@ public:
 	QVector<PackageSource *> sources() const { return m_sources; }
 	Future<void> registerPackageSource(PackageSource *source);
 	Future<void> unregisterPackageSource(const QString &name);
+	Future<void> updateSources(const QVector<PackageSource *> &sources);
 
 	QVector<PackageDatabase *> inheritedDatabases() const { return m_inherits; }
 
 	PackageGroup group(const QString &name = QString());
 	QVector<PackageGroup> groups() const { return m_groups; }
 
+	/// Caches shared by all groups of this database
+	QDir cacheDir() const { return m_dir.absoluteFilePath("cache"); }
+
 private: // internal
 	void save();
 
+	QHash<QString, QDateTime> sourceTimestamps() const;
+
 private: // static/on creation
 	const QDir m_dir;
 	const QVector<PackageDatabase *> m_inherits;
@@ -69,8 +76,12 @@ private: // settings, semi-static
 
 private: // packages, semi-static
 	mutable QMutex m_mutex;
+	// either the index is used, or (directly after building it) the in-memory list
+	std::unique_ptr<PackageIndex> m_index;
 	QVector<const Package *> m_packages;
 	QMultiHash<QString, const Package *> m_packageMapping;
+	// packages handed out by replaced indexes, they stay valid as long as the database exists
+	QVector<const Package *> m_retiredPackages;
 };
 
 }
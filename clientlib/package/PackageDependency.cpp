@@ -15,6 +15,8 @@
 
 #include "PackageDependency.h"
 
+#include <QDataStream>
+
 #include "Json.h"
 #include "Functional.h"
 #include "PackageSource.h"
@@ -71,5 +73,31 @@ PackageDependency PackageDependency::fromJson(const QJsonObject &obj)
 	return dep;
 }
 
+QDataStream &operator<<(QDataStream &str, const PackageDependency &dependency)
+{
+	str << dependency.package() << dependency.version() << dependency.isOptional()
+		<< dependency.requirements() << dependency.config();
+	str << (dependency.source() ? Json::toBinary(dependency.source()->toJson()) : QByteArray());
+	return str;
+}
+QDataStream &operator>>(QDataStream &str, PackageDependency &dependency)
+{
+	QString package;
+	VersionRequirement version;
+	bool optional;
+	RequirementPtr requirements;
+	PackageConfiguration config;
+	QByteArray source;
+	str >> package >> version >> optional >> requirements >> config >> source;
+
+	dependency.setPackage(package);
+	dependency.setVersion(version);
+	dependency.setOptional(optional);
+	dependency.setRequirements(requirements);
+	dependency.setConfig(config);
+	dependency.setSource(source.isEmpty() ? nullptr : PackageSource::fromJson(QJsonDocument::fromBinaryData(source).object()));
+	return str;
+}
+
 }
 }
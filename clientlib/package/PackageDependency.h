@@ -21,6 +21,7 @@
 #include "PackageConfiguration.h"
 
 class QJsonObject;
+class QDataStream;
 
 namespace Ralph {
 namespace ClientLib {
@@ -57,10 +58,13 @@ private:
 	QString m_package;
 	VersionRequirement m_version;
 	RequirementPtr m_requirements;
-	bool m_optional;
-	PackageSource *m_source;
+	bool m_optional = false;
+	PackageSource *m_source = nullptr;
 	PackageConfiguration m_config;
 };
 
+QDataStream &operator<<(QDataStream &str, const PackageDependency &dependency);
+QDataStream &operator>>(QDataStream &str, PackageDependency &dependency);
+
 }
 }
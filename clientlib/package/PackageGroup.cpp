@@ -16,11 +16,14 @@
 #include "PackageGroup.h"
 
 #include <QTemporaryDir>
+#include <mutex>
 
 #include "ActionContext.h"
 #include "Json.h"
 #include "Package.h"
 #include "PackageMirror.h"
+#include "PackageStore.h"
+#include "BuildTrees.h"
 #include "Functional.h"
 #include "FileSystem.h"
 
@@ -29,8 +32,11 @@ using namespace Common;
 
 namespace ClientLib {
 
-PackageGroup::PackageGroup(const QString &name, const QDir &dir)
-	: m_name(name), m_dir(dir)
+// installations may run concurrently, but meta.json has to be read, modified and written in one go
+static std::mutex settingsMutex;
+
+PackageGroup::PackageGroup(const QString &name, const QDir &dir, const QDir &cacheDir)
+	: m_name(name), m_dir(dir), m_cacheDir(cacheDir)
 {
 	FS::ensureExists(dir);
 }
@@ -39,22 +45,60 @@ Future<void> PackageGroup::install(const Package *pkg, const PackageConfiguratio
 {
 	return async([this, pkg, config](Notifier notifier)
 	{
-		readSettings();
-		if (isInstalled(pkg)) {
-			notifier.status("%1 is already installed!" % pkg->name());
-			return;
+		{
+			std::lock_guard<std::mutex> lock(settingsMutex);
+			readSettings();
+			if (isInstalled(pkg)) {
+				notifier.status("%1 is already installed!" % pkg->name());
+				return;
+			}
 		}
 
-		notifier.status("Installing %1 into %2..." % pkg->name() % m_name);
-
-		QTemporaryDir buildDir;
+		const QDir cacheDir = m_cacheDir;
+		const auto installTo = [pkg, config, cacheDir](const QDir &dir)
+		{
+			const auto build = [pkg, config, cacheDir, dir](const QDir &buildDir)
+			{
+				return async([pkg, config, cacheDir, dir, buildDir](Notifier notifier)
+				{
+					ActionContext ctxt;
+					ctxt.emplace<InstallContextItem>(dir, buildDir);
+					ctxt.emplace<ConfigurationContextItem>(config);
+					ctxt.emplace<CacheContextItem>(cacheDir);
+					notifier.await(pkg->mirrors().first().install(ctxt));
+				});
+			};
+
+			return async([pkg, config, cacheDir, build](Notifier notifier)
+			{
+				if (BuildTrees::isEnabled()) {
+					BuildTrees trees(cacheDir.absoluteFilePath("builds"));
+					notifier.await(trees.use(BuildTrees::key(pkg, config), build));
+				} else {
+					QTemporaryDir buildDir;
+					notifier.await(build(buildDir.path()));
+				}
+			});
+		};
 
-		ActionContext ctxt;
-		ctxt.emplace<InstallContextItem>(installDir(pkg), buildDir.path());
-		ctxt.emplace<ConfigurationContextItem>(config);
-		notifier.await(pkg->mirrors().first().install(ctxt));
+		QString storeKey;
+		const std::shared_ptr<PackageStore> store = PackageStore::instance();
+		if (store) {
+			storeKey = PackageStore::key(pkg, pkg->mirrors().first(), config);
+			if (store->contains(storeKey)) {
+				notifier.status("Linking %1 into %2 from the package store..." % pkg->name() % m_name);
+			} else {
+				notifier.status("Installing %1 into %2..." % pkg->name() % m_name);
+			}
+			notifier.await(store->ensure(storeKey, installDir(pkg), installTo));
+		} else {
+			notifier.status("Installing %1 into %2..." % pkg->name() % m_name);
+			notifier.await(installTo(installDir(pkg)));
+		}
 
-		m_installed.append(InstalledPackage{pkg, 0, config});
+		std::lock_guard<std::mutex> lock(settingsMutex);
+		readSettings();
+		m_installed.append(InstalledPackage{pkg, 0, config, storeKey});
 		writeSettings();
 	});
 }
@@ -62,6 +106,7 @@ Future<void> PackageGroup::remove(const Package *pkg)
 {
 	return async([this, pkg](Notifier notifier)
 	{
+		std::lock_guard<std::mutex> lock(settingsMutex);
 		readSettings();
 		if (!isInstalled(pkg)) {
 			notifier.status("%1 is not installed!" % pkg->name());
@@ -70,6 +115,11 @@ Future<void> PackageGroup::remove(const Package *pkg)
 
 		notifier.status("Removing %1 from %2..." % pkg->name() % m_name);
 
+		// only removes the link, the store entry stays until it is pruned
+		const std::shared_ptr<PackageStore> store = PackageStore::instance();
+		if (store && !findInstalled(pkg)->storeKey.isEmpty()) {
+			store->unlink(findInstalled(pkg)->storeKey, installDir(pkg));
+		}
 		FS::remove(baseDir(pkg));
 
 		m_installed.erase(findInstalled(pkg));
@@ -104,7 +154,8 @@ void PackageGroup::readSettings()
 		return InstalledPackage{
 					Package::fromJson(QJsonDocument(Json::ensureObject(obj, "pkg"))),
 					Json::ensureInteger(obj, "mirrorIndex"),
-					PackageConfiguration::fromJson(Json::ensureObject(obj, "config"))
+					PackageConfiguration::fromJson(Json::ensureObject(obj, "config")),
+					Json::ensureString(obj, "storeKey", QString())
 		};
 	});
 }
@@ -117,6 +168,9 @@ void PackageGroup::writeSettings() const
 		obj.insert("pkg", pkg.pkg->toJson());
 		obj.insert("mirrorIndex", pkg.mirrorIndex);
 		obj.insert("config", pkg.config.toJson());
+		if (!pkg.storeKey.isEmpty()) {
+			obj.insert("storeKey", pkg.storeKey);
+		}
 		return obj;
 	})));
 	Json::write(root, m_dir.absoluteFilePath("meta.json"));
@@ -28,7 +28,7 @@ class Package;
 class PackageGroup
 {
 public:
-	explicit PackageGroup(const QString &name, const QDir &dir);
+	explicit PackageGroup(const QString &name, const QDir &dir, const QDir &cacheDir);
 	explicit PackageGroup() {}
 
 	QString name() const { return m_name; }
@@ -45,6 +45,7 @@ public:
 private: // static
 	QString m_name;
 	QDir m_dir;
+	QDir m_cacheDir;
 
 private: // from storage
 	void readSettings();
@@ -55,6 +56,7 @@ private: // from storage
 		const Package *pkg;
 		int mirrorIndex;
 		PackageConfiguration config;
+		QString storeKey; // empty if installed directly into the group
 	};
 	QVector<InstalledPackage> m_installed;
 
@@ -0,0 +1,283 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PackageIndex.h"
+
+#include <QDataStream>
+#include <QMap>
+#include <QtEndian>
+#include <limits>
+
+#include "Exception.h"
+#include "FileSystem.h"
+#include "Package.h"
+
+namespace Ralph {
+namespace ClientLib {
+
+// bump indexVersion whenever the layout or the streamed representation of Package (or anything it contains) changes
+static constexpr quint32 indexMagic = 0x524c5049; // RLPI
+static constexpr quint32 indexVersion = 4;
+static constexpr QDataStream::Version indexStreamVersion = QDataStream::Qt_5_5;
+
+// all integers are little endian quint32
+// header: magic, version, sources offset, sources size, name count, names offset, entry count, entries offset
+static constexpr quint32 headerSize = 8 * 4;
+// name: name offset, name length, first entry, entry count
+static constexpr quint32 nameSize = 4 * 4;
+// entry: packed version offset, packed version length, record offset, record length
+static constexpr quint32 entrySize = 4 * 4;
+
+static inline quint32 readUInt32(const uchar *data, const quint32 index = 0)
+{
+	return qFromLittleEndian<quint32>(data + index * 4);
+}
+static inline void appendUInt32(QByteArray &data, const quint32 value)
+{
+	uchar buffer[4];
+	qToLittleEndian(value, buffer);
+	data.append(reinterpret_cast<const char *>(buffer), 4);
+}
+
+PackageIndex::PackageIndex(const QString &filename)
+	: m_file(filename) {}
+
+PackageIndex::~PackageIndex()
+{
+	qDeleteAll(m_materialized);
+}
+
+bool PackageIndex::open()
+{
+	if (!m_file.open(QFile::ReadOnly) || m_file.size() < qint64(headerSize) || m_file.size() > qint64(std::numeric_limits<quint32>::max())) {
+		return false;
+	}
+	m_size = quint32(m_file.size());
+	m_data = m_file.map(0, m_size);
+	if (m_data && !validate()) {
+		m_file.unmap(const_cast<uchar *>(m_data));
+		m_data = nullptr;
+	}
+	return isOpen();
+}
+
+bool PackageIndex::validate()
+{
+	const auto fits = [this](const quint64 offset, const quint64 size) { return offset + size <= m_size; };
+
+	if (readUInt32(m_data, 0) != indexMagic || readUInt32(m_data, 1) != indexVersion) {
+		return false;
+	}
+
+	const quint32 sourcesOffset = readUInt32(m_data, 2);
+	const quint32 sourcesSize = readUInt32(m_data, 3);
+	m_nameCount = readUInt32(m_data, 4);
+	const quint32 namesOffset = readUInt32(m_data, 5);
+	m_entryCount = readUInt32(m_data, 6);
+	const quint32 entriesOffset = readUInt32(m_data, 7);
+	if (!fits(sourcesOffset, sourcesSize) || !fits(namesOffset, quint64(m_nameCount) * nameSize) || !fits(entriesOffset, quint64(m_entryCount) * entrySize)) {
+		return false;
+	}
+	m_names = m_data + namesOffset;
+	m_entries = m_data + entriesOffset;
+
+	QDataStream str(QByteArray::fromRawData(reinterpret_cast<const char *>(m_data + sourcesOffset), int(sourcesSize)));
+	str.setVersion(indexStreamVersion);
+	str >> m_sources;
+	return str.status() == QDataStream::Ok;
+}
+
+QByteArray PackageIndex::string(const quint32 offset, const quint32 length) const
+{
+	if (quint64(offset) + length > m_size) {
+		throw Exception("Corrupt package index: %1" % m_file.fileName());
+	}
+	return QByteArray::fromRawData(reinterpret_cast<const char *>(m_data + offset), int(length));
+}
+
+int PackageIndex::findName(const QByteArray &name) const
+{
+	quint32 first = 0;
+	quint32 last = m_nameCount;
+	while (first < last) {
+		const quint32 middle = first + (last - first) / 2;
+		const uchar *entry = m_names + middle * nameSize;
+		const QByteArray candidate = string(readUInt32(entry, 0), readUInt32(entry, 1));
+		if (candidate < name) {
+			first = middle + 1;
+		} else if (name < candidate) {
+			last = middle;
+		} else {
+			return int(middle);
+		}
+	}
+	return -1;
+}
+
+void PackageIndex::entryRange(const quint32 name, quint32 &first, quint32 &last) const
+{
+	const uchar *entry = m_names + name * nameSize;
+	first = readUInt32(entry, 2);
+	last = first + readUInt32(entry, 3);
+	if (last < first || last > m_entryCount) {
+		throw Exception("Corrupt package index: %1" % m_file.fileName());
+	}
+}
+
+Version PackageIndex::entryVersion(const quint32 entry) const
+{
+	const uchar *data = m_entries + entry * entrySize;
+	return Version::fromPacked(string(readUInt32(data, 0), readUInt32(data, 1)));
+}
+
+const Package *PackageIndex::materialize(const quint32 entry) const
+{
+	auto it = m_materialized.find(entry);
+	if (it != m_materialized.end()) {
+		return it.value();
+	}
+
+	const uchar *data = m_entries + entry * entrySize;
+	QDataStream str(string(readUInt32(data, 2), readUInt32(data, 3)));
+	str.setVersion(indexStreamVersion);
+	std::unique_ptr<Package> package = std::make_unique<Package>();
+	str >> *package;
+	if (str.status() != QDataStream::Ok) {
+		throw Exception("Corrupt package index: %1" % m_file.fileName());
+	}
+	return m_materialized.insert(entry, package.release()).value();
+}
+
+QVector<const Package *> PackageIndex::takeMaterialized()
+{
+	const QVector<const Package *> out = m_materialized.values().toVector();
+	m_materialized.clear();
+	return out;
+}
+
+QVector<QString> PackageIndex::names() const
+{
+	QVector<QString> out;
+	out.reserve(int(m_nameCount));
+	for (quint32 i = 0; i < m_nameCount; ++i) {
+		const uchar *entry = m_names + i * nameSize;
+		out.append(QString::fromUtf8(string(readUInt32(entry, 0), readUInt32(entry, 1))));
+	}
+	return out;
+}
+
+const Package *PackageIndex::get(const QString &name, const Version &version) const
+{
+	const int index = findName(name.toLower().toUtf8());
+	if (index < 0) {
+		return nullptr;
+	}
+	quint32 first, last;
+	entryRange(quint32(index), first, last);
+	for (quint32 i = first; i < last; ++i) {
+		if (entryVersion(i) == version) {
+			return materialize(i);
+		}
+	}
+	return nullptr;
+}
+QVector<const Package *> PackageIndex::find(const QString &name, const VersionRequirement &version) const
+{
+	QVector<const Package *> out;
+	const int index = findName(name.toLower().toUtf8());
+	if (index < 0) {
+		return out;
+	}
+	quint32 first, last;
+	entryRange(quint32(index), first, last);
+	for (quint32 i = first; i < last; ++i) {
+		if (!version.isValid() || version.accepts(entryVersion(i))) {
+			out.append(materialize(i));
+		}
+	}
+	return out;
+}
+
+void PackageIndex::write(const QString &filename, const QHash<QString, QDateTime> &sources, const QVector<const Package *> &packages)
+{
+	QMap<QByteArray, QVector<const Package *>> byName;
+	for (const Package *pkg : packages) {
+		byName[pkg->name().toLower().toUtf8()].append(pkg);
+	}
+
+	QByteArray sourcesData;
+	{
+		QDataStream str(&sourcesData, QIODevice::WriteOnly);
+		str.setVersion(indexStreamVersion);
+		str << sources;
+	}
+
+	const quint32 namesOffset = headerSize + quint32(sourcesData.size());
+	const quint32 entriesOffset = namesOffset + quint32(byName.size()) * nameSize;
+	const quint32 blobsOffset = entriesOffset + quint32(packages.size()) * entrySize;
+
+	QByteArray names;
+	QByteArray entries;
+	QByteArray blobs;
+	auto appendBlob = [&blobs, blobsOffset](const QByteArray &blob)
+	{
+		const quint32 offset = blobsOffset + quint32(blobs.size());
+		blobs.append(blob);
+		return offset;
+	};
+
+	quint32 entryIndex = 0;
+	for (auto it = byName.constBegin(); it != byName.constEnd(); ++it) {
+		appendUInt32(names, appendBlob(it.key()));
+		appendUInt32(names, quint32(it.key().size()));
+		appendUInt32(names, entryIndex);
+		appendUInt32(names, quint32(it.value().size()));
+
+		for (const Package *pkg : it.value()) {
+			const QByteArray version = pkg->version().toPacked();
+			QByteArray record;
+			{
+				QDataStream str(&record, QIODevice::WriteOnly);
+				str.setVersion(indexStreamVersion);
+				str << *pkg;
+			}
+
+			appendUInt32(entries, appendBlob(version));
+			appendUInt32(entries, quint32(version.size()));
+			appendUInt32(entries, appendBlob(record));
+			appendUInt32(entries, quint32(record.size()));
+			++entryIndex;
+		}
+	}
+
+	QByteArray data;
+	data.reserve(int(blobsOffset) + blobs.size());
+	appendUInt32(data, indexMagic);
+	appendUInt32(data, indexVersion);
+	appendUInt32(data, headerSize);
+	appendUInt32(data, quint32(sourcesData.size()));
+	appendUInt32(data, quint32(byName.size()));
+	appendUInt32(data, namesOffset);
+	appendUInt32(data, entryIndex);
+	appendUInt32(data, entriesOffset);
+	data.append(sourcesData);
+	data.append(names);
+	data.append(entries);
+	data.append(blobs);
+	FS::write(filename, data);
+}
+
+}
+}
@@ -0,0 +1,82 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <QFile>
+#include <QHash>
+#include <QDateTime>
+#include <QVector>
+
+#include "Version.h"
+
+namespace Ralph {
+namespace ClientLib {
+class Package;
+
+/** Read-only, memory mapped index of all packages in a database
+ *
+ * The file consists of a fixed header, the source timestamps it was built from, a table of
+ * package names sorted by their (lower case) UTF-8 representation, one entry per package
+ * containing the location of the already parsed version (see Version::toPacked) and of the full
+ * record, and finally the records themselves (as written by the QDataStream operators of Package).
+ *
+ * Opening only maps the file and checks the header, records are turned into Package objects
+ * the first time they are requested. Not thread safe, PackageDatabase does the locking.
+ */
+class PackageIndex
+{
+public:
+	explicit PackageIndex(const QString &filename);
+	~PackageIndex();
+
+	bool open();
+	bool isOpen() const { return m_data != nullptr; }
+
+	QHash<QString, QDateTime> sources() const { return m_sources; }
+
+	QVector<QString> names() const;
+	const Package *get(const QString &name, const Version &version) const;
+	QVector<const Package *> find(const QString &name, const VersionRequirement &version = VersionRequirement()) const;
+
+	/// Packages are owned by the index, unless taken from it
+	QVector<const Package *> takeMaterialized();
+
+	static void write(const QString &filename, const QHash<QString, QDateTime> &sources, const QVector<const Package *> &packages);
+
+private:
+	QFile m_file;
+	const uchar *m_data = nullptr;
+	quint32 m_size = 0;
+
+	QHash<QString, QDateTime> m_sources;
+	quint32 m_nameCount = 0;
+	quint32 m_entryCount = 0;
+	const uchar *m_names = nullptr;
+	const uchar *m_entries = nullptr;
+
+	mutable QHash<quint32, const Package *> m_materialized;
+
+	bool validate();
+	/// @returns the index into the name table, or -1 if no such name exists
+	int findName(const QByteArray &name) const;
+	QByteArray string(const quint32 offset, const quint32 length) const;
+	void entryRange(const quint32 name, quint32 &first, quint32 &last) const;
+	Version entryVersion(const quint32 entry) const;
+	const Package *materialize(const quint32 entry) const;
+};
+
+}
+}
@@ -15,10 +15,13 @@
 
 #include "PackageMirror.h"
 
+#include <QDataStream>
+
 #include "Json.h"
 #include "FileSystem.h"
 #include "Requirement.h"
 #include "Package.h"
+#include "BuildCache.h"
 #include "Functional.h"
 #include "steps/InstallationStep.h"
 
@@ -45,30 +48,74 @@ PackageMirror PackageMirror::fromJson(const QJsonObject &obj)
 		candidate.m_steps.append(std::shared_ptr<InstallationStep>(InstallationStep::create("git-clone", gitObj)));
 	}
 
-	candidate.m_steps.append(Common::Functional::map(ensureIsArrayOf<QJsonValue>(obj, "steps", QVector<QJsonValue>()), [](const QJsonValue &val)
-	{
-		if (val.isString()) {
-			return std::shared_ptr<InstallationStep>(InstallationStep::create(val.toString(), QJsonObject()));
-		} else {
-			const QJsonObject object = ensureObject(val);
-			return std::shared_ptr<InstallationStep>(InstallationStep::create(ensureString(object, "type"), object));
-		}
-	}));
+	candidate.m_steps.append(Common::Functional::map(ensureIsArrayOf<QJsonValue>(obj, "steps", QVector<QJsonValue>()), &PackageMirror::stepFromJson));
 
 	candidate.setRequirement(std::make_unique<AndRequirement>(AndRequirement::fromJson(ensureArray(obj, "requirements", QJsonArray()))));
 	return candidate;
 }
 
+std::shared_ptr<InstallationStep> PackageMirror::stepFromJson(const QJsonValue &value)
+{
+	if (value.isString()) {
+		return std::shared_ptr<InstallationStep>(InstallationStep::create(value.toString(), QJsonObject()));
+	} else {
+		const QJsonObject object = Json::ensureObject(value);
+		return std::shared_ptr<InstallationStep>(InstallationStep::create(Json::ensureString(object, "type"), object));
+	}
+}
+
 Future<void> PackageMirror::install(const ActionContext &ctxt) const
 {
 	return async([this, ctxt](Notifier notifier)
 	{
-		for (const auto &step : m_steps) {
-			notifier.status("Running step '%1'..." % step->type());
-			notifier.await(step->perform(ctxt));
+		const auto runSteps = [ctxt, notifier](auto begin, auto end)
+		{
+			for (auto it = begin; it != end; ++it) {
+				notifier.status("Running step '%1'..." % (*it)->type());
+				notifier.await((*it)->perform(ctxt));
+			}
+		};
+
+		// everything up to the build only fetches the sources
+		const auto firstBuild = std::find_if(m_steps.begin(), m_steps.end(), [](const std::shared_ptr<InstallationStep> &step) { return step->isBuild(); });
+		const std::shared_ptr<BuildCache> cache = BuildCache::instance();
+		if (!cache || firstBuild == m_steps.end()) {
+			runSteps(m_steps.begin(), m_steps.end());
+			return;
 		}
+
+		runSteps(m_steps.begin(), firstBuild);
+		const InstallContextItem &install = ctxt.get<InstallContextItem>();
+		const PackageConfiguration config = ctxt.has<ConfigurationContextItem>() ? ctxt.get<ConfigurationContextItem>().config : PackageConfiguration();
+		// without knowing exactly which sources were built there is nothing to look for
+		const QString sourceId = notifier.await(BuildCache::sourceId(install.buildDir));
+		if (sourceId.isEmpty()) {
+			runSteps(firstBuild, m_steps.end());
+			return;
+		}
+		const QString key = BuildCache::key(*this, config, sourceId, install.targetDir);
+		if (notifier.await(cache->retrieve(key, install.targetDir))) {
+			notifier.status("Using the cached build %1" % key.left(16));
+			return;
+		}
+		notifier.status("No cached build, building from source");
+		runSteps(firstBuild, m_steps.end());
+		notifier.await(cache->insert(key, install.targetDir));
 	});
 }
 
+QDataStream &operator<<(QDataStream &str, const PackageMirror &mirror)
+{
+	// steps are polymorphic, so we store their JSON representation
+	return str << mirror.m_requirement << Json::toBinary(Json::toJsonArray(mirror.m_steps));
+}
+QDataStream &operator>>(QDataStream &str, PackageMirror &mirror)
+{
+	QByteArray steps;
+	str >> mirror.m_requirement >> steps;
+	mirror.m_steps = Common::Functional::map(Json::ensureIsArrayOf<QJsonValue>(QJsonDocument::fromBinaryData(steps)), &PackageMirror::stepFromJson);
+	return str;
+}
+
 }
 }
@@ -22,6 +22,7 @@
 
 QT_BEGIN_NAMESPACE
 class QDir;
+class QDataStream;
 QT_END_NAMESPACE
 
 namespace Ralph {
@@ -51,6 +52,11 @@ public:
 private:
 	RequirementPtr m_requirement;
 	QVector<std::shared_ptr<InstallationStep>> m_steps;
+
+	static std::shared_ptr<InstallationStep> stepFromJson(const QJsonValue &value);
+
+	friend QDataStream &operator<<(QDataStream &str, const PackageMirror &mirror);
+	friend QDataStream &operator>>(QDataStream &str, PackageMirror &mirror);
 };
 
 }
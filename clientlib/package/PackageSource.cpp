@@ -15,10 +15,16 @@
 
 #include "PackageSource.h"
 
+#include <QDataStream>
+#include <QMap>
+#include <QSet>
+
 #include "Json.h"
+#include "FileSystem.h"
 #include "project/Project.h"
 #include "Functional.h"
 #include "task/Task.h"
+#include "task/Executor.h"
 #include "git/GitRepo.h"
 
 namespace Ralph {
@@ -26,18 +32,9 @@ using namespace Common;
 
 namespace ClientLib {
 
-static bool isGitCommitish(const QString &str)
-{
-	for (const QChar &c : str.toLower()) {
-		if (c < '0' || c > 'f') {
-			return false;
-		}
-	}
-	return str.size() >= 3;
-}
 static QString cleanGitIdentifier(const QString &id)
 {
-	if (isGitCommitish(id)) {
+	if (Git::GitRepo::isCommitish(id)) {
 		return id;
 	} else if (id.startsWith("origin/")) {
 		return id;
@@ -45,6 +42,11 @@ static QString cleanGitIdentifier(const QString &id)
 		return "origin/" + id;
 	}
 }
+// package sources only need the newest state of a branch, a commit however might be anywhere in the history
+static int gitFetchDepth(const QString &id)
+{
+	return Git::GitRepo::isCommitish(id) ? 0 : 1;
+}
 
 PackageSource::PackageSource(const SourceType type)
 	: m_type(type) {}
@@ -58,7 +60,9 @@ void PackageSource::setName(const QString &name)
 
 void PackageSource::setLastUpdated()
 {
-	m_lastUpdated = QDateTime::currentDateTimeUtc();
+	// db.json only stores seconds, so drop the rest to stay comparable with what we read back later
+	const QDateTime now = QDateTime::currentDateTimeUtc();
+	m_lastUpdated = now.addMSecs(-now.time().msec());
 }
 
 PackageSource *PackageSource::fromJson(const QJsonValue &value)
@@ -92,6 +96,7 @@ PackageSource *PackageSource::fromJson(const QJsonValue &value)
 		GitRepoPackageSource *source = new GitRepoPackageSource();
 		source->setUrl(ensureUrl(obj, "url"));
 		source->setIdentifier(ensureString(obj, "identifier", QString("master")));
+		source->setBare(ensureBoolean(obj, QStringLiteral("bare"), false));
 		parseCommon(source);
 		return source;
 	} else {
@@ -179,11 +184,11 @@ Future<void> GitSinglePackageSource::update()
 	return async([this](Notifier notifier)
 	{
 		if (!basePath().exists()) {
-			Git::GitRepo *repo = notifier.await(Git::GitRepo::clone(basePath(), url()));
+			Git::GitRepo *repo = notifier.await(Git::GitRepo::clone(basePath(), url(), false, gitFetchDepth(identifier())));
 			notifier.await(repo->checkout(identifier()));
 		} else {
 			Git::GitRepo *repo = notifier.await(Git::GitRepo::open(basePath()));
-			notifier.await(repo->pull(cleanGitIdentifier(identifier())));
+			notifier.await(repo->pull(cleanGitIdentifier(identifier()), gitFetchDepth(identifier())));
 		}
 		setLastUpdated();
 	});
@@ -230,31 +235,171 @@ QJsonObject GitHubSinglePackageSource::toJson() const
 GitRepoPackageSource::GitRepoPackageSource()
 	: BaseGitPackageSource(GitRepo) {}
 
+// remembers which tree of a GitRepoPackageSource was read last, and the package (as written
+// by its QDataStream operators) from each file in it, so that only changed files need parsing
+// bump gitRepoIndexVersion whenever the streamed representation of Package changes
+static constexpr quint32 gitRepoIndexMagic = 0x524c5047; // RLPG
+static constexpr quint32 gitRepoIndexVersion = 1;
+static constexpr QDataStream::Version gitRepoIndexStreamVersion = QDataStream::Qt_5_5;
+
+struct GitRepoIndex
+{
+	QString tree;
+	QMap<QString, QByteArray> records;
+};
+
+static QString gitRepoIndexFile(const QDir &base)
+{
+	return base.absolutePath() + ".index";
+}
+static GitRepoIndex readGitRepoIndex(const QString &filename)
+{
+	GitRepoIndex index;
+	QFile file(filename);
+	if (!file.open(QFile::ReadOnly)) {
+		return index;
+	}
+	QDataStream str(&file);
+	str.setVersion(gitRepoIndexStreamVersion);
+	quint32 magic, version;
+	str >> magic >> version;
+	if (str.status() != QDataStream::Ok || magic != gitRepoIndexMagic || version != gitRepoIndexVersion) {
+		return index;
+	}
+	str >> index.tree >> index.records;
+	if (str.status() != QDataStream::Ok) {
+		return GitRepoIndex();
+	}
+	return index;
+}
+static void writeGitRepoIndex(const QString &filename, const GitRepoIndex &index)
+{
+	QByteArray data;
+	{
+		QDataStream str(&data, QIODevice::WriteOnly);
+		str.setVersion(gitRepoIndexStreamVersion);
+		str << gitRepoIndexMagic << gitRepoIndexVersion << index.tree << index.records;
+	}
+	try {
+		FS::write(filename, data);
+	} catch (FS::FileSystemException &) {
+		// only an optimization, read-only databases simply parse everything every time
+	}
+}
+static bool isPackageFile(const QString &path)
+{
+	return path.endsWith(".json") && !path.contains('/');
+}
+
 Future<QVector<const Package *> > GitRepoPackageSource::packages() const
 {
-	return async([this]()
+	return async([this](Notifier notifier)
 	{
-		const auto files = basePath().entryInfoList(QStringList() << "*.json", QDir::Files | QDir::NoSymLinks | QDir::Readable);
-		return Functional::map2<QVector<const Package *>>(files, [](const QFileInfo &file)
-		{
-			return Package::fromJson(Json::ensureDocument(file.absoluteFilePath()));
-		});
+		std::unique_ptr<Git::GitRepo> repo(notifier.await(Git::GitRepo::open(basePath())));
+		const QString tree = notifier.await(repo->treeId(cleanGitIdentifier(identifier())));
+
+		GitRepoIndex index = readGitRepoIndex(gitRepoIndexFile(basePath()));
+		QMap<QString, const Package *> parsed;
+		if (index.tree != tree) {
+			QSet<QString> changed;
+			bool haveDiff = false;
+			if (!index.tree.isEmpty()) {
+				try {
+					for (const Git::GitDiffEntry &entry : notifier.await(repo->diff(index.tree, tree))) {
+						if (!isPackageFile(entry.path())) {
+							continue;
+						} else if (entry.status() == Git::GitDiffEntry::Deleted) {
+							index.records.remove(entry.path());
+						} else {
+							changed.insert(entry.path());
+						}
+					}
+					haveDiff = true;
+				} catch (Git::GitException &) {
+					// the previous tree is gone (force push, re-cloned source etc.), start over
+				}
+			}
+			if (!haveDiff) {
+				index.records.clear();
+			}
+
+			// read straight from the object database, so that it doesn't matter if (or what) is checked out
+			const QVector<Git::GitBlob> blobs = notifier.await(repo->readBlobs(tree, [haveDiff, changed](const QString &path)
+			{
+				return isPackageFile(path) && (!haveDiff || changed.contains(path));
+			}));
+			notifier.status("Reading %1 changed package files..." % blobs.size());
+			const QVector<const Package *> packages = parsePackages(Functional::map(blobs, [](const Git::GitBlob &blob) { return blob.data(); }));
+			for (int i = 0; i < blobs.size(); ++i) {
+				QByteArray record;
+				{
+					QDataStream str(&record, QIODevice::WriteOnly);
+					str.setVersion(gitRepoIndexStreamVersion);
+					str << *packages.at(i);
+				}
+				parsed.insert(blobs.at(i).path(), packages.at(i));
+				index.records.insert(blobs.at(i).path(), record);
+			}
+			index.tree = tree;
+			writeGitRepoIndex(gitRepoIndexFile(basePath()), index);
+		}
+
+		QVector<const Package *> out;
+		out.reserve(index.records.size());
+		for (auto it = index.records.constBegin(); it != index.records.constEnd(); ++it) {
+			const Package *package = parsed.value(it.key());
+			if (!package) {
+				std::unique_ptr<Package> restored = std::make_unique<Package>();
+				QDataStream str(it.value());
+				str.setVersion(gitRepoIndexStreamVersion);
+				str >> *restored;
+				if (str.status() != QDataStream::Ok) {
+					throw Exception("Corrupt package source index: %1" % gitRepoIndexFile(basePath()));
+				}
+				package = restored.release();
+			}
+			out.append(package);
+		}
+		return out;
 	});
 }
+QVector<const Package *> GitRepoPackageSource::parsePackages(const QVector<QByteArray> &files, const std::size_t threads)
+{
+	return Functional::parallelMap(files, [](const QByteArray &data)
+	{
+		return Package::fromJson(Json::ensureDocument(data));
+	}, Executor::instance(), threads);
+}
+
 Future<void> GitRepoPackageSource::update()
 {
 	return async([this](Notifier notifier)
 	{
 		if (!basePath().exists()) {
-			Git::GitRepo *repo = notifier.await(Git::GitRepo::clone(basePath(), url()));
-			notifier.await(repo->checkout(identifier()));
+			Git::GitRepo *repo = notifier.await(Git::GitRepo::clone(basePath(), url(), bare(), gitFetchDepth(identifier())));
+			if (!bare()) {
+				notifier.await(repo->checkout(identifier()));
+			}
 		} else {
 			Git::GitRepo *repo = notifier.await(Git::GitRepo::open(basePath()));
-			notifier.await(repo->pull(cleanGitIdentifier(identifier())));
+			if (bare()) {
+				notifier.await(repo->fetch(gitFetchDepth(identifier())));
+			} else {
+				notifier.await(repo->pull(cleanGitIdentifier(identifier()), gitFetchDepth(identifier())));
+			}
 		}
 		setLastUpdated();
 	});
 }
 
+QJsonObject GitRepoPackageSource::toJson() const
+{
+	QJsonObject obj = BaseGitPackageSource::toJson();
+	if (bare()) {
+		obj.insert("bare", true);
+	}
+	return obj;
+}
+
 }
 }
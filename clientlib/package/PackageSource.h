@@ -148,8 +148,21 @@ public:
 
 	QString typeString() const override { return "gitrepo"; }
 
+	/// A bare source only keeps the git database around, nothing is checked out
+	bool bare() const { return m_bare; }
+	void setBare(const bool bare) { m_bare = bare; }
+
 	Future<QVector<const Package *>> packages() const override;
 	Future<void> update() override;
+
+	QJsonObject toJson() const override;
+
+	/// Parses the given package files in up to threads parallel jobs on the shared executor (0 means one per worker)
+	/// @returns the packages in the same order as files
+	static QVector<const Package *> parsePackages(const QVector<QByteArray> &files, const std::size_t threads = 0);
+
+private:
+	bool m_bare = false;
 };
 
 }
@@ -0,0 +1,210 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PackageStore.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLockFile>
+#include <QRegExp>
+#include <mutex>
+
+#include "Package.h"
+#include "PackageMirror.h"
+#include "PackageConfiguration.h"
+#include "FileSystem.h"
+#include "Json.h"
+
+namespace Ralph {
+using namespace Common;
+
+namespace ClientLib {
+
+static std::mutex instanceMutex;
+static std::shared_ptr<PackageStore> globalInstance;
+
+PackageStore::PackageStore(const QDir &dir)
+	: m_dir(dir)
+{
+	FS::ensureExists(m_dir.absoluteFilePath("entries"));
+	FS::ensureExists(m_dir.absoluteFilePath("refs"));
+}
+
+std::shared_ptr<PackageStore> PackageStore::instance()
+{
+	std::lock_guard<std::mutex> lock(instanceMutex);
+	return globalInstance;
+}
+void PackageStore::setInstance(const std::shared_ptr<PackageStore> &store)
+{
+	std::lock_guard<std::mutex> lock(instanceMutex);
+	globalInstance = store;
+}
+
+QString PackageStore::key(const Package *pkg, const PackageMirror &mirror, const PackageConfiguration &config)
+{
+	// the keys of QJsonObjects are sorted, so equal objects always give the same bytes
+	QCryptographicHash hash(QCryptographicHash::Sha256);
+	hash.addData(pkg->name().toUtf8());
+	hash.addData(QByteArray(1, '\0'));
+	hash.addData(pkg->version().toString().toUtf8());
+	hash.addData(QByteArray(1, '\0'));
+	hash.addData(QJsonDocument(mirror.toJson()).toJson(QJsonDocument::Compact));
+	hash.addData(QByteArray(1, '\0'));
+	hash.addData(QJsonDocument(config.toJson()).toJson(QJsonDocument::Compact));
+
+	// the name and version only make the store easier to look through
+	const QString name = pkg->name().toLower().replace(QRegExp("[^a-z0-9_.+-]"), "_");
+	return "%1-%2-%3" % name % pkg->version().toString() % QString::fromLatin1(hash.result().toHex().left(16));
+}
+
+bool PackageStore::contains(const QString &key) const
+{
+	return QFile::exists(metadataFile(key));
+}
+QDir PackageStore::entryDir(const QString &key) const
+{
+	return m_dir.absoluteFilePath("entries/" + key);
+}
+QString PackageStore::metadataFile(const QString &key) const
+{
+	return m_dir.absoluteFilePath("entries/" + key + ".json");
+}
+QString PackageStore::refFile(const QString &key, const QString &link) const
+{
+	const QString name = QCryptographicHash::hash(link.toUtf8(), QCryptographicHash::Sha1).toHex();
+	return m_dir.absoluteFilePath("refs/%1/%2" % key % name);
+}
+
+std::unique_ptr<QLockFile> PackageStore::lockEntry(const QString &key) const
+{
+	auto lock = std::make_unique<QLockFile>(entryDir(key).absolutePath() + ".lock");
+	lock->setStaleLockTime(0);
+	if (!lock->lock()) {
+		throw Exception("Unable to lock %1 in the package store" % key);
+	}
+	return lock;
+}
+
+Future<void> PackageStore::ensure(const QString &key, const QDir &link, const std::function<Future<void>(const QDir &)> &install)
+{
+	return async([this, key, link, install](Notifier notifier)
+	{
+		// another group (possibly in another process) might be installing the same thing right now
+		const std::unique_ptr<QLockFile> lock = lockEntry(key);
+		if (!contains(key)) {
+			// whatever is there is left over from an interrupted installation
+			const QDir dir = entryDir(key);
+			if (dir.exists()) {
+				FS::remove(dir);
+			}
+			FS::ensureExists(dir);
+			try {
+				notifier.await(install(dir));
+			} catch (...) {
+				QDir(dir).removeRecursively();
+				throw;
+			}
+
+			QJsonObject metadata;
+			metadata.insert("installed", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+			Json::write(metadata, metadataFile(key));
+		}
+		linkLocked(key, link);
+	});
+}
+
+void PackageStore::link(const QString &key, const QDir &link)
+{
+	const std::unique_ptr<QLockFile> lock = lockEntry(key);
+	if (!contains(key)) {
+		throw Exception("%1 is not in the package store" % key);
+	}
+	linkLocked(key, link);
+}
+void PackageStore::linkLocked(const QString &key, const QDir &link)
+{
+	const QString path = link.absolutePath();
+	const QFileInfo info(path);
+	FS::ensureExists(info.dir());
+	if (info.isSymLink()) {
+		FS::remove(path);
+	} else if (info.exists()) {
+		FS::remove(QDir(path));
+	}
+
+#ifdef Q_OS_UNIX
+	if (!QFile::link(entryDir(key).absolutePath(), path)) {
+		throw Exception("Unable to link %1 to the package store" % path);
+	}
+#else
+	// links to directories need special privileges on windows, but all the files can be shared
+	FS::mergeDirectoryInto(entryDir(key), QDir(path), FS::Transfer::HardLink);
+#endif
+	FS::write(refFile(key, path), path.toUtf8());
+}
+void PackageStore::unlink(const QString &key, const QDir &link)
+{
+	QFile::remove(refFile(key, link.absolutePath()));
+}
+
+bool PackageStore::isReferenced(const QString &key) const
+{
+	bool referenced = false;
+	const QDir refs = m_dir.absoluteFilePath("refs/" + key);
+	for (const QFileInfo &ref : refs.entryInfoList(QDir::Files)) {
+		// groups that were deleted without removing their packages leave stale refs behind
+		const QFileInfo link(QString::fromUtf8(FS::read(ref.absoluteFilePath())));
+#ifdef Q_OS_UNIX
+		const bool valid = link.isSymLink() && QFileInfo(link.symLinkTarget()).canonicalFilePath() == QFileInfo(entryDir(key).absolutePath()).canonicalFilePath();
+#else
+		const bool valid = link.exists();
+#endif
+		if (valid) {
+			referenced = true;
+		} else {
+			QFile::remove(ref.absoluteFilePath());
+		}
+	}
+	return referenced;
+}
+
+int PackageStore::prune()
+{
+	int removed = 0;
+	const QDir entries = m_dir.absoluteFilePath("entries");
+	for (const QFileInfo &metadata : entries.entryInfoList(QStringList() << "*.json", QDir::Files)) {
+		const QString key = metadata.completeBaseName();
+		if (isReferenced(key)) {
+			continue;
+		}
+		// somebody might be about to link to it, and might have done so before we got the lock
+		QLockFile lock(entryDir(key).absolutePath() + ".lock");
+		lock.setStaleLockTime(0);
+		if (!lock.tryLock() || isReferenced(key)) {
+			continue;
+		}
+		FS::remove(metadata.absoluteFilePath());
+		FS::remove(entryDir(key));
+		QDir(m_dir.absoluteFilePath("refs/" + key)).removeRecursively();
+		++removed;
+	}
+	return removed;
+}
+
+}
+}
@@ -0,0 +1,84 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <QDir>
+#include <functional>
+#include <memory>
+
+#include "task/Task.h"
+
+QT_BEGIN_NAMESPACE
+class QLockFile;
+QT_END_NAMESPACE
+
+namespace Ralph {
+namespace ClientLib {
+class Package;
+class PackageMirror;
+class PackageConfiguration;
+
+/** Content-addressed store of installed packages, shared by all databases and groups of a user
+ *
+ * An installation is keyed by the package, its version, the mirror it is installed from and the
+ * configuration. It is installed once to entries/<key>, and groups only link to it, so installing
+ * the same thing into another group doesn't build it again or take any space.
+ *
+ * Entries are complete once their entries/<key>.json exists, and are never modified after that.
+ * Every link is recorded below refs/<key>/, prune() removes the entries nothing links to anymore.
+ * Several processes may use the same store, installations of the same key wait for each other.
+ */
+class PackageStore
+{
+public:
+	explicit PackageStore(const QDir &dir);
+
+	/// The store used by package groups, nullptr (the default) to install into each group separately
+	static std::shared_ptr<PackageStore> instance();
+	static void setInstance(const std::shared_ptr<PackageStore> &store);
+
+	static QString key(const Package *pkg, const PackageMirror &mirror, const PackageConfiguration &config);
+
+	QDir dir() const { return m_dir; }
+	bool contains(const QString &key) const;
+	QDir entryDir(const QString &key) const;
+
+	/** Calls install with the directory to install to, unless the entry for key is complete already, and then links link to it
+	 *
+	 * The entry stays locked until the link has been recorded, so that prune() can't remove it in between.
+	 */
+	Future<void> ensure(const QString &key, const QDir &link, const std::function<Future<void>(const QDir &)> &install);
+	/// Makes link (a directory) refer to the complete entry for key, replacing whatever was there
+	void link(const QString &key, const QDir &link);
+	/// Forgets about link, the entry stays until the next prune()
+	void unlink(const QString &key, const QDir &link);
+
+	/// Removes all entries that are not linked to. @returns the number of removed entries
+	int prune();
+
+private:
+	const QDir m_dir;
+
+	QString metadataFile(const QString &key) const;
+	QString refFile(const QString &key, const QString &link) const;
+	bool isReferenced(const QString &key) const;
+	/// Entries are locked while they are installed, linked to or removed
+	std::unique_ptr<QLockFile> lockEntry(const QString &key) const;
+	void linkLocked(const QString &key, const QDir &link);
+};
+
+}
+}
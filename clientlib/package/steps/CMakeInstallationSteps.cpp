@@ -15,13 +15,89 @@
 
 #include "CMakeInstallationSteps.h"
 
+#include <QStandardPaths>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
 #include "Json.h"
+#include "Version.h"
 #include "task/Process.h"
 #include "FileSystem.h"
+#include "Functional.h"
 
 namespace Ralph {
 namespace ClientLib {
 
+static std::atomic<CMakeConfigStep::Generator> generator{CMakeConfigStep::Generator::Default};
+
+// several packages may be built at the same time, together they shouldn't run more jobs than there
+// are cores. a build waits until a job is free, and then shares what is free with the running builds
+static std::mutex budgetMutex;
+static std::condition_variable budgetReleased;
+static std::size_t jobBudget = 0;
+static std::size_t jobsInUse = 0;
+static std::size_t activeBuilds = 0;
+
+namespace {
+struct JobLease
+{
+	explicit JobLease()
+	{
+		std::unique_lock<std::mutex> lock(budgetMutex);
+		budgetReleased.wait(lock, []() { return jobsInUse < Common::Functional::parallelThreadCount(jobBudget); });
+		const std::size_t total = Common::Functional::parallelThreadCount(jobBudget);
+		++activeBuilds;
+		count = std::max(std::size_t(1), std::min(total - jobsInUse, total / activeBuilds));
+		jobsInUse += count;
+	}
+	~JobLease()
+	{
+		{
+			std::lock_guard<std::mutex> lock(budgetMutex);
+			jobsInUse -= count;
+			--activeBuilds;
+		}
+		budgetReleased.notify_all();
+	}
+
+	std::size_t count;
+};
+}
+
+// --parallel needs cmake 3.12, several targets in one invocation 3.15
+static Version cmakeVersion(const Notifier &notifier)
+{
+	static std::mutex mutex;
+	static Version version;
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!version.isValid()) {
+		Process proc;
+		proc.setExecutable("cmake");
+		proc.setArguments(QVector<QString>() << "--version");
+		// "cmake version 3.16.3"
+		const QString string = QString::fromLocal8Bit(notifier.await(proc.runCaptureOutput()).split('\n').first()).section(' ', 2, 2).trimmed();
+		version = Version::fromString(string.isEmpty() ? QStringLiteral("0") : string);
+	}
+	return version;
+}
+// before --parallel the flag has to be passed on to the build tool, which only make and ninja understand
+static bool buildToolTakesJobs(const QDir &buildDir)
+{
+	QFile cache(buildDir.absoluteFilePath("CMakeCache.txt"));
+	if (!cache.open(QFile::ReadOnly)) {
+		return false;
+	}
+	while (!cache.atEnd()) {
+		const QByteArray line = cache.readLine().trimmed();
+		if (line.startsWith("CMAKE_GENERATOR:INTERNAL=")) {
+			return line.contains("Ninja") || (line.contains("Makefiles") && !line.contains("NMake"));
+		}
+	}
+	return false;
+}
+
 CMakeConfigStep::CMakeConfigStep() {}
 
 QJsonValue CMakeConfigStep::toJson() const
@@ -38,13 +114,29 @@ Future<void> CMakeConfigStep::perform(const ActionContext &ctxt)
 	{
 		FS::ensureExists(ctxt.get<InstallContextItem>().buildDir.absoluteFilePath("build"));
 
+		// the generator of an existing build directory can't be changed, but cmake remembers it
+		const bool configured = QFileInfo::exists(ctxt.get<InstallContextItem>().buildDir.absoluteFilePath("build/CMakeCache.txt"));
+		QVector<QString> arguments;
+		if (generator == Generator::Ninja && !configured) {
+			if (!QStandardPaths::findExecutable("ninja").isEmpty()) {
+				arguments << "-G" << "Ninja";
+			} else {
+				notifier.status("Ninja is not available, using the default generator");
+			}
+		}
+		arguments << "-DCMAKE_INSTALL_PREFIX=" + ctxt.get<InstallContextItem>().targetDir.absolutePath() << "..";
+
 		Process proc;
 		proc.setExecutable("cmake");
-		proc.setArguments(QVector<QString>() << "-DCMAKE_INSTALL_PREFIX=" + ctxt.get<InstallContextItem>().targetDir.absolutePath() << "..");
+		proc.setArguments(arguments);
 		proc.setWorkingDirectory(ctxt.get<InstallContextItem>().buildDir.absoluteFilePath("build"));
 		notifier.await(proc.run());
 	});
 }
+void CMakeConfigStep::setGenerator(const Generator gen)
+{
+	generator = gen;
+}
 
 CMakeBuildStep::CMakeBuildStep() {}
 
@@ -63,16 +155,47 @@ Future<void> CMakeBuildStep::perform(const ActionContext &ctxt)
 {
 	return async([this, ctxt](Notifier notifier)
 	{
-		Process proc;
-		proc.setExecutable("cmake");
-		proc.setWorkingDirectory(ctxt.get<InstallContextItem>().buildDir.absoluteFilePath("build"));
-		for (const QString &target : m_targets) {
-			notifier.status("Building target %1..." % target);
-			proc.setArguments(QVector<QString>() << "--build" << "." << "--target" << target);
+		if (m_targets.isEmpty()) {
+			return;
+		}
+		const QDir buildDir = ctxt.get<InstallContextItem>().buildDir.absoluteFilePath("build");
+		const Version version = cmakeVersion(notifier);
+		const JobLease jobs;
+		const QString count = QString::number(jobs.count);
+
+		QVector<QVector<QString>> invocations;
+		if (version >= Version::fromString("3.15")) {
+			// a single invocation lets the build tool work on all targets in parallel
+			invocations.append(QVector<QString>() << "--build" << "." << "--parallel" << count << "--target" << m_targets);
+		} else {
+			const bool nativeJobs = buildToolTakesJobs(buildDir);
+			for (const QString &target : m_targets) {
+				QVector<QString> arguments = QVector<QString>() << "--build" << "." << "--target" << target;
+				if (version >= Version::fromString("3.12")) {
+					arguments << "--parallel" << count;
+				} else if (nativeJobs) {
+					arguments << "--" << "-j" + count;
+				}
+				invocations.append(arguments);
+			}
+		}
+
+		const QStringList targets = m_targets.toList();
+		notifier.status("Building %1 with %2 jobs..." % targets.join(", ") % count);
+		for (const QVector<QString> &arguments : invocations) {
+			Process proc;
+			proc.setExecutable("cmake");
+			proc.setWorkingDirectory(buildDir.absolutePath());
+			proc.setArguments(arguments);
 			notifier.await(proc.run());
 		}
 	});
 }
+void CMakeBuildStep::setJobs(const std::size_t jobs)
+{
+	std::lock_guard<std::mutex> lock(budgetMutex);
+	jobBudget = jobs;
+}
 
 }
 }
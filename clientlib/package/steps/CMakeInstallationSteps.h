@@ -29,7 +29,17 @@ public:
 	QJsonValue toJson() const override;
 	void fromJsonObject(const QJsonObject &obj) override;
 
+	bool isBuild() const override { return true; }
+
 	Future<void> perform(const ActionContext &ctxt) override;
+
+	enum class Generator
+	{
+		Default,
+		Ninja
+	};
+	/// Generator for all builds, Ninja falls back to the default of CMake if it is not installed
+	static void setGenerator(const Generator generator);
 };
 
 class CMakeBuildStep : public InstallationStep
@@ -41,8 +51,13 @@ public:
 	QJsonValue toJson() const override;
 	void fromJsonObject(const QJsonObject &obj) override;
 
+	bool isBuild() const override { return true; }
+
 	Future<void> perform(const ActionContext &ctxt) override;
 
+	/// How many jobs all builds together may run at once, 0 for one per core
+	static void setJobs(const std::size_t jobs);
+
 private:
 	QVector<QString> m_targets;
 };
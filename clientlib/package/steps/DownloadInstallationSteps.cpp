@@ -0,0 +1,72 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DownloadInstallationSteps.h"
+
+#include <QFileInfo>
+
+#include "Json.h"
+#include "task/Network.h"
+#include "task/Archive.h"
+
+namespace Ralph {
+namespace ClientLib {
+
+DownloadStep::DownloadStep() {}
+
+QJsonValue DownloadStep::toJson() const
+{
+	QJsonObject obj({
+						qMakePair(QStringLiteral("type"), type()),
+						qMakePair(QStringLiteral("url"), Json::toJson(m_url))
+					});
+	if (!m_sha256.isEmpty()) {
+		obj.insert("sha256", QString::fromLatin1(m_sha256));
+	}
+	if (!m_filename.isEmpty()) {
+		obj.insert("filename", m_filename);
+	}
+	if (!m_extract.isEmpty()) {
+		obj.insert("extract", m_extract);
+	}
+	return obj;
+}
+void DownloadStep::fromJsonObject(const QJsonObject &obj)
+{
+	m_url = Json::ensureUrl(obj, "url");
+	m_sha256 = Json::ensureString(obj, "sha256", QString()).toLatin1().toLower();
+	m_filename = Json::ensureString(obj, "filename", QString());
+	m_extract = Json::ensureString(obj, "extract", QString());
+	if (!m_extract.isEmpty() && m_extract != "build" && m_extract != "install") {
+		throw Json::JsonException("'extract' has to be either 'build' or 'install'");
+	}
+	if (!m_sha256.isEmpty() && (m_sha256.size() != 64 || QByteArray::fromHex(m_sha256).toHex() != m_sha256)) {
+		throw Json::JsonException("'sha256' has to be a hex encoded SHA-256 hash");
+	}
+}
+Future<void> DownloadStep::perform(const ActionContext &ctxt)
+{
+	const QDir buildDir = ctxt.get<InstallContextItem>().buildDir;
+	if (m_extract == "build") {
+		return Archive::extract(m_url, buildDir, m_sha256);
+	} else if (m_extract == "install") {
+		return Archive::extract(m_url, ctxt.get<InstallContextItem>().targetDir, m_sha256);
+	}
+	const QString filename = m_filename.isEmpty() ? QFileInfo(m_url.path()).fileName() : m_filename;
+	return Network::download(m_url, buildDir.absoluteFilePath(filename), m_sha256);
+}
+
+}
+}
@@ -0,0 +1,49 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <QUrl>
+
+#include "InstallationStep.h"
+
+namespace Ralph {
+namespace ClientLib {
+
+/** Downloads a file into the build directory. With a sha256 the download cache may skip the network entirely
+ *
+ * With extract set to "build" or "install" the file has to be a tar archive, which is extracted into
+ * that directory while it is being downloaded.
+ */
+class DownloadStep : public InstallationStep
+{
+public:
+	explicit DownloadStep();
+
+	QString type() const override { return "download"; }
+	QJsonValue toJson() const override;
+	void fromJsonObject(const QJsonObject &obj) override;
+
+	Future<void> perform(const ActionContext &ctxt) override;
+
+private:
+	QUrl m_url;
+	QByteArray m_sha256;
+	QString m_filename;
+	QString m_extract;
+};
+
+}
+}
@@ -15,7 +15,11 @@
 
 #include "GitInstallationSteps.h"
 
+#include <QCryptographicHash>
+#include <QLockFile>
+
 #include "Json.h"
+#include "FileSystem.h"
 #include "git/GitRepo.h"
 
 namespace Ralph {
@@ -38,15 +42,133 @@ void GitCloneStep::fromJsonObject(const QJsonObject &object)
 	m_url.setFragment(Json::ensureString(object, "identifier", m_url.fragment()));
 }
 
+static QDir mirrorPath(const QDir &cacheDir, const QUrl &url)
+{
+	const QString key = QCryptographicHash::hash(url.toString().toUtf8(), QCryptographicHash::Sha1).toHex();
+	return cacheDir.absoluteFilePath("git/" + key);
+}
+// the mirror is shared with other installations, possibly in other processes
+static std::unique_ptr<QLockFile> lockMirror(const QDir &mirrorDir, const QUrl &url)
+{
+	FS::ensureExists(QFileInfo(mirrorDir.absolutePath()).dir());
+	auto lock = std::make_unique<QLockFile>(mirrorDir.absolutePath() + ".lock");
+	lock->setStaleLockTime(0);
+	if (!lock->lock()) {
+		throw Exception("Unable to lock the mirror of %1" % url.toString());
+	}
+	return lock;
+}
+
+Future<Git::GitRepo *> GitCloneStep::cloneFromMirror(const QDir &cacheDir, const QDir &dir, const QUrl &url)
+{
+	return async([cacheDir, dir, url](Notifier notifier)
+	{
+		const QDir mirrorDir = mirrorPath(cacheDir, url);
+		const std::unique_ptr<QLockFile> lock = lockMirror(mirrorDir, url);
+		std::unique_ptr<Git::GitRepo> mirror(notifier.await(Git::GitRepo::mirror(mirrorDir, url)));
+
+		// a plain path (instead of a file:// url) makes libgit2 copy the objects directly
+		Git::GitRepo *repo = notifier.await(Git::GitRepo::clone(dir, QUrl(mirrorDir.absolutePath())));
+		repo->setOriginUrl(url);
+		return repo;
+	});
+}
+
+Future<void> GitCloneStep::update(const QDir &dir, const QUrl &url, const QString &identifier, const QString &cacheDir)
+{
+	return async([dir, url, identifier, cacheDir](Notifier notifier)
+	{
+		std::unique_ptr<Git::GitRepo> repo(notifier.await(Git::GitRepo::open(dir)));
+		if (repo->isShallow()) {
+			// there is no history to share with the mirror, so it gets updated the way it was cloned
+			if (Git::GitRepo::isCommitish(identifier)) {
+				throw Exception("The existing checkout is shallow, but %1 needs the history" % identifier);
+			}
+			repo->setOriginUrl(url);
+			notifier.status("Fetching new commits from %1..." % url.toString());
+			notifier.await(repo->fetch(1, identifier));
+		} else if (cacheDir.isEmpty()) {
+			repo->setOriginUrl(url);
+			notifier.status("Fetching new commits from %1..." % url.toString());
+			notifier.await(repo->fetch());
+		} else {
+			// the mirror fetches the new commits, the clone only copies them from there
+			const QDir mirrorDir = mirrorPath(cacheDir, url);
+			const std::unique_ptr<QLockFile> lock = lockMirror(mirrorDir, url);
+			std::unique_ptr<Git::GitRepo> mirror(notifier.await(Git::GitRepo::mirror(mirrorDir, url)));
+			repo->setOriginUrl(QUrl(mirrorDir.absolutePath()));
+			try {
+				notifier.await(repo->fetch());
+			} catch (...) {
+				repo->setOriginUrl(url);
+				throw;
+			}
+			repo->setOriginUrl(url);
+		}
+
+		notifier.await(checkout(repo.get(), identifier.isEmpty() ? QStringLiteral("HEAD") : identifier));
+	});
+}
+
+Future<void> GitCloneStep::checkout(const Git::GitRepo *repo, const QString &identifier)
+{
+	return async([repo, identifier](Notifier notifier)
+	{
+		if (Git::GitRepo::isCommitish(identifier)) {
+			notifier.await(repo->checkout(identifier));
+			return;
+		}
+		// clones only have remote branches, and where there is a local one it might be outdated
+		try {
+			notifier.await(repo->checkout("origin/" + identifier));
+		} catch (Git::GitException &) {
+			notifier.await(repo->checkout(identifier));
+		}
+	});
+}
+
 Future<void> GitCloneStep::perform(const ActionContext &ctxt)
 {
 	return async([this, ctxt](Notifier notifier)
 	{
+		const QString identifier = m_url.fragment();
 		QUrl url = m_url;
 		url.setFragment(QString());
-		Git::GitRepo *repo = notifier.await(Git::GitRepo::clone(ctxt.get<InstallContextItem>().buildDir, url));
-		if (!url.fragment().isEmpty()) {
-			notifier.await(repo->checkout(url.fragment()));
+
+		// a build directory kept from an earlier installation only needs the new commits
+		const QDir buildDir = ctxt.get<InstallContextItem>().buildDir;
+		const QString cacheDir = ctxt.has<CacheContextItem>() ? ctxt.get<CacheContextItem>().dir.absolutePath() : QString();
+		if (QFileInfo::exists(buildDir.absoluteFilePath(".git"))) {
+			try {
+				notifier.await(update(buildDir, url, identifier, cacheDir));
+				return;
+			} catch (CanceledException &) {
+				throw;
+			} catch (Exception &e) {
+				notifier.status("Unable to update the existing checkout, cloning again: %1" % e.cause());
+			}
+		}
+		// a failed update, or a kept directory that never got as far as a clone, is in the way of the clone
+		if (!buildDir.entryList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot).isEmpty()) {
+			FS::remove(buildDir);
+			FS::ensureExists(buildDir);
+		}
+
+		// a build never needs any history, so unless a mirror already has it only fetch what is checked out
+		const bool shallow = Git::GitRepo::supportsShallow() && !Git::GitRepo::isCommitish(identifier)
+				&& (cacheDir.isEmpty() || !mirrorPath(cacheDir, url).exists());
+		std::unique_ptr<Git::GitRepo> repo;
+		if (shallow && identifier.isEmpty()) {
+			repo.reset(notifier.await(Git::GitRepo::clone(buildDir, url, false, 1)));
+		} else if (shallow) {
+			repo.reset(notifier.await(Git::GitRepo::cloneRef(buildDir, url, identifier)));
+		} else if (!cacheDir.isEmpty()) {
+			repo.reset(notifier.await(cloneFromMirror(cacheDir, buildDir, url)));
+		} else {
+			repo.reset(notifier.await(Git::GitRepo::clone(buildDir, url)));
+		}
+		if (!identifier.isEmpty()) {
+			notifier.await(checkout(repo.get(), identifier));
 		}
 	});
 }
@@ -21,6 +21,9 @@
 
 namespace Ralph {
 namespace ClientLib {
+namespace Git {
+class GitRepo;
+}
 
 class GitCloneStep : public InstallationStep
 {
@@ -36,6 +39,12 @@ public:
 
 private:
 	QUrl m_url;
+
+	static Future<Git::GitRepo *> cloneFromMirror(const QDir &cacheDir, const QDir &dir, const QUrl &url);
+	/// Fetches and checks out identifier in the existing clone in dir, through the mirror in cacheDir unless it is empty or the clone is shallow
+	static Future<void> update(const QDir &dir, const QUrl &url, const QString &identifier, const QString &cacheDir);
+	/// Checks out a commit, tag or branch, where branches are looked for on the remote first
+	static Future<void> checkout(const Git::GitRepo *repo, const QString &identifier);
 };
 
 class GitSubmoduleSetupStep : public InstallationStep
@@ -17,6 +17,7 @@
 
 #include "GitInstallationSteps.h"
 #include "CMakeInstallationSteps.h"
+#include "DownloadInstallationSteps.h"
 #include "Exception.h"
 #include "Json.h"
 
@@ -51,6 +52,8 @@ std::unique_ptr<InstallationStep> InstallationStep::create(const QString &type,
 		step = std::make_unique<CMakeConfigStep>();
 	} else if (type == "cmake-build") {
 		step = std::make_unique<CMakeBuildStep>();
+	} else if (type == "download") {
+		step = std::make_unique<DownloadStep>();
 	}
 	Q_ASSERT_X(step->type() == type, "InstallationStep::create", "error: InstallationStep::type implementation returned wrong value");
 	step->fromJsonObject(obj);
@@ -39,6 +39,9 @@ public:
 	virtual void fromJsonObject(const QJsonObject &object);
 	virtual QJsonValue toJson() const;
 
+	/// The first step that builds and all after it are skipped if the build cache has the result already
+	virtual bool isBuild() const { return false; }
+
 	virtual Future<void> perform(const ActionContext &ctxt) = 0;
 
 	static std::unique_ptr<InstallationStep> create(const QString &type, const QJsonObject &obj);
@@ -14,113 +14,573 @@
  */
 
 #include "Archive.h"
+#include "Archive_p.h"
 
-#include <QMimeDatabase>
 #include <QDir>
 #include <QStack>
+#include <QHash>
+#include <QPair>
+#include <QUrl>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <numeric>
+#include <utility>
 
 #include <KArchive/KArchive>
-#include <KArchive/KTar>
 #include <KArchive/K7Zip>
-#include <KArchive/KZip>
 #include <KArchive/KAr>
 
+#include "Decompressor.h"
+#include "DownloadManager.h"
+#include "RingBuffer.h"
+#include "FileSystem.h"
+
 namespace Ralph {
 namespace ClientLib {
 namespace Archive {
 
+static constexpr qint64 tarBlockSize = 512;
 
+static void readFully(QIODevice *device, char *data, const qint64 size)
+{
+	qint64 done = 0;
+	while (done < size) {
+		const qint64 read = device->read(data + done, size - done);
+		if (read < 0) {
+			throw ArchiveException("Unable to read archive: " + device->errorString());
+		} else if (read == 0) {
+			throw ArchiveException("Unexpected end of archive");
+		}
+		done += read;
+	}
+}
+// reads size bytes and the padding to the next block, passing the data on in chunks
+template <typename Func>
+static void readEntryData(QIODevice *device, const qint64 size, Func &&func)
+{
+	// large writes, going mostly around QFile's own buffer
+	static constexpr qint64 chunkSize = 1024 * 1024;
+	const qint64 padded = (size + tarBlockSize - 1) / tarBlockSize * tarBlockSize;
+	// most entries are small, a full chunk each time would be an mmap and munmap per file
+	QByteArray buffer(int(std::min(chunkSize, padded)), Qt::Uninitialized);
+	qint64 remaining = padded;
+	while (remaining > 0) {
+		const qint64 chunk = std::min(chunkSize, remaining);
+		readFully(device, buffer.data(), chunk);
+		const qint64 payload = std::max(qint64(0), std::min(chunk, size - (padded - remaining)));
+		if (payload > 0) {
+			func(buffer.constData(), payload);
+		}
+		remaining -= chunk;
+	}
+}
+static QByteArray readEntryData(QIODevice *device, const qint64 size)
+{
+	QByteArray out;
+	readEntryData(device, size, [&out](const char *data, const qint64 length) { out.append(data, int(length)); });
+	return out;
+}
 
-Future<void> extract(const QString &filename, const QDir &destination)
+// octal, or GNU base-256 for values that don't fit
+static qint64 tarNumber(const char *field, const int size)
 {
-	return async([filename, destination](Notifier notifier)
-	{
-		const QMimeType mimetype = QMimeDatabase().mimeTypeForFile(filename);
+	qint64 value = 0;
+	if (field[0] & 0x80) {
+		value = field[0] & 0x7f;
+		for (int i = 1; i < size; ++i) {
+			value = (value << 8) | uchar(field[i]);
+		}
+		return value;
+	}
+	int i = 0;
+	while (i < size && field[i] == ' ') {
+		++i;
+	}
+	for (; i < size && field[i] >= '0' && field[i] <= '7'; ++i) {
+		value = value * 8 + (field[i] - '0');
+	}
+	return value;
+}
+static QByteArray tarString(const char *field, const int size)
+{
+	return QByteArray(field, int(qstrnlen(field, uint(size))));
+}
+static bool tarChecksumMatches(const char *header)
+{
+	qint64 sum = 0;
+	for (int i = 0; i < tarBlockSize; ++i) {
+		// the checksum field itself counts as spaces
+		sum += (i >= 148 && i < 156) ? ' ' : uchar(header[i]);
+	}
+	return sum == tarNumber(header + 148, 8);
+}
+
+QFile::Permissions toPermissions(const qint64 mode)
+{
+	static const QPair<qint64, QFile::Permissions> bits[] = {
+		{0400, QFile::ReadOwner | QFile::ReadUser}, {0200, QFile::WriteOwner | QFile::WriteUser}, {0100, QFile::ExeOwner | QFile::ExeUser},
+		{0040, QFile::ReadGroup}, {0020, QFile::WriteGroup}, {0010, QFile::ExeGroup},
+		{0004, QFile::ReadOther}, {0002, QFile::WriteOther}, {0001, QFile::ExeOther}
+	};
+	QFile::Permissions permissions;
+	for (const auto &bit : bits) {
+		if (mode & bit.first) {
+			permissions |= bit.second;
+		}
+	}
+	return permissions;
+}
+
+QString entryPath(const QDir &destination, const QByteArray &name)
+{
+	const QString clean = QDir::cleanPath(QString::fromUtf8(name));
+	if (clean.isEmpty() || QDir::isAbsolutePath(clean) || clean == ".." || clean.startsWith("../")) {
+		throw ArchiveException("Refusing to extract %1, it is outside of the destination" % QString::fromUtf8(name));
+	}
+	// whatever already exists on the way could be a link extracted earlier, which might lead anywhere
+	for (int slash = clean.indexOf('/'); ; slash = clean.indexOf('/', slash + 1)) {
+		if (QFileInfo(destination.absoluteFilePath(slash < 0 ? clean : clean.left(slash))).isSymLink()) {
+			throw ArchiveException("Refusing to extract %1, it would go through a link" % QString::fromUtf8(name));
+		}
+		if (slash < 0) {
+			break;
+		}
+	}
+	return destination.absoluteFilePath(clean);
+}
+
+void extractTar(QIODevice *device, const QDir &destination, const Notifier &notifier, const QIODevice *progressSource)
+{
+	if (!destination.mkpath(".")) {
+		throw ArchiveException("Unable to create directory");
+	}
 
-		KArchive *ark = nullptr;
-		if (mimetype.inherits("application/x-compressed-tar") || mimetype.inherits("application/x-bzip-compressed-tar") ||
-				mimetype.inherits("application/x-lzma-compressed-tar") || mimetype.inherits("application-xz-compressed-tar") ||
-				mimetype.inherits("application/x-tar")) {
-			ark = new KTar(filename);
-		} else if (mimetype.inherits("application/zip")) {
-			ark = new KZip(filename);
-		} else if (mimetype.inherits("application/x-7z-compressed")) {
-			ark = new K7Zip(filename);
-		} else if (mimetype.inherits("application/x-archive")) {
-			ark = new KAr(filename);
+	// extended headers (GNU long names and pax) apply to the entry that follows them
+	QByteArray longName;
+	QByteArray longLink;
+	QHash<QByteArray, QByteArray> pax;
+
+	// links come last, so that nothing can be written or read through them. name and target of each
+	QVector<QPair<QByteArray, QByteArray>> hardLinks;
+	QVector<QPair<QByteArray, QByteArray>> symLinks;
+
+	char header[tarBlockSize];
+	while (true) {
+		notifier.checkCanceled();
+		if (progressSource) {
+			notifier.progress(std::size_t(progressSource->pos()), std::size_t(progressSource->size()));
+		}
+		readFully(device, header, tarBlockSize);
+		if (std::all_of(header, header + tarBlockSize, [](const char c) { return c == 0; })) {
+			break;
+		}
+		if (!tarChecksumMatches(header)) {
+			throw ArchiveException("Corrupt tar archive");
 		}
 
-		if (!ark->open(QIODevice::ReadOnly)) {
-			throw ArchiveException("Unable to open archive");
+		const char type = header[156];
+		qint64 size = tarNumber(header + 124, 12);
+		QByteArray name = tarString(header, 100);
+		QByteArray link = tarString(header + 157, 100);
+		if (std::memcmp(header + 257, "ustar", 5) == 0) {
+			const QByteArray prefix = tarString(header + 345, 155);
+			if (!prefix.isEmpty()) {
+				name = prefix + '/' + name;
+			}
 		}
 
-		// the following code is taken from KArchiveDirectory::copyTo
+		if (type == 'L') {
+			longName = tarString(readEntryData(device, size).constData(), int(size));
+			continue;
+		} else if (type == 'K') {
+			longLink = tarString(readEntryData(device, size).constData(), int(size));
+			continue;
+		} else if (type == 'x') {
+			// records are "<length> <key>=<value>\n"
+			const QByteArray data = readEntryData(device, size);
+			int pos = 0;
+			while (pos < data.size()) {
+				const int space = data.indexOf(' ', pos);
+				const int length = data.mid(pos, space - pos).toInt();
+				if (space < 0 || length <= 0) {
+					break;
+				}
+				const QByteArray record = data.mid(space + 1, pos + length - space - 2);
+				const int equals = record.indexOf('=');
+				pax.insert(record.left(equals), record.mid(equals + 1));
+				pos += length;
+			}
+			continue;
+		} else if (type == 'g') {
+			readEntryData(device, size, [](const char *, const qint64) {});
+			continue;
+		}
 
-		QVector<const KArchiveFile *> fileList;
-		QHash<qint64, QString> fileToDir;
-		std::size_t totalSize = 0;
+		if (pax.contains("path")) {
+			name = pax.value("path");
+		} else if (!longName.isEmpty()) {
+			name = longName;
+		}
+		if (pax.contains("linkpath")) {
+			link = pax.value("linkpath");
+		} else if (!longLink.isEmpty()) {
+			link = longLink;
+		}
+		if (pax.contains("size")) {
+			size = pax.value("size").toLongLong();
+		}
+		longName.clear();
+		longLink.clear();
+		pax.clear();
 
-		// placeholders for iterated items
-		QStack<const KArchiveDirectory *> dirStack;
-		QStack<QString> dirNameStack;
+		if (type == '2' || type == '1') {
+			(type == '2' ? symLinks : hardLinks).append(qMakePair(name, link));
+			readEntryData(device, size, [](const char *, const qint64) {});
+			continue;
+		}
 
-		dirStack.push(ark->directory());               // init stack at current directory
-		dirNameStack.push(destination.absolutePath()); // ... with given path
-		do {
-			const KArchiveDirectory *curDir = dirStack.pop();
-			const QString curDirName = dirNameStack.pop();
-			if (!destination.mkpath(curDirName)) {
+		const QString path = entryPath(destination, name);
+		if (type == '5') {
+			if (!QDir().mkpath(path)) {
 				throw ArchiveException("Unable to create directory");
 			}
+		} else if (type == '0' || type == '\0' || type == '7') {
+			QDir().mkpath(QFileInfo(path).absolutePath());
+			QFile file(path);
+			if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+				throw ArchiveException("Unable to extract file: " + file.errorString());
+			}
+			readEntryData(device, size, [&file](const char *data, const qint64 length)
+			{
+				if (file.write(data, length) != length) {
+					throw ArchiveException("Unable to extract file: " + file.errorString());
+				}
+			});
+			file.close();
+			file.setPermissions(toPermissions(tarNumber(header + 100, 8)));
+			continue;
+		}
+		// devices, fifos and anything else we don't know about are skipped
+		readEntryData(device, size, [](const char *, const qint64) {});
+	}
 
-			const QStringList dirEntries = curDir->entries();
-			for (const QString &dirEntry : dirEntries) {
-				const KArchiveEntry *curEntry = curDir->entry(dirEntry);
-				if (!curEntry->symLinkTarget().isEmpty()) {
-					QString linkName = curDirName + QLatin1Char('/') + curEntry->name();
-					// To create a valid link on Windows, linkName must have a .lnk file extension.
+	// hard links refer to an earlier entry of the archive, so they go before any symlink exists
+	for (const QPair<QByteArray, QByteArray> &link : hardLinks) {
+		const QString path = entryPath(destination, link.first);
+		QDir().mkpath(QFileInfo(path).absolutePath());
+		QFile::remove(path);
+		if (!QFile::copy(entryPath(destination, link.second), path)) {
+			throw ArchiveException("Unable to extract link %1" % path);
+		}
+	}
+	// symlinks keep their target as is
+	for (const QPair<QByteArray, QByteArray> &link : symLinks) {
+		const QString path = entryPath(destination, link.first);
+		QDir().mkpath(QFileInfo(path).absolutePath());
+		QFile::remove(path);
+		if (!QFile::link(QString::fromUtf8(link.second), path)) {
+			throw ArchiveException("Unable to extract link %1" % path);
+		}
+	}
+}
+
+namespace {
+enum class Format
+{
+	Tar, // possibly compressed, the decompression finds out by itself
+	Zip,
+	SevenZip,
+	Ar
+};
+}
+
+// by the magic bytes at the start, 8 bytes are enough
+static Format detectFormat(const QByteArray &magic)
+{
+	if (magic.startsWith("PK\x03\x04") || magic.startsWith("PK\x05\x06")) {
+		return Format::Zip;
+	} else if (magic.startsWith("7z\xbc\xaf\x27\x1c")) {
+		return Format::SevenZip;
+	} else if (magic.startsWith("!<arch>\n")) {
+		return Format::Ar;
+	} else {
+		return Format::Tar;
+	}
+}
+
+// tar or zip in a single pass from front to back, which also works while the archive is still being downloaded
+static void extractStream(QIODevice *device, const QDir &destination, const Notifier &notifier)
+{
+	const QIODevice *progressSource = device->isSequential() ? nullptr : device;
+	ByteReader reader(device);
+	reader.fill(8);
+	const Format format = detectFormat(QByteArray::fromRawData(reader.data(), int(reader.available())));
+	if (format == Format::Zip) {
+		extractZip(reader, destination, notifier, progressSource);
+	} else if (format == Format::Tar) {
+		DecompressingDevice decompressed(std::move(reader));
+		extractTar(&decompressed, destination, notifier, progressSource);
+	} else {
+		throw ArchiveException("Only tar and zip archives can be extracted while downloading");
+	}
+}
+
+Future<void> extract(const QUrl &url, const QDir &destination, const QByteArray &sha256)
+{
+	return async([url, destination, sha256](Notifier notifier)
+	{
+		const std::shared_ptr<Network::DownloadCache> cache = Network::DownloadManager::instance()->cache();
+		if (cache && cache->contains(sha256.toLower())) {
+			notifier.status("Extracting cached %1..." % url.toString());
+			notifier.await(extract(cache->path(sha256.toLower()), destination));
+			return;
+		}
+
+		const std::shared_ptr<RingBuffer> buffer = std::make_shared<RingBuffer>();
+		Future<void> download = Network::DownloadManager::instance()->stream(url, buffer, sha256);
+		download.start();
+
+		// nothing may end up in destination unless the download completes and matches the checksum
+		const QDir staging = destination.absolutePath() + ".extracting";
+		FS::remove(staging);
+		notifier.status("Downloading and extracting %1..." % url.toString());
+		try {
+			extractStream(buffer.get(), staging, notifier);
+			// whatever follows the archive (tar padding, zip trailers) still has to go through the checksum
+			char rest[64 * 1024];
+			while (buffer->read(rest, sizeof(rest)) > 0) {}
+		} catch (...) {
+			// a failed download shows up as a truncated archive, report the real reason
+			const std::exception_ptr networkError = buffer->error();
+			buffer->abort();
+			download.waitForFinished();
+			FS::remove(staging);
+			if (networkError) {
+				std::rethrow_exception(networkError);
+			}
+			throw;
+		}
+		try {
+			notifier.await(download);
+		} catch (...) {
+			FS::remove(staging);
+			throw;
+		}
+
+		if (!destination.exists() || destination.entryList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden).isEmpty()) {
+			QDir().rmdir(destination.absolutePath());
+			if (QDir().rename(staging.absolutePath(), destination.absolutePath())) {
+				return;
+			}
+		}
+		FS::mergeDirectoryInto(staging, destination, FS::Transfer::Move);
+		FS::remove(staging);
+	});
+}
+
+namespace {
+struct ExtractionJob
+{
+	QString path; // within the archive
+	QString directory;
+	qint64 position;
+	qint64 size;
+};
+}
+
+static std::unique_ptr<KArchive> openArchive(const QString &filename, const Format format)
+{
+	std::unique_ptr<KArchive> ark;
+	if (format == Format::SevenZip) {
+		ark = std::make_unique<K7Zip>(filename);
+	} else {
+		ark = std::make_unique<KAr>(filename);
+	}
+	if (!ark->open(QIODevice::ReadOnly)) {
+		throw ArchiveException("Unable to open archive");
+	}
+	return ark;
+}
+
+// creates directories and symlinks right away, and returns the files
+static QVector<ExtractionJob> prepareExtraction(const KArchive *ark, const QDir &destination)
+{
+	QVector<ExtractionJob> jobs;
+
+	// the following code is taken from KArchiveDirectory::copyTo
+
+	// placeholders for iterated items
+	QStack<const KArchiveDirectory *> dirStack;
+	QStack<QString> dirNameStack;
+	QStack<QString> dirPathStack;
+
+	dirStack.push(ark->directory());               // init stack at current directory
+	dirNameStack.push(destination.absolutePath()); // ... with given path
+	dirPathStack.push(QString());
+	do {
+		const KArchiveDirectory *curDir = dirStack.pop();
+		const QString curDirName = dirNameStack.pop();
+		const QString curDirPath = dirPathStack.pop();
+		if (!destination.mkpath(curDirName)) {
+			throw ArchiveException("Unable to create directory");
+		}
+
+		const QStringList dirEntries = curDir->entries();
+		for (const QString &dirEntry : dirEntries) {
+			const KArchiveEntry *curEntry = curDir->entry(dirEntry);
+			const QString entryPath = curDirPath.isEmpty() ? curEntry->name() : curDirPath + QLatin1Char('/') + curEntry->name();
+			if (!curEntry->symLinkTarget().isEmpty()) {
+				QString linkName = curDirName + QLatin1Char('/') + curEntry->name();
+				// To create a valid link on Windows, linkName must have a .lnk file extension.
 #ifdef Q_OS_WIN
-					if (!linkName.endsWith(QLatin1String(".lnk"))) {
-						linkName += QLatin1String(".lnk");
-					}
+				if (!linkName.endsWith(QLatin1String(".lnk"))) {
+					linkName += QLatin1String(".lnk");
+				}
 #endif
-					QFile symLinkTarget(curEntry->symLinkTarget());
-					if (!symLinkTarget.link(linkName)) {
-						throw ArchiveException("Unable to extract symlink: " + symLinkTarget.errorString());
-					}
-				} else {
-					if (curEntry->isFile()) {
-						const KArchiveFile *curFile = dynamic_cast<const KArchiveFile *>(curEntry);
-						if (curFile) {
-							fileList.append(curFile);
-							fileToDir.insert(curFile->position(), curDirName);
-							totalSize += std::size_t(curFile->size());
-						}
-					} else if (curEntry->isDirectory()) {
-						const KArchiveDirectory *ad = dynamic_cast<const KArchiveDirectory *>(curEntry);
-						if (ad) {
-							dirStack.push(ad);
-							dirNameStack.push(curDirName + QLatin1Char('/') + curEntry->name());
-						}
-					}
+				QFile symLinkTarget(curEntry->symLinkTarget());
+				if (!symLinkTarget.link(linkName)) {
+					throw ArchiveException("Unable to extract symlink: " + symLinkTarget.errorString());
+				}
+			} else if (curEntry->isFile()) {
+				const KArchiveFile *curFile = dynamic_cast<const KArchiveFile *>(curEntry);
+				if (curFile) {
+					jobs.append(ExtractionJob{entryPath, curDirName, curFile->position(), curFile->size()});
+				}
+			} else if (curEntry->isDirectory()) {
+				const KArchiveDirectory *ad = dynamic_cast<const KArchiveDirectory *>(curEntry);
+				if (ad) {
+					dirStack.push(ad);
+					dirNameStack.push(curDirName + QLatin1Char('/') + curEntry->name());
+					dirPathStack.push(entryPath);
 				}
 			}
-		} while (!dirStack.isEmpty());
+		}
+	} while (!dirStack.isEmpty());
 
-		std::sort(fileList.begin(), fileList.end(), [](const KArchiveFile *a, const KArchiveFile *b) { return a->position() < b->position(); });    // sort on d->pos, so we have a linear access
+	return jobs;
+}
 
-		notifier.progress(0, totalSize);
+// balances the total size, each part sorted by position so that it is read linearly
+template <typename T, typename Size, typename Position>
+static QVector<QVector<T>> partition(QVector<T> jobs, const int parts, Size &&size, Position &&position)
+{
+	std::sort(jobs.begin(), jobs.end(), [&size](const T &a, const T &b) { return size(a) > size(b); });
+	QVector<QVector<T>> out(parts);
+	QVector<qint64> sizes(parts, 0);
+	for (const T &job : jobs) {
+		const int smallest = int(std::min_element(sizes.begin(), sizes.end()) - sizes.begin());
+		out[smallest].append(job);
+		sizes[smallest] += size(job);
+	}
+	for (QVector<T> &part : out) {
+		std::sort(part.begin(), part.end(), [&position](const T &a, const T &b) { return position(a) < position(b); });
+	}
+	return out;
+}
 
-		std::size_t currentSize = 0;
+static void extractFiles(const KArchive *ark, const QVector<ExtractionJob> &jobs, const std::shared_ptr<std::atomic<std::size_t>> &extracted, const std::size_t total, const Notifier &notifier)
+{
+	for (const ExtractionJob &job : jobs) {
+		notifier.checkCanceled();
+		const KArchiveFile *file = dynamic_cast<const KArchiveFile *>(ark->directory()->entry(job.path));
+		if (!file || !file->copyTo(job.directory)) {
+			throw ArchiveException("Unable to extract file");
+		}
+		notifier.progress(*extracted += std::size_t(job.size), total);
+	}
+}
 
-		for (const KArchiveFile *f : fileList) {
-			qint64 pos = f->position();
-			if (!f->copyTo(fileToDir[pos])) {
-				throw ArchiveException("Unable to extract file");
-			}
-			currentSize += std::size_t(f->size());
-			notifier.progress(currentSize, totalSize);
+// zip entries are compressed independently, so workers that each read through their own file can extract them in parallel
+static void extractZipFile(QFile &file, const QDir &destination, const int threads, const Notifier &notifier)
+{
+	if (!destination.mkpath(".")) {
+		throw ArchiveException("Unable to create directory");
+	}
+
+	QVector<ZipEntry> directories;
+	QVector<ZipEntry> files;
+	QVector<ZipEntry> links;
+	std::size_t total = 0;
+	for (const ZipEntry &entry : readZipDirectory(&file)) {
+		(entry.isDirectory() ? directories : entry.isSymlink() ? links : files).append(entry);
+		total += std::size_t(entry.compressedSize);
+	}
+	const auto extracted = std::make_shared<std::atomic<std::size_t>>(0);
+	const std::function<void(qint64)> progress = [extracted, total, notifier](const qint64 size) { notifier.progress(*extracted += std::size_t(size), total); };
+	notifier.progress(0, total);
+
+	extractZipEntries(&file, directories, destination, notifier, progress);
+	const int workers = std::max(1, std::min(threads, files.size()));
+	if (workers == 1) {
+		extractZipEntries(&file, files, destination, notifier, progress);
+	} else {
+		const QString filename = file.fileName();
+		QVector<Future<void>> futures;
+		const auto size = [](const ZipEntry &entry) { return entry.compressedSize; };
+		const auto position = [](const ZipEntry &entry) { return entry.offset; };
+		for (const QVector<ZipEntry> &part : partition(files, workers, size, position)) {
+			futures.append(async(Executor::instance(), [filename, destination, part, progress, notifier](Notifier workerNotifier)
+			{
+				workerNotifier.checkCanceled();
+				QFile file(filename);
+				if (!file.open(QFile::ReadOnly)) {
+					throw ArchiveException("Unable to open archive: " + file.errorString());
+				}
+				extractZipEntries(&file, part, destination, notifier, progress);
+			}));
+			futures.last().start();
+		}
+		notifier.await(whenAll(futures));
+	}
+	// links come last, so that nothing can be written through them
+	extractZipEntries(&file, links, destination, notifier, progress);
+}
+
+Future<void> extract(const QString &filename, const QDir &destination, const int threads)
+{
+	return async([filename, destination, threads](Notifier notifier)
+	{
+		QFile file(filename);
+		if (!file.open(QFile::ReadOnly)) {
+			throw ArchiveException("Unable to open archive: " + file.errorString());
+		}
+		const Format format = detectFormat(file.peek(8));
+		const int maxWorkers = threads > 0 ? threads : int(Executor::instance()->threadCount());
+		if (format == Format::Tar) {
+			extractStream(&file, destination, notifier);
+			return;
+		} else if (format == Format::Zip) {
+			extractZipFile(file, destination, maxWorkers, notifier);
+			return;
+		}
+		file.close();
+
+		const std::shared_ptr<KArchive> ark = openArchive(filename, format);
+		const QVector<ExtractionJob> jobs = prepareExtraction(ark.get(), destination);
+		const std::size_t total = std::accumulate(jobs.begin(), jobs.end(), std::size_t(0), [](const std::size_t sum, const ExtractionJob &job) { return sum + std::size_t(job.size); });
+		const auto extracted = std::make_shared<std::atomic<std::size_t>>(0);
+		notifier.progress(0, total);
+
+		// 7z keeps everything in memory after opening, so only the writing happens in parallel. ar is not worth the trouble
+		const int workers = format != Format::SevenZip ? 1 : std::max(1, std::min(maxWorkers, jobs.size()));
+		if (workers == 1) {
+			extractFiles(ark.get(), jobs, extracted, total, notifier);
+			return;
+		}
+
+		QVector<Future<void>> futures;
+		const auto size = [](const ExtractionJob &job) { return job.size; };
+		const auto position = [](const ExtractionJob &job) { return job.position; };
+		for (const QVector<ExtractionJob> &part : partition(jobs, workers, size, position)) {
+			futures.append(async(Executor::instance(), [ark, part, extracted, total, notifier](Notifier workerNotifier)
+			{
+				workerNotifier.checkCanceled();
+				extractFiles(ark.get(), part, extracted, total, notifier);
+			}));
+			futures.last().start();
 		}
+		notifier.await(whenAll(futures));
 	});
 }
 
@@ -20,6 +20,8 @@
 
 QT_BEGIN_NAMESPACE
 class QDir;
+class QIODevice;
+class QUrl;
 QT_END_NAMESPACE
 
 namespace Ralph {
@@ -28,8 +30,25 @@ namespace Archive {
 
 DECLARE_EXCEPTION(Archive);
 
-Future<void> extract(const QString &filename, const QDir &destination);
+/** Extracts the file, which may be a (gzip, bzip2, xz or zstd compressed) tar, zip, 7z or ar archive
+ *
+ * The format is detected from the content, the name of the file doesn't matter. The entries of zip
+ * and 7z archives are extracted by up to threads workers in parallel, by default as many as the
+ * executor has threads. Tar archives are streamed through sequentially.
+ */
+Future<void> extract(const QString &filename, const QDir &destination, const int threads = 0);
+/** Extracts a tar or zip archive while it is being downloaded, without ever storing the archive
+ *
+ * The content is extracted to a directory next to destination first and only moved into place
+ * once the download has completed and matched sha256 (if given). With the cache containing sha256
+ * the network is not used at all.
+ */
+Future<void> extract(const QUrl &url, const QDir &destination, const QByteArray &sha256 = QByteArray());
 
+/// Extracts an uncompressed tar archive from device, which is read strictly sequentially. Progress is taken from the position in progressSource
+void extractTar(QIODevice *device, const QDir &destination, const Notifier &notifier, const QIODevice *progressSource = nullptr);
+/// Extracts a zip archive from device in a single pass, permissions and symlinks are applied once the central directory is reached
+void extractZip(QIODevice *device, const QDir &destination, const Notifier &notifier, const QIODevice *progressSource = nullptr);
 }
 }
 }
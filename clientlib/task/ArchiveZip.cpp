@@ -0,0 +1,394 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Archive_p.h"
+
+#include <QFileInfo>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+#include <zlib.h>
+
+#include "Decompressor.h"
+
+namespace Ralph {
+namespace ClientLib {
+namespace Archive {
+
+static constexpr quint32 localHeaderSignature = 0x04034b50;
+static constexpr quint32 centralHeaderSignature = 0x02014b50;
+static constexpr quint32 zip64LocatorSignature = 0x07064b50;
+static constexpr quint32 zip64EndOfDirectorySignature = 0x06064b50;
+static constexpr quint32 dataDescriptorSignature = 0x08074b50;
+static constexpr qint64 localHeaderSize = 30;
+static constexpr qint64 centralHeaderSize = 46;
+static constexpr qint64 endOfDirectorySize = 22;
+static constexpr qint64 zip64EndOfDirectorySize = 56;
+static constexpr int bufferSize = 256 * 1024;
+
+static inline quint16 readUInt16(const char *data)
+{
+	return qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(data));
+}
+static inline quint32 readUInt32(const char *data)
+{
+	return qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(data));
+}
+static inline quint64 readUInt64(const char *data)
+{
+	return qFromLittleEndian<quint64>(reinterpret_cast<const uchar *>(data));
+}
+
+static Compression compressionForMethod(const ZipEntry &entry)
+{
+	switch (entry.method) {
+	case 8: return Compression::Deflate;
+	case 12: return Compression::BZip2;
+	case 93: return Compression::Zstd;
+	case 95: return Compression::Xz;
+	default: throw ArchiveException(QString("Unable to extract %1, compression method %2 is not supported") % QString::fromUtf8(entry.name) % entry.method);
+	}
+}
+
+// values that don't fit into the header are in the zip64 extra field, in this order. @returns true if there is one
+static bool applyZip64(ZipEntry &entry, const QByteArray &extra, const bool withOffset)
+{
+	int pos = 0;
+	while (pos + 4 <= extra.size()) {
+		const quint16 id = readUInt16(extra.constData() + pos);
+		const int length = std::min(int(readUInt16(extra.constData() + pos + 2)), extra.size() - pos - 4);
+		if (id == 0x0001) {
+			const char *field = extra.constData() + pos + 4;
+			const char *end = field + length;
+			const auto next = [&field, end](qint64 &value)
+			{
+				if (value == 0xffffffff && field + 8 <= end) {
+					value = qint64(readUInt64(field));
+					field += 8;
+				}
+			};
+			next(entry.size);
+			next(entry.compressedSize);
+			if (withOffset) {
+				next(entry.offset);
+			}
+			return true;
+		}
+		pos += 4 + length;
+	}
+	return false;
+}
+
+static ZipEntry readLocalHeader(ByteReader &reader)
+{
+	const QByteArray header = reader.read(localHeaderSize);
+	const char *data = header.constData();
+	if (readUInt32(data) != localHeaderSignature) {
+		throw ArchiveException("Corrupt zip archive");
+	}
+	ZipEntry entry;
+	entry.flags = readUInt16(data + 6);
+	entry.method = readUInt16(data + 8);
+	entry.crc = readUInt32(data + 14);
+	entry.compressedSize = readUInt32(data + 18);
+	entry.size = readUInt32(data + 22);
+	entry.name = reader.read(readUInt16(data + 26));
+	entry.zip64 = applyZip64(entry, reader.read(readUInt16(data + 28)), false);
+	return entry;
+}
+static ZipEntry readCentralHeader(ByteReader &reader)
+{
+	const QByteArray header = reader.read(centralHeaderSize);
+	const char *data = header.constData();
+	if (readUInt32(data) != centralHeaderSignature) {
+		throw ArchiveException("Corrupt zip archive");
+	}
+	ZipEntry entry;
+	entry.flags = readUInt16(data + 8);
+	entry.method = readUInt16(data + 10);
+	entry.crc = readUInt32(data + 16);
+	entry.compressedSize = readUInt32(data + 20);
+	entry.size = readUInt32(data + 24);
+	entry.offset = readUInt32(data + 42);
+	// the upper byte of "version made by" is the host system, 3 is unix
+	if ((readUInt16(data + 4) >> 8) == 3) {
+		entry.mode = readUInt32(data + 38) >> 16;
+	}
+	entry.name = reader.read(readUInt16(data + 28));
+	applyZip64(entry, reader.read(readUInt16(data + 30)), true);
+	reader.skip(readUInt16(data + 32));
+	return entry;
+}
+
+// passes the uncompressed data of entry on in chunks, a compressedSize of -1 means that it's unknown. @returns the crc32 of the data
+template <typename Func>
+static quint32 readZipData(ByteReader &reader, const ZipEntry &entry, QByteArray &buffer, Func &&func)
+{
+	uLong crc = crc32(0, Z_NULL, 0);
+	const auto output = [&crc, &func](const char *data, const qint64 size)
+	{
+		crc = crc32(crc, reinterpret_cast<const Bytef *>(data), uInt(size));
+		func(data, size);
+	};
+
+	qint64 remaining = entry.compressedSize;
+	if (remaining == 0) {
+		return quint32(crc);
+	} else if (entry.method == 0 && remaining < 0) {
+		// stored, with the size only in the data descriptor: the data ends where a descriptor follows that has the size of what came before it
+		const qint64 descriptorSize = entry.zip64 ? 24 : 16;
+		qint64 done = 0;
+		while (true) {
+			if (!reader.fill(descriptorSize)) {
+				throw ArchiveException("Unexpected end of archive");
+			}
+			const char *data = reader.data();
+			const qint64 end = reader.available() - descriptorSize + 1;
+			qint64 length = end;
+			for (const char *candidate = data; (candidate = static_cast<const char *>(std::memchr(candidate, 'P', std::size_t(end - (candidate - data))))); ++candidate) {
+				const qint64 size = entry.zip64 ? qint64(readUInt64(candidate + 8)) : readUInt32(candidate + 8);
+				if (readUInt32(candidate) == dataDescriptorSignature && size == done + (candidate - data)) {
+					length = candidate - data;
+					break;
+				}
+			}
+			output(data, length);
+			reader.consume(length);
+			done += length;
+			if (length < end) {
+				return quint32(crc);
+			}
+		}
+	} else if (entry.method == 0) {
+		while (remaining > 0) {
+			if (!reader.fill(1)) {
+				throw ArchiveException("Unexpected end of archive");
+			}
+			const qint64 chunk = std::min(remaining, reader.available());
+			output(reader.data(), chunk);
+			reader.consume(chunk);
+			remaining -= chunk;
+		}
+		return quint32(crc);
+	}
+
+	const std::unique_ptr<Decoder> decoder = Decoder::create(compressionForMethod(entry));
+	bool end = false;
+	while (!end) {
+		if (remaining != 0 && reader.available() == 0 && !reader.fill(1)) {
+			throw ArchiveException("Unexpected end of archive");
+		}
+		// with an unknown size the decoder has to find the end, and may only consume what belongs to the entry
+		const char *in = reader.data();
+		const char *inEnd = in + (remaining < 0 ? reader.available() : std::min(remaining, reader.available()));
+		char *out = buffer.data();
+		end = decoder->decode(in, inEnd, out, buffer.data() + buffer.size());
+		const qint64 consumed = in - reader.data();
+		reader.consume(consumed);
+		if (remaining > 0) {
+			remaining -= consumed;
+		}
+		if (out != buffer.data()) {
+			output(buffer.constData(), out - buffer.data());
+		} else if (!end && remaining == 0) {
+			throw ArchiveException("Corrupt zip archive, the data of %1 is truncated" % QString::fromUtf8(entry.name));
+		}
+	}
+	if (remaining > 0) {
+		reader.skip(remaining);
+	}
+	return quint32(crc);
+}
+
+static void checkCrc(const ZipEntry &entry, const quint32 crc)
+{
+	if (crc != entry.crc) {
+		throw ArchiveException("Corrupt zip archive, checksum mismatch for %1" % QString::fromUtf8(entry.name));
+	}
+}
+
+// reads the data of entry, which starts at the current position of reader, to where it belongs. @returns the crc32 of the data
+static quint32 extractZipEntry(ByteReader &reader, const ZipEntry &entry, const QDir &destination, QByteArray &buffer)
+{
+	if (entry.flags & 0x1) {
+		throw ArchiveException("Unable to extract %1, encrypted zip archives are not supported" % QString::fromUtf8(entry.name));
+	}
+	const QString path = entryPath(destination, entry.name);
+
+	if (entry.isDirectory()) {
+		if (!QDir().mkpath(path)) {
+			throw ArchiveException("Unable to create directory");
+		}
+		return readZipData(reader, entry, buffer, [](const char *, const qint64) {});
+	}
+
+	QDir().mkpath(QFileInfo(path).absolutePath());
+	if (entry.isSymlink()) {
+		QByteArray target;
+		const quint32 crc = readZipData(reader, entry, buffer, [&target](const char *data, const qint64 size) { target.append(data, int(size)); });
+		QFile::remove(path);
+		if (!QFile::link(QString::fromUtf8(target), path)) {
+			throw ArchiveException("Unable to extract link %1" % path);
+		}
+		return crc;
+	}
+
+	QFile file(path);
+	if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+		throw ArchiveException("Unable to extract file: " + file.errorString());
+	}
+	const quint32 crc = readZipData(reader, entry, buffer, [&file](const char *data, const qint64 size)
+	{
+		if (file.write(data, size) != size) {
+			throw ArchiveException("Unable to extract file: " + file.errorString());
+		}
+	});
+	file.close();
+	if (entry.mode & 0777) {
+		file.setPermissions(toPermissions(entry.mode));
+	}
+	return crc;
+}
+
+// local headers don't contain the mode, so symlinks are extracted as files holding their target first
+static void applyMode(const ZipEntry &entry, const QDir &destination)
+{
+	if (entry.isSymlink()) {
+		const QString path = entryPath(destination, entry.name);
+		QFile file(path);
+		if (!file.open(QFile::ReadOnly)) {
+			throw ArchiveException("Unable to extract link %1" % path);
+		}
+		const QByteArray target = file.readAll();
+		file.close();
+		if (!file.remove() || !QFile::link(QString::fromUtf8(target), path)) {
+			throw ArchiveException("Unable to extract link %1" % path);
+		}
+	} else if (!entry.isDirectory() && (entry.mode & 0777)) {
+		QFile::setPermissions(entryPath(destination, entry.name), toPermissions(entry.mode));
+	}
+}
+
+QVector<ZipEntry> readZipDirectory(QIODevice *file)
+{
+	// the end of central directory record is at the very end, followed only by a comment of up to 64 KiB
+	const qint64 size = file->size();
+	const qint64 tailSize = std::min(size, endOfDirectorySize + 0xffff);
+	if (!file->seek(size - tailSize)) {
+		throw ArchiveException("Unable to read archive: " + file->errorString());
+	}
+	const QByteArray tail = file->read(tailSize);
+	const int end = tail.lastIndexOf("PK\x05\x06");
+	if (tail.size() != tailSize || end < 0 || end + endOfDirectorySize > tail.size()) {
+		throw ArchiveException("Corrupt zip archive, no central directory found");
+	}
+	qint64 count = readUInt16(tail.constData() + end + 10);
+	qint64 directoryOffset = readUInt32(tail.constData() + end + 16);
+
+	if (count == 0xffff || directoryOffset == 0xffffffff) {
+		const int locator = end - 20;
+		if (locator < 0 || readUInt32(tail.constData() + locator) != zip64LocatorSignature) {
+			throw ArchiveException("Corrupt zip archive, no zip64 central directory found");
+		}
+		if (!file->seek(qint64(readUInt64(tail.constData() + locator + 8)))) {
+			throw ArchiveException("Unable to read archive: " + file->errorString());
+		}
+		const QByteArray record = file->read(zip64EndOfDirectorySize);
+		if (record.size() != zip64EndOfDirectorySize || readUInt32(record.constData()) != zip64EndOfDirectorySignature) {
+			throw ArchiveException("Corrupt zip archive, no zip64 central directory found");
+		}
+		count = qint64(readUInt64(record.constData() + 32));
+		directoryOffset = qint64(readUInt64(record.constData() + 48));
+	}
+
+	ByteReader reader(file);
+	reader.seek(directoryOffset);
+	QVector<ZipEntry> entries;
+	entries.reserve(int(std::min(count, qint64(1024 * 1024))));
+	for (qint64 i = 0; i < count; ++i) {
+		entries.append(readCentralHeader(reader));
+	}
+	return entries;
+}
+
+void extractZipEntries(QIODevice *file, const QVector<ZipEntry> &entries, const QDir &destination, const Notifier &notifier, const std::function<void(qint64)> &progress)
+{
+	ByteReader reader(file);
+	QByteArray buffer(bufferSize, Qt::Uninitialized);
+	for (const ZipEntry &entry : entries) {
+		notifier.checkCanceled();
+		// the local header may have a different extra field, but the sizes are taken from the central directory
+		reader.seek(entry.offset);
+		const QByteArray header = reader.read(localHeaderSize);
+		if (readUInt32(header.constData()) != localHeaderSignature) {
+			throw ArchiveException("Corrupt zip archive");
+		}
+		reader.skip(readUInt16(header.constData() + 26) + readUInt16(header.constData() + 28));
+		checkCrc(entry, extractZipEntry(reader, entry, destination, buffer));
+		progress(entry.compressedSize);
+	}
+}
+
+void extractZip(ByteReader &reader, const QDir &destination, const Notifier &notifier, const QIODevice *progressSource)
+{
+	if (!destination.mkpath(".")) {
+		throw ArchiveException("Unable to create directory");
+	}
+
+	QByteArray buffer(bufferSize, Qt::Uninitialized);
+	while (true) {
+		notifier.checkCanceled();
+		if (progressSource) {
+			notifier.progress(std::size_t(progressSource->pos()), std::size_t(progressSource->size()));
+		}
+		if (!reader.fill(4)) {
+			throw ArchiveException("Unexpected end of archive");
+		}
+
+		const quint32 signature = readUInt32(reader.data());
+		if (signature == localHeaderSignature) {
+			ZipEntry entry = readLocalHeader(reader);
+			// crc and sizes follow the data, which has to end by itself
+			const bool hasDescriptor = entry.flags & 0x8;
+			if (hasDescriptor) {
+				entry.compressedSize = -1;
+			}
+			const quint32 crc = extractZipEntry(reader, entry, destination, buffer);
+			if (hasDescriptor) {
+				if (reader.fill(4) && readUInt32(reader.data()) == dataDescriptorSignature) {
+					reader.consume(4);
+				}
+				entry.crc = readUInt32(reader.read(entry.zip64 ? 20 : 12).constData());
+			}
+			checkCrc(entry, crc);
+		} else if (signature == centralHeaderSignature) {
+			applyMode(readCentralHeader(reader), destination);
+		} else {
+			// the end of the central directory, or the records leading up to it
+			break;
+		}
+	}
+}
+
+void extractZip(QIODevice *device, const QDir &destination, const Notifier &notifier, const QIODevice *progressSource)
+{
+	ByteReader reader(device);
+	extractZip(reader, destination, notifier, progressSource);
+}
+
+}
+}
+}
@@ -0,0 +1,59 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <QDir>
+#include <QFile>
+#include <QVector>
+#include <functional>
+
+#include "Archive.h"
+
+namespace Ralph {
+namespace ClientLib {
+namespace Archive {
+class ByteReader;
+
+/// @returns the absolute path of name within destination, throws if it would end up outside of it or go through an existing link
+QString entryPath(const QDir &destination, const QByteArray &name);
+QFile::Permissions toPermissions(const qint64 mode);
+
+struct ZipEntry
+{
+	QByteArray name;
+	quint16 flags = 0;
+	quint16 method = 0;
+	quint32 crc = 0;
+	qint64 compressedSize = 0;
+	qint64 size = 0;
+	qint64 offset = 0; // of the local header
+	qint64 mode = 0; // unix mode, 0 unless the archive was created on unix
+	bool zip64 = false; // of a local header, the data descriptor then has 64 bit sizes
+
+	bool isDirectory() const { return name.endsWith('/') || (mode & 0170000) == 0040000; }
+	bool isSymlink() const { return (mode & 0170000) == 0120000; }
+};
+
+/// Reads the central directory at the end of file
+QVector<ZipEntry> readZipDirectory(QIODevice *file);
+/// Extracts the given entries of file, in the given order. progress is called with the compressed size of each completed entry
+void extractZipEntries(QIODevice *file, const QVector<ZipEntry> &entries, const QDir &destination, const Notifier &notifier, const std::function<void(qint64)> &progress);
+/// Like extractZip, for when the first bytes have already been read through reader
+void extractZip(ByteReader &reader, const QDir &destination, const Notifier &notifier, const QIODevice *progressSource);
+
+}
+}
+}
@@ -0,0 +1,180 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#if defined(RALPH_COROUTINES) && defined(__cpp_impl_coroutine)
+#define RALPH_HAS_COROUTINES 1
+
+#include <coroutine>
+
+#include "task/Task.h"
+
+/* Lets functions returning Future<T> be written as coroutines:
+ *
+ * Future<int> answer()
+ * {
+ *     Notifier notifier = co_await thisNotifier();
+ *     notifier.status("Thinking...");
+ *     co_return co_await other() + 2;
+ * }
+ *
+ * Like tasks the coroutine only starts once the future is started, and runs on the shared executor.
+ * co_await on a future suspends the coroutine instead of blocking a thread, it is resumed once the
+ * future has finished.
+ */
+
+namespace Ralph {
+namespace ClientLib {
+namespace Private {
+template <typename T> class CoroutinePromise;
+
+template <typename T>
+class BaseCoroutinePromise
+{
+public:
+	BaseCoroutinePromise()
+	{
+		// the frame owns the promise, so it has to be destroyed before completing
+		m_promise.schedule(Executor::instance(), [this]() { handle().resume(); });
+	}
+
+	Future<T> get_return_object() { return m_promise.future(); }
+
+	auto initial_suspend() noexcept
+	{
+		struct Awaiter
+		{
+			BaseCoroutinePromise<T> *self;
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(std::coroutine_handle<>) const noexcept {}
+			void await_resume() const { self->m_promise.reportStarted(); }
+		};
+		return Awaiter{this};
+	}
+	auto final_suspend() noexcept
+	{
+		struct Awaiter
+		{
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(std::coroutine_handle<> handle) const noexcept
+			{
+				BaseCoroutinePromise<T> &self = std::coroutine_handle<CoroutinePromise<T>>::from_address(handle.address()).promise();
+				BasePromise promise = self.m_promise;
+				const bool failed = self.m_failed;
+				handle.destroy();
+				if (!failed) {
+					promise.reportFinished();
+				}
+				promise.complete();
+			}
+			void await_resume() const noexcept {}
+		};
+		return Awaiter{};
+	}
+	void unhandled_exception()
+	{
+		m_failed = true;
+		if (m_promise.isCanceled()) {
+			m_promise.reportCanceled();
+		} else {
+			m_promise.reportException(std::current_exception());
+		}
+	}
+
+	BasePromise &promise() { return m_promise; }
+
+protected:
+	Promise<T> m_promise;
+	bool m_failed = false;
+
+	std::coroutine_handle<> handle()
+	{
+		return std::coroutine_handle<CoroutinePromise<T>>::from_promise(static_cast<CoroutinePromise<T> &>(*this));
+	}
+};
+
+template <typename T>
+class CoroutinePromise : public BaseCoroutinePromise<T>
+{
+public:
+	void return_value(T value) { this->m_promise.reportResult(std::move(value)); }
+};
+template <>
+class CoroutinePromise<void> : public BaseCoroutinePromise<void>
+{
+public:
+	void return_void() {}
+};
+
+template <typename T>
+class FutureAwaiter
+{
+	Future<T> m_future;
+	BasePromise *m_promise = nullptr;
+public:
+	explicit FutureAwaiter(const Future<T> &future) : m_future(future) {}
+
+	bool await_ready() const noexcept { return false; }
+	template <typename Promise>
+	void await_suspend(std::coroutine_handle<Promise> handle)
+	{
+		m_promise = &handle.promise().promise();
+		m_promise->delegateFrom(m_future);
+		// resume from the executor, so that chains of finished futures don't grow the stack
+		m_future.onFinished([handle]() { Executor::instance()->post([handle]() { handle.resume(); }); });
+	}
+	T await_resume()
+	{
+		m_promise->stopDelegatingFrom(m_future);
+		return m_future.result();
+	}
+};
+
+struct NotifierAwaiter
+{
+	BasePromise *promise = nullptr;
+
+	bool await_ready() const noexcept { return false; }
+	template <typename Promise>
+	bool await_suspend(std::coroutine_handle<Promise> handle) noexcept
+	{
+		promise = &handle.promise().promise();
+		return false;
+	}
+	Notifier await_resume() const { return Notifier(*promise); }
+};
+
+}
+
+template <typename T>
+Private::FutureAwaiter<T> operator co_await(const Future<T> &future)
+{
+	return Private::FutureAwaiter<T>(future);
+}
+
+/// co_await thisNotifier() gives a coroutine the Notifier a task would get as argument
+inline Private::NotifierAwaiter thisNotifier() { return {}; }
+
+}
+}
+
+template <typename T, typename... Args>
+struct std::coroutine_traits<Ralph::ClientLib::Future<T>, Args...>
+{
+	using promise_type = Ralph::ClientLib::Private::CoroutinePromise<T>;
+};
+
+#endif
@@ -0,0 +1,353 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Decompressor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include <zlib.h>
+#include <bzlib.h>
+#include <lzma.h>
+#include <zstd.h>
+
+#include "Archive.h"
+
+namespace Ralph {
+namespace ClientLib {
+namespace Archive {
+
+Compression detectCompression(const QByteArray &magic)
+{
+	if (magic.startsWith("\x1f\x8b")) {
+		return Compression::GZip;
+	} else if (magic.startsWith("BZh")) {
+		return Compression::BZip2;
+	} else if (magic.startsWith(QByteArray("\xfd" "7zXZ\0", 6))) {
+		return Compression::Xz;
+	} else if (magic.startsWith("\x28\xb5\x2f\xfd")) {
+		return Compression::Zstd;
+	} else {
+		return Compression::None;
+	}
+}
+
+ByteReader::ByteReader(QIODevice *device, const int capacity)
+	: m_device(device), m_buffer(capacity, Qt::Uninitialized) {}
+
+bool ByteReader::fill(const qint64 size)
+{
+	if (available() >= size) {
+		return true;
+	}
+	if (m_begin > 0) {
+		std::memmove(m_buffer.data(), data(), std::size_t(available()));
+		m_end -= m_begin;
+		m_begin = 0;
+	}
+	if (size > m_buffer.size()) {
+		m_buffer.resize(int(size));
+	}
+	while (available() < size && !m_atEnd) {
+		const qint64 read = m_device->read(m_buffer.data() + m_end, m_buffer.size() - m_end);
+		if (read <= 0) {
+			m_atEnd = true;
+			if (read < 0) {
+				m_error = m_device->errorString();
+			}
+		} else {
+			m_end += read;
+		}
+	}
+	return available() >= size;
+}
+
+QByteArray ByteReader::read(const qint64 size)
+{
+	if (!fill(size)) {
+		throw ArchiveException(m_error.isEmpty() ? QStringLiteral("Unexpected end of archive") : m_error);
+	}
+	const QByteArray out(data(), int(size));
+	consume(size);
+	return out;
+}
+
+void ByteReader::skip(qint64 size)
+{
+	while (size > 0) {
+		if (!fill(1)) {
+			throw ArchiveException(m_error.isEmpty() ? QStringLiteral("Unexpected end of archive") : m_error);
+		}
+		const qint64 chunk = std::min(size, available());
+		consume(chunk);
+		size -= chunk;
+	}
+}
+
+void ByteReader::seek(const qint64 position)
+{
+	// the device is at the end of the buffer
+	const qint64 bufferStart = m_device->pos() - m_end;
+	if (position >= bufferStart && position <= bufferStart + m_end) {
+		m_begin = position - bufferStart;
+		return;
+	}
+	if (!m_device->seek(position)) {
+		throw ArchiveException("Unable to read archive: " + m_device->errorString());
+	}
+	m_begin = m_end = 0;
+	m_atEnd = false;
+	m_error.clear();
+}
+
+Decoder::~Decoder() {}
+
+namespace {
+// the libraries count in unsigned int, our buffers never get that large but the caller's might
+template <typename T>
+T clampedSize(const char *begin, const char *end)
+{
+	return T(std::min<qint64>(end - begin, qint64(std::numeric_limits<T>::max())));
+}
+
+class PassthroughDecoder : public Decoder
+{
+public:
+	bool decode(const char *&in, const char *inEnd, char *&out, char *outEnd) override
+	{
+		const qint64 size = std::min(inEnd - in, outEnd - out);
+		std::memcpy(out, in, std::size_t(size));
+		in += size;
+		out += size;
+		return false;
+	}
+};
+
+class ZlibDecoder : public Decoder
+{
+public:
+	explicit ZlibDecoder(const int windowBits)
+	{
+		std::memset(&m_stream, 0, sizeof(m_stream));
+		if (inflateInit2(&m_stream, windowBits) != Z_OK) {
+			throw ArchiveException("Unable to initialize zlib");
+		}
+	}
+	~ZlibDecoder() override
+	{
+		inflateEnd(&m_stream);
+	}
+
+	bool decode(const char *&in, const char *inEnd, char *&out, char *outEnd) override
+	{
+		m_stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in));
+		m_stream.avail_in = clampedSize<uInt>(in, inEnd);
+		m_stream.next_out = reinterpret_cast<Bytef *>(out);
+		m_stream.avail_out = clampedSize<uInt>(out, outEnd);
+		const int ret = inflate(&m_stream, Z_NO_FLUSH);
+		in = reinterpret_cast<const char *>(m_stream.next_in);
+		out = reinterpret_cast<char *>(m_stream.next_out);
+		if (ret == Z_STREAM_END) {
+			return true;
+		} else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+			throw ArchiveException("Corrupt compressed data: %1" % QString::fromLatin1(m_stream.msg ? m_stream.msg : "unknown error"));
+		}
+		return false;
+	}
+
+private:
+	z_stream m_stream;
+};
+
+class BZip2Decoder : public Decoder
+{
+public:
+	BZip2Decoder()
+	{
+		std::memset(&m_stream, 0, sizeof(m_stream));
+		if (BZ2_bzDecompressInit(&m_stream, 0, 0) != BZ_OK) {
+			throw ArchiveException("Unable to initialize bzip2");
+		}
+	}
+	~BZip2Decoder() override
+	{
+		BZ2_bzDecompressEnd(&m_stream);
+	}
+
+	bool decode(const char *&in, const char *inEnd, char *&out, char *outEnd) override
+	{
+		m_stream.next_in = const_cast<char *>(in);
+		m_stream.avail_in = clampedSize<unsigned int>(in, inEnd);
+		m_stream.next_out = out;
+		m_stream.avail_out = clampedSize<unsigned int>(out, outEnd);
+		const int ret = BZ2_bzDecompress(&m_stream);
+		in = m_stream.next_in;
+		out = m_stream.next_out;
+		if (ret == BZ_STREAM_END) {
+			return true;
+		} else if (ret != BZ_OK) {
+			throw ArchiveException(QString("Corrupt compressed data: bzip2 error %1") % ret);
+		}
+		return false;
+	}
+
+private:
+	bz_stream m_stream;
+};
+
+class XzDecoder : public Decoder
+{
+public:
+	XzDecoder()
+	{
+		if (lzma_stream_decoder(&m_stream, std::numeric_limits<uint64_t>::max(), 0) != LZMA_OK) {
+			throw ArchiveException("Unable to initialize xz");
+		}
+	}
+	~XzDecoder() override
+	{
+		lzma_end(&m_stream);
+	}
+
+	bool decode(const char *&in, const char *inEnd, char *&out, char *outEnd) override
+	{
+		m_stream.next_in = reinterpret_cast<const uint8_t *>(in);
+		m_stream.avail_in = std::size_t(inEnd - in);
+		m_stream.next_out = reinterpret_cast<uint8_t *>(out);
+		m_stream.avail_out = std::size_t(outEnd - out);
+		const lzma_ret ret = lzma_code(&m_stream, LZMA_RUN);
+		in = reinterpret_cast<const char *>(m_stream.next_in);
+		out = reinterpret_cast<char *>(m_stream.next_out);
+		if (ret == LZMA_STREAM_END) {
+			return true;
+		} else if (ret != LZMA_OK && ret != LZMA_BUF_ERROR) {
+			throw ArchiveException(QString("Corrupt compressed data: xz error %1") % int(ret));
+		}
+		return false;
+	}
+
+private:
+	lzma_stream m_stream = LZMA_STREAM_INIT;
+};
+
+class ZstdDecoder : public Decoder
+{
+public:
+	ZstdDecoder()
+		: m_stream(ZSTD_createDStream())
+	{
+		if (!m_stream || ZSTD_isError(ZSTD_initDStream(m_stream))) {
+			ZSTD_freeDStream(m_stream);
+			throw ArchiveException("Unable to initialize zstd");
+		}
+	}
+	~ZstdDecoder() override
+	{
+		ZSTD_freeDStream(m_stream);
+	}
+
+	bool decode(const char *&in, const char *inEnd, char *&out, char *outEnd) override
+	{
+		ZSTD_inBuffer input{in, std::size_t(inEnd - in), 0};
+		ZSTD_outBuffer output{out, std::size_t(outEnd - out), 0};
+		const std::size_t ret = ZSTD_decompressStream(m_stream, &output, &input);
+		in += input.pos;
+		out += output.pos;
+		if (ZSTD_isError(ret)) {
+			throw ArchiveException("Corrupt compressed data: %1" % QString::fromLatin1(ZSTD_getErrorName(ret)));
+		}
+		// 0 means that the frame is complete and everything has been flushed
+		return ret == 0;
+	}
+
+private:
+	ZSTD_DStream *m_stream;
+};
+}
+
+std::unique_ptr<Decoder> Decoder::create(const Compression compression)
+{
+	switch (compression) {
+	case Compression::None: return std::make_unique<PassthroughDecoder>();
+	case Compression::GZip: return std::make_unique<ZlibDecoder>(MAX_WBITS + 16);
+	case Compression::Deflate: return std::make_unique<ZlibDecoder>(-MAX_WBITS);
+	case Compression::BZip2: return std::make_unique<BZip2Decoder>();
+	case Compression::Xz: return std::make_unique<XzDecoder>();
+	case Compression::Zstd: return std::make_unique<ZstdDecoder>();
+	}
+	return nullptr;
+}
+
+DecompressingDevice::DecompressingDevice(QIODevice *source)
+	: m_reader(source)
+{
+	open(QIODevice::ReadOnly);
+}
+DecompressingDevice::DecompressingDevice(ByteReader &&source)
+	: m_reader(std::move(source))
+{
+	open(QIODevice::ReadOnly);
+}
+DecompressingDevice::~DecompressingDevice() {}
+
+qint64 DecompressingDevice::readData(char *data, qint64 maxSize)
+{
+	try {
+		if (!m_decoder) {
+			m_reader.fill(6);
+			m_compression = detectCompression(QByteArray::fromRawData(m_reader.data(), int(m_reader.available())));
+			m_decoder = Decoder::create(m_compression);
+		}
+
+		char *out = data;
+		while (out == data && maxSize > 0 && !m_finished) {
+			if (m_reader.available() == 0 && !m_reader.fill(1)) {
+				if (m_compression != Compression::None) {
+					throw ArchiveException(m_reader.errorString().isEmpty() ? QStringLiteral("Unexpected end of compressed data") : m_reader.errorString());
+				}
+				m_finished = true;
+				break;
+			}
+			const char *in = m_reader.data();
+			const bool end = m_decoder->decode(in, in + m_reader.available(), out, data + maxSize);
+			m_reader.consume(in - m_reader.data());
+			if (end) {
+				// concatenated streams (cat, pzstd) continue with a fresh decoder, anything else is trailing padding
+				if (m_reader.fill(6) && detectCompression(QByteArray::fromRawData(m_reader.data(), 6)) == m_compression) {
+					m_decoder = Decoder::create(m_compression);
+				} else {
+					m_finished = true;
+				}
+			}
+		}
+		return out - data;
+	} catch (const ArchiveException &e) {
+		setErrorString(e.cause());
+		return -1;
+	}
+}
+
+qint64 DecompressingDevice::writeData(const char *data, qint64 maxSize)
+{
+	Q_UNUSED(data)
+	Q_UNUSED(maxSize)
+	return -1;
+}
+
+}
+}
+}
@@ -0,0 +1,115 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <memory>
+
+namespace Ralph {
+namespace ClientLib {
+namespace Archive {
+
+enum class Compression
+{
+	None,
+	GZip,
+	BZip2,
+	Xz,
+	Zstd,
+	Deflate // raw, as used inside of zip archives
+};
+
+/// Looks at the magic bytes at the start of a file, 6 bytes are enough to tell all formats apart
+Compression detectCompression(const QByteArray &magic);
+
+/** Buffered, strictly sequential reading from a device
+ *
+ * Unlike QIODevice::peek this works the same on all devices, and it gives the parsers direct
+ * access to the buffer so that nothing is copied more often than necessary.
+ */
+class ByteReader
+{
+public:
+	explicit ByteReader(QIODevice *device, const int capacity = 256 * 1024);
+
+	const char *data() const { return m_buffer.constData() + m_begin; }
+	qint64 available() const { return m_end - m_begin; }
+	/// Reads until at least size bytes are available. @returns false if the device ended before that
+	bool fill(const qint64 size);
+	void consume(const qint64 size) { m_begin += size; }
+	/// Throws if the device ends before size bytes could be read
+	QByteArray read(const qint64 size);
+	void skip(qint64 size);
+	/// Only for random access devices, positions that are still buffered don't cause a real seek
+	void seek(const qint64 position);
+
+	QIODevice *device() const { return m_device; }
+	/// Why the last fill() came up short, empty if the device simply ended
+	QString errorString() const { return m_error; }
+
+private:
+	QIODevice *m_device;
+	QByteArray m_buffer;
+	qint64 m_begin = 0;
+	qint64 m_end = 0;
+	bool m_atEnd = false;
+	QString m_error;
+};
+
+class Decoder
+{
+public:
+	virtual ~Decoder();
+
+	/// Decompresses from [in, inEnd) into [out, outEnd), advancing both. @returns true at the end of the compressed stream
+	virtual bool decode(const char *&in, const char *inEnd, char *&out, char *outEnd) = 0;
+
+	static std::unique_ptr<Decoder> create(const Compression compression);
+};
+
+/** Read-only, sequential device that decompresses the data of another device while it is read
+ *
+ * The compression is detected from the first bytes of the source, unknown data is passed through
+ * as is. Memory use does not depend on the size of the data. Errors are reported as a failed read
+ * with the reason in errorString().
+ */
+class DecompressingDevice : public QIODevice
+{
+public:
+	explicit DecompressingDevice(QIODevice *source);
+	/// Continues where source left off, for when the start of the data had to be looked at first
+	explicit DecompressingDevice(ByteReader &&source);
+	~DecompressingDevice() override;
+
+	bool isSequential() const override { return true; }
+	Compression compression() const { return m_compression; }
+
+protected:
+	qint64 readData(char *data, qint64 maxSize) override;
+	qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+	ByteReader m_reader;
+	Compression m_compression = Compression::None;
+	std::unique_ptr<Decoder> m_decoder;
+	bool m_finished = false;
+};
+
+}
+}
+}
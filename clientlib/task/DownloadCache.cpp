@@ -0,0 +1,200 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DownloadCache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <utime.h>
+#endif
+
+#include "Json.h"
+#include "FileSystem.h"
+
+namespace Ralph {
+namespace ClientLib {
+namespace Network {
+
+static const QFile::Permissions objectPermissions = QFile::ReadOwner | QFile::ReadGroup | QFile::ReadOther;
+
+// the least recently used object is the one with the oldest modification time
+static void markUsed(const QString &filename)
+{
+#ifdef Q_OS_UNIX
+	::utime(QFile::encodeName(filename).constData(), nullptr);
+#else
+	Q_UNUSED(filename)
+#endif
+}
+
+DownloadCache::DownloadCache(const QDir &dir, const qint64 maxSize)
+	: m_dir(dir), m_maxSize(maxSize) {}
+
+qint64 DownloadCache::maxSize() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_maxSize;
+}
+void DownloadCache::setMaxSize(const qint64 maxSize)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_maxSize = maxSize;
+}
+
+QString DownloadCache::objectPath(const QByteArray &sha256) const
+{
+	return m_dir.absoluteFilePath("objects/%1/%2" % QString::fromLatin1(sha256.left(2)) % QString::fromLatin1(sha256));
+}
+QString DownloadCache::entryPath(const QUrl &url) const
+{
+	const QString key = QCryptographicHash::hash(url.toString(QUrl::FullyEncoded).toUtf8(), QCryptographicHash::Sha1).toHex();
+	return m_dir.absoluteFilePath("urls/" + key + ".json");
+}
+
+bool DownloadCache::contains(const QByteArray &sha256) const
+{
+	return !sha256.isEmpty() && QFile::exists(objectPath(sha256));
+}
+
+DownloadCache::Entry DownloadCache::entry(const QUrl &url) const
+{
+	const QString filename = entryPath(url);
+	if (!QFile::exists(filename)) {
+		return Entry();
+	}
+	try {
+		const QJsonObject obj = Json::ensureObject(Json::ensureDocument(filename));
+		Entry entry;
+		entry.sha256 = Json::ensureString(obj, "sha256").toLatin1();
+		entry.etag = Json::ensureString(obj, "etag", QString()).toLatin1();
+		entry.lastModified = Json::ensureString(obj, "lastModified", QString()).toLatin1();
+		return contains(entry.sha256) ? entry : Entry();
+	} catch (Exception &) {
+		return Entry();
+	}
+}
+
+bool DownloadCache::retrieve(const QByteArray &sha256, const QString &destination)
+{
+	if (!contains(sha256)) {
+		return false;
+	}
+	const QString object = objectPath(sha256);
+	if (!QDir().mkpath(QFileInfo(destination).absolutePath())) {
+		return false;
+	}
+	QFile::remove(destination);
+	// a copy (or reflink) of its own, so that neither side can change the other
+	try {
+		FS::copy(object, destination);
+	} catch (FS::FileSystemException &) {
+		// eviction from another process might have removed the object in the meantime
+		return false;
+	}
+	QFile::setPermissions(destination, QFile::permissions(destination) | QFile::WriteOwner);
+	markUsed(object);
+	return true;
+}
+
+void DownloadCache::insert(const QUrl &url, const QString &filename, const Entry &entry)
+{
+	const QString object = objectPath(entry.sha256);
+	FS::ensureExists(QFileInfo(object).dir());
+	if (QFile::exists(object)) {
+		markUsed(object);
+	} else {
+		// a copy (or reflink) of its own, the file at filename stays as it is
+		const QString temporary = object + ".part";
+		QFile::remove(temporary);
+		FS::copy(filename, temporary);
+		QFile::setPermissions(temporary, objectPermissions);
+		const qint64 size = QFileInfo(temporary).size();
+		if (!QFile::rename(temporary, object)) {
+			// somebody else was faster
+			QFile::remove(temporary);
+		} else {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_size >= 0) {
+				m_size += size;
+			}
+		}
+	}
+
+	if (!url.isEmpty()) {
+		Json::write(QJsonObject({
+									qMakePair(QStringLiteral("url"), Json::toJson(url)),
+									qMakePair(QStringLiteral("sha256"), QJsonValue(QString::fromLatin1(entry.sha256))),
+									qMakePair(QStringLiteral("etag"), QJsonValue(QString::fromLatin1(entry.etag))),
+									qMakePair(QStringLiteral("lastModified"), QJsonValue(QString::fromLatin1(entry.lastModified)))
+								}), entryPath(url));
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_size < 0 || m_size > m_maxSize) {
+		evictLocked();
+	}
+}
+
+void DownloadCache::evict()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	evictLocked();
+}
+
+void DownloadCache::evictLocked()
+{
+	struct Object
+	{
+		QString filename;
+		QDateTime lastUsed;
+		qint64 size;
+	};
+	QVector<Object> objects;
+	qint64 total = 0;
+	QDirIterator it(m_dir.absoluteFilePath("objects"), QDir::Files, QDirIterator::Subdirectories);
+	while (it.hasNext()) {
+		it.next();
+		const QFileInfo info = it.fileInfo();
+		if (info.suffix() == "part") {
+			continue;
+		}
+		objects.append(Object{info.absoluteFilePath(), info.lastModified(), info.size()});
+		total += info.size();
+	}
+
+	if (total > m_maxSize) {
+		std::sort(objects.begin(), objects.end(), [](const Object &a, const Object &b) { return a.lastUsed < b.lastUsed; });
+		for (const Object &object : objects) {
+			if (total <= m_maxSize) {
+				break;
+			}
+			// entries in urls/ pointing to a removed object are treated as missing
+			if (QFile::remove(object.filename)) {
+				total -= object.size;
+			}
+		}
+	}
+	m_size = total;
+}
+
+}
+}
+}
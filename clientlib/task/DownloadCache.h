@@ -0,0 +1,82 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <QDir>
+#include <QUrl>
+#include <mutex>
+
+namespace Ralph {
+namespace ClientLib {
+namespace Network {
+
+/** Content-addressed store for downloaded files, shared by all databases and groups of a user
+ *
+ * Files are stored by their SHA-256 (as lower case hex) below objects/. For every URL the hash
+ * of the last response and its validators (ETag and Last-Modified) are remembered below urls/,
+ * so that a stale entry can be revalidated with a conditional request.
+ *
+ * Objects are read-only and are copied in and out, as reflinks where the filesystem supports them.
+ * Once the cache grows beyond maxSize() the least recently used objects are removed. Several
+ * processes may use the same directory, files only ever appear through an atomic rename.
+ */
+class DownloadCache
+{
+public:
+	static constexpr qint64 defaultMaxSize = qint64(2) * 1024 * 1024 * 1024;
+
+	explicit DownloadCache(const QDir &dir, const qint64 maxSize = defaultMaxSize);
+
+	struct Entry
+	{
+		QByteArray sha256;
+		QByteArray etag;
+		QByteArray lastModified;
+
+		bool isValid() const { return !sha256.isEmpty(); }
+	};
+
+	QDir dir() const { return m_dir; }
+	qint64 maxSize() const;
+	void setMaxSize(const qint64 maxSize);
+
+	bool contains(const QByteArray &sha256) const;
+	/// Where the object is stored if it is contained. Don't modify it, use retrieve() for a copy you can modify
+	QString path(const QByteArray &sha256) const { return objectPath(sha256); }
+	/// @returns the entry of the last download of url, or an invalid entry if its object is gone
+	Entry entry(const QUrl &url) const;
+
+	/// Places the object at destination and marks it as recently used. @returns false if the object is not available
+	bool retrieve(const QByteArray &sha256, const QString &destination);
+	/// Adds filename (which stays where it is) as the content of url
+	void insert(const QUrl &url, const QString &filename, const Entry &entry);
+
+	void evict();
+
+private:
+	const QDir m_dir;
+	mutable std::mutex m_mutex;
+	qint64 m_maxSize;
+	qint64 m_size = -1; // -1 until the objects have been counted once
+
+	QString objectPath(const QByteArray &sha256) const;
+	QString entryPath(const QUrl &url) const;
+	void evictLocked();
+};
+
+}
+}
+}
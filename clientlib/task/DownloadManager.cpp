@@ -0,0 +1,803 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DownloadManager.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <atomic>
+
+#include <curl/curl.h>
+
+#include "Network.h"
+#include "RingBuffer.h"
+
+namespace Ralph {
+namespace ClientLib {
+namespace Network {
+
+QT_WARNING_PUSH
+QT_WARNING_DISABLE_GCC("-Wdisabled-macro-expansion")
+
+struct DownloadManager::Transfer
+{
+	explicit Transfer(const QUrl &url, const Private::BasePromise &promise)
+		: url(url), promise(promise), notifier(promise) {}
+
+	enum Kind
+	{
+		Whole, // possibly resuming from the part file of an earlier attempt
+		Probe, // HEAD request to find out if the file can be fetched in segments
+		Segment // a byte range of parent
+	} kind = Whole;
+
+	QUrl url;
+	QString destination; // empty if the data is kept in memory or streamed
+	std::unique_ptr<QIODevice> device;
+	std::shared_ptr<RingBuffer> sink;
+	bool paused = false;
+	std::atomic<bool> unpause{false};
+	QByteArray expectedSha256;
+	std::shared_ptr<DownloadCache> cache;
+	DownloadCache::Entry cached; // valid if the request is conditional
+	std::unique_ptr<QCryptographicHash> hash;
+	QByteArray etag;
+	QByteArray lastModified;
+	Private::BasePromise promise;
+	Notifier notifier;
+	std::function<void()> reportResult;
+
+	int attempts = 0;
+	bool probed = false;
+	bool acceptsRanges = false;
+	bool rangeIgnored = false;
+	qint64 size = -1; // from the Content-Length of the probe
+	qint64 offset = 0; // first byte requested
+	qint64 streamed = 0; // bytes pushed into the sink
+	qint64 end = -1; // last byte requested by a segment
+	qint64 received = 0; // by a segment, or by all segments of a parent
+	std::shared_ptr<Transfer> parent;
+	int pendingSegments = 0;
+	std::exception_ptr segmentError;
+
+	CURL *handle = nullptr;
+	curl_slist *headers = nullptr;
+	char error[CURL_ERROR_SIZE] = {};
+
+	QString partFile() const { return destination + ".part"; }
+	// the ETag or Last-Modified of the response the part file belongs to
+	QString validatorFile() const { return destination + ".part.validator"; }
+	QByteArray validator() const { return etag.isEmpty() || etag.startsWith("W/") ? lastModified : etag; }
+};
+
+static int progressCallback(void *data, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+{
+	DownloadManager::Transfer *transfer = static_cast<DownloadManager::Transfer *>(data);
+	if (transfer->parent) {
+		const DownloadManager::Transfer *parent = transfer->parent.get();
+		transfer->notifier.progress(std::size_t(parent->received), std::size_t(parent->size));
+		// one failed segment is enough to fail the whole file
+		return transfer->notifier.isCanceled() || parent->segmentError ? 1 : 0;
+	}
+	const curl_off_t total = dltotal + ultotal;
+	transfer->notifier.progress(std::size_t(transfer->offset + dlnow + ulnow), std::size_t(total ? transfer->offset + total : 0));
+	// anything non-zero aborts the transfer
+	return transfer->notifier.isCanceled() ? 1 : 0;
+}
+static size_t writeCallback(void *contents, size_t size, size_t nmemb, void *data)
+{
+	DownloadManager::Transfer *transfer = static_cast<DownloadManager::Transfer *>(data);
+
+	const size_t realsize = size * nmemb;
+	if (transfer->sink) {
+		// curl hands us the same data again once the transfer is unpaused
+		if (!transfer->sink->push(static_cast<const char *>(contents), realsize)) {
+			if (transfer->sink->isAborted()) {
+				return 0;
+			}
+			transfer->paused = true;
+			return CURL_WRITEFUNC_PAUSE;
+		}
+		transfer->streamed += qint64(realsize);
+	}
+	if (transfer->hash) {
+		transfer->hash->addData(static_cast<const char *>(contents), int(realsize));
+	}
+	if (!transfer->device) {
+		return realsize;
+	}
+	if (transfer->parent) {
+		transfer->received += qint64(realsize);
+		transfer->parent->received += qint64(realsize);
+	}
+	// returning less than we got aborts the transfer
+	return transfer->device->write(static_cast<const char *>(contents), static_cast<qint64>(realsize)) == qint64(realsize) ? realsize : 0;
+}
+static size_t headerCallback(char *buffer, size_t size, size_t nitems, void *data)
+{
+	DownloadManager::Transfer *transfer = static_cast<DownloadManager::Transfer *>(data);
+
+	const size_t realsize = size * nitems;
+	const QByteArray line = QByteArray::fromRawData(buffer, int(realsize));
+	const int colon = line.indexOf(':');
+	if (line.startsWith("HTTP/")) {
+		// each redirect starts a new set of headers
+		transfer->etag.clear();
+		transfer->lastModified.clear();
+		transfer->acceptsRanges = false;
+		if (transfer->kind == DownloadManager::Transfer::Probe) {
+			transfer->size = -1;
+		}
+
+		const int status = line.split(' ').value(1).toInt();
+		if (status == 200 && (transfer->kind == DownloadManager::Transfer::Segment || (transfer->sink && transfer->offset > 0))) {
+			// the file changed since the probe or the first attempt, or ranges are not supported after all
+			transfer->rangeIgnored = true;
+			return 0;
+		} else if (status == 200 && transfer->offset > 0) {
+			// the part file is stale (If-Range didn't match) or the server ignores ranges, start over
+			static_cast<QFile *>(transfer->device.get())->resize(0);
+			transfer->offset = 0;
+			if (transfer->hash) {
+				transfer->hash->reset();
+			}
+		}
+	} else if (colon > 0) {
+		const QByteArray name = line.left(colon).trimmed().toLower();
+		const QByteArray value = line.mid(colon + 1).trimmed();
+		if (name == "etag") {
+			transfer->etag = value;
+		} else if (name == "last-modified") {
+			transfer->lastModified = value;
+		} else if (name == "accept-ranges") {
+			transfer->acceptsRanges = value.toLower() == "bytes";
+		} else if (name == "content-length" && transfer->kind == DownloadManager::Transfer::Probe) {
+			transfer->size = value.toLongLong();
+		}
+	}
+	return realsize;
+}
+
+static QByteArray readValidator(const QString &filename)
+{
+	QFile file(filename);
+	return file.open(QFile::ReadOnly) ? file.readAll().trimmed() : QByteArray();
+}
+static void writeValidator(const QString &filename, const QByteArray &validator)
+{
+	QFile file(filename);
+	if (file.open(QFile::WriteOnly | QFile::Truncate)) {
+		file.write(validator);
+	}
+}
+
+static bool isTransient(const int code)
+{
+	switch (code) {
+	case CURLE_COULDNT_CONNECT:
+	case CURLE_PARTIAL_FILE:
+	case CURLE_OPERATION_TIMEDOUT:
+	case CURLE_GOT_NOTHING:
+	case CURLE_SEND_ERROR:
+	case CURLE_RECV_ERROR:
+	case CURLE_HTTP2:
+#if LIBCURL_VERSION_NUM >= 0x073100
+	case CURLE_HTTP2_STREAM:
+#endif
+		return true;
+	default:
+		return false;
+	}
+}
+
+DownloadManager::DownloadManager(const int maxConcurrent)
+	: m_maxConcurrent(maxConcurrent) {}
+DownloadManager::~DownloadManager()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	if (m_thread.joinable()) {
+		wakeup();
+		m_thread.join();
+	}
+}
+
+DownloadManager *DownloadManager::instance()
+{
+	static DownloadManager manager;
+	return &manager;
+}
+
+int DownloadManager::segments() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_segments;
+}
+void DownloadManager::setSegments(const int segments, const qint64 minimumSize)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_segments = std::max(1, segments);
+	m_segmentMinimumSize = minimumSize;
+}
+
+std::shared_ptr<DownloadCache> DownloadManager::cache() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_cache;
+}
+void DownloadManager::setCache(const std::shared_ptr<DownloadCache> &cache)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_cache = cache;
+}
+
+void DownloadManager::setMaxConcurrent(const int maxConcurrent)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_maxConcurrent = std::max(1, maxConcurrent);
+	}
+	wakeup();
+}
+
+Future<void> DownloadManager::download(const QUrl &url, const QString &destination, const QByteArray &sha256)
+{
+	const QFileInfo info(destination);
+	const QString dest = info.exists() && info.isDir() ?
+				QDir(destination).absoluteFilePath(QFileInfo(url.path()).fileName())
+			  : destination;
+
+	Promise<void> promise;
+	const std::shared_ptr<Transfer> transfer = std::make_shared<Transfer>(url, promise);
+	transfer->destination = dest;
+	transfer->expectedSha256 = sha256.toLower();
+	transfer->cache = cache();
+	transfer->reportResult = []() {};
+	promise.schedule(Executor::instance(), [this, transfer]()
+	{
+		transfer->promise.reportStarted();
+		if (transfer->cache) {
+			if (transfer->cache->retrieve(transfer->expectedSha256, transfer->destination)) {
+				transfer->notifier.status("Using cached %1" % transfer->url.toString());
+				transfer->reportResult = nullptr;
+				transfer->promise.reportFinished();
+				transfer->promise.complete();
+				return;
+			}
+			const DownloadCache::Entry cached = transfer->cache->entry(transfer->url);
+			if (transfer->expectedSha256.isEmpty() || cached.sha256 == transfer->expectedSha256) {
+				transfer->cached = cached;
+			}
+		}
+		enqueue(transfer);
+	});
+	return promise.future();
+}
+Future<QByteArray> DownloadManager::get(const QUrl &url)
+{
+	Promise<QByteArray> promise;
+	const std::shared_ptr<Transfer> transfer = std::make_shared<Transfer>(url, promise);
+	transfer->reportResult = [promise, transfer]() mutable
+	{
+		promise.reportResult(QByteArray(static_cast<QBuffer *>(transfer->device.get())->data()));
+	};
+	promise.schedule(Executor::instance(), [this, transfer]()
+	{
+		transfer->promise.reportStarted();
+		enqueue(transfer);
+	});
+	return promise.future();
+}
+
+Future<void> DownloadManager::stream(const QUrl &url, const std::shared_ptr<RingBuffer> &sink, const QByteArray &sha256)
+{
+	Promise<void> promise;
+	const std::shared_ptr<Transfer> transfer = std::make_shared<Transfer>(url, promise);
+	transfer->sink = sink;
+	transfer->expectedSha256 = sha256.toLower();
+	if (!sha256.isEmpty()) {
+		transfer->hash = std::make_unique<QCryptographicHash>(QCryptographicHash::Sha256);
+	}
+	transfer->reportResult = []() {};
+	const std::weak_ptr<Transfer> weakTransfer = transfer;
+	sink->setSpaceCallback([this, weakTransfer]()
+	{
+		if (const std::shared_ptr<Transfer> transfer = weakTransfer.lock()) {
+			transfer->unpause = true;
+			wakeup();
+		}
+	});
+	promise.schedule(Executor::instance(), [this, transfer]()
+	{
+		transfer->promise.reportStarted();
+		enqueue(transfer);
+	});
+	return promise.future();
+}
+
+QVector<Future<void>> DownloadManager::download(const QVector<QPair<QUrl, QString>> &downloads)
+{
+	QVector<Future<void>> out;
+	for (const auto &pair : downloads) {
+		Future<void> future = download(pair.first, pair.second);
+		future.start();
+		out.append(future);
+	}
+	return out;
+}
+QVector<Future<QByteArray>> DownloadManager::get(const QVector<QUrl> &urls)
+{
+	QVector<Future<QByteArray>> out;
+	for (const QUrl &url : urls) {
+		Future<QByteArray> future = get(url);
+		future.start();
+		out.append(future);
+	}
+	return out;
+}
+
+void DownloadManager::enqueue(const std::shared_ptr<Transfer> &transfer)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(transfer);
+		if (!m_thread.joinable()) {
+			m_thread = std::thread([this]() { run(); });
+			return;
+		}
+	}
+	wakeup();
+}
+
+void DownloadManager::wakeup()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_multi) {
+#if LIBCURL_VERSION_NUM >= 0x074400
+		curl_multi_wakeup(static_cast<CURLM *>(m_multi));
+#endif
+	}
+}
+
+void DownloadManager::run()
+{
+	CURLSH *share = curl_share_init();
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+
+	CURLM *multi = curl_multi_init();
+	curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_multi = multi;
+		m_share = share;
+	}
+
+	while (true) {
+		addTransfers();
+		for (const std::shared_ptr<Transfer> &transfer : m_active) {
+			if (transfer->paused && transfer->unpause.exchange(false)) {
+				transfer->paused = false;
+				curl_easy_pause(transfer->handle, CURLPAUSE_CONT);
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_stopping) {
+				break;
+			}
+		}
+
+		int running = 0;
+		curl_multi_perform(multi, &running);
+
+		int remaining = 0;
+		while (CURLMsg *msg = curl_multi_info_read(multi, &remaining)) {
+			if (msg->msg != CURLMSG_DONE) {
+				continue;
+			}
+			const auto it = std::find_if(m_active.begin(), m_active.end(), [msg](const std::shared_ptr<Transfer> &transfer) { return transfer->handle == msg->easy_handle; });
+			if (it != m_active.end()) {
+				const std::shared_ptr<Transfer> transfer = *it;
+				m_active.erase(it);
+				finish(transfer, msg->data.result);
+			}
+		}
+
+		// without curl_multi_wakeup new transfers are only picked up after the timeout
+#if LIBCURL_VERSION_NUM >= 0x074400
+		curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+#else
+		curl_multi_wait(multi, nullptr, 0, 100, nullptr);
+#endif
+	}
+
+	// abandon whatever is left
+	for (const std::shared_ptr<Transfer> &transfer : m_active) {
+		finish(transfer, CURLE_ABORTED_BY_CALLBACK);
+	}
+	m_active.clear();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_multi = nullptr;
+		m_share = nullptr;
+	}
+	curl_multi_cleanup(multi);
+	curl_share_cleanup(share);
+}
+
+void DownloadManager::addTransfers()
+{
+	while (true) {
+		std::shared_ptr<Transfer> transfer;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_queue.empty() || m_active.size() >= m_maxConcurrent) {
+				return;
+			}
+			transfer = m_queue.front();
+			m_queue.pop_front();
+
+			// segments only pay off for large files, and a resume or a revalidation is cheaper anyway
+			if (transfer->kind == Transfer::Whole && !transfer->probed && m_segments > 1 && !transfer->destination.isEmpty()
+					&& !transfer->cached.isValid() && !QFile::exists(transfer->partFile())) {
+				transfer->kind = Transfer::Probe;
+			}
+		}
+
+		if (startTransfer(transfer)) {
+			m_active.append(transfer);
+			curl_multi_add_handle(static_cast<CURLM *>(m_multi), transfer->handle);
+		}
+	}
+}
+
+bool DownloadManager::startTransfer(const std::shared_ptr<Transfer> &transfer)
+{
+	QByteArray ifRange;
+	if (transfer->kind == Transfer::Probe) {
+		transfer->device.reset();
+	} else if (transfer->sink) {
+		// whatever has been streamed has been consumed already, so a retry has to continue from there
+		transfer->offset = transfer->streamed;
+		ifRange = transfer->validator();
+	} else if (transfer->destination.isEmpty()) {
+		transfer->device = std::make_unique<QBuffer>();
+		transfer->device->open(QIODevice::WriteOnly);
+	} else if (transfer->kind == Transfer::Segment) {
+		transfer->offset += transfer->received;
+		transfer->received = 0;
+		ifRange = transfer->parent->validator();
+		transfer->device = std::make_unique<QFile>(transfer->partFile());
+		if (!transfer->device->open(QIODevice::ReadWrite) || !transfer->device->seek(transfer->offset)) {
+			transfer->parent->segmentError = std::make_exception_ptr(NetworkException("Unable to open download destination: " + transfer->device->errorString()));
+			finishSegment(transfer);
+			return false;
+		}
+	} else {
+		transfer->device = std::make_unique<QFile>(transfer->partFile());
+		if (!transfer->device->open(QIODevice::WriteOnly | QIODevice::Append)) {
+			transfer->promise.reportException(std::make_exception_ptr(NetworkException("Unable to open download destination: " + transfer->device->errorString())));
+			transfer->promise.complete();
+			return false;
+		}
+		transfer->offset = transfer->device->size();
+		if (transfer->offset > 0) {
+			ifRange = readValidator(transfer->validatorFile());
+			// without knowing which version of the file we have we can't safely resume
+			if (ifRange.isEmpty()) {
+				static_cast<QFile *>(transfer->device.get())->resize(0);
+				transfer->offset = 0;
+			}
+		}
+		if (transfer->cache || !transfer->expectedSha256.isEmpty()) {
+			transfer->hash = std::make_unique<QCryptographicHash>(QCryptographicHash::Sha256);
+			if (transfer->offset > 0) {
+				QFile part(transfer->partFile());
+				part.open(QFile::ReadOnly);
+				transfer->hash->addData(&part);
+			}
+		}
+	}
+
+	CURL *curl = curl_easy_init();
+	transfer->handle = curl;
+	curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, transfer->error);
+	curl_easy_setopt(curl, CURLOPT_USERAGENT, "ralph");
+	curl_easy_setopt(curl, CURLOPT_URL, transfer->url.toString(QUrl::FullyEncoded).toUtf8().constData());
+	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+	curl_easy_setopt(curl, CURLOPT_SHARE, static_cast<CURLSH *>(m_share));
+	curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, long(CURL_HTTP_VERSION_2TLS));
+	curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+	// a stalled connection is treated like a dropped one, so that it gets resumed
+	curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+	curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 60L);
+	curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+	curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, &progressCallback);
+	curl_easy_setopt(curl, CURLOPT_XFERINFODATA, transfer.get());
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &writeCallback);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, transfer.get());
+	curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, &headerCallback);
+	curl_easy_setopt(curl, CURLOPT_HEADERDATA, transfer.get());
+
+	if (transfer->kind == Transfer::Probe) {
+		curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+	} else if (transfer->kind == Transfer::Segment) {
+		curl_easy_setopt(curl, CURLOPT_RANGE, QByteArray::number(transfer->offset).append('-').append(QByteArray::number(transfer->end)).constData());
+	} else if (transfer->offset > 0) {
+		curl_easy_setopt(curl, CURLOPT_RANGE, QByteArray::number(transfer->offset).append('-').constData());
+	}
+	if (!ifRange.isEmpty() && transfer->kind != Transfer::Probe) {
+		transfer->headers = curl_slist_append(transfer->headers, ("If-Range: " + ifRange).constData());
+	}
+	if (transfer->cached.isValid() && transfer->kind == Transfer::Whole) {
+		if (!transfer->cached.etag.isEmpty()) {
+			transfer->headers = curl_slist_append(transfer->headers, ("If-None-Match: " + transfer->cached.etag).constData());
+		}
+		if (!transfer->cached.lastModified.isEmpty()) {
+			transfer->headers = curl_slist_append(transfer->headers, ("If-Modified-Since: " + transfer->cached.lastModified).constData());
+		}
+	}
+	if (transfer->headers) {
+		curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer->headers);
+	}
+
+	if (transfer->kind == Transfer::Whole) {
+		transfer->notifier.status((transfer->offset > 0 ? "Resuming %1..." : "Downloading %1...") % transfer->url.toString());
+	}
+	return true;
+}
+
+bool DownloadManager::retry(const std::shared_ptr<Transfer> &transfer, const int code)
+{
+	static constexpr int maxAttempts = 5;
+	if (!isTransient(code) || transfer->promise.isCanceled() || ++transfer->attempts >= maxAttempts) {
+		return false;
+	}
+	transfer->notifier.status("Connection to %1 lost, retrying..." % transfer->url.host());
+	if (transfer->sink && transfer->streamed > 0 && transfer->validator().isEmpty()) {
+		return false;
+	}
+	transfer->error[0] = '\0';
+	if (!transfer->sink) {
+		transfer->hash.reset();
+	}
+	if (transfer->kind == Transfer::Whole && !transfer->destination.isEmpty()) {
+		writeValidator(transfer->validatorFile(), transfer->validator());
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_queue.push_front(transfer);
+	return true;
+}
+
+// @returns the hash of the content, if it was computed
+static QByteArray verifyDownload(DownloadManager::Transfer *transfer)
+{
+	if (!transfer->hash) {
+		return QByteArray();
+	}
+	const QByteArray sha256 = transfer->hash->result().toHex();
+	if (!transfer->expectedSha256.isEmpty() && sha256 != transfer->expectedSha256) {
+		throw NetworkException("Checksum mismatch for %1: expected %2, got %3"
+							   % transfer->url.toString() % QString::fromLatin1(transfer->expectedSha256) % QString::fromLatin1(sha256));
+	}
+	return sha256;
+}
+
+// verifies the content and moves it into place and into the cache, or out of the cache
+static void storeDownload(DownloadManager::Transfer *transfer, const long responseCode)
+{
+	if (responseCode == 304 && transfer->cached.isValid()) {
+		QFile::remove(transfer->partFile());
+		if (!transfer->cache->retrieve(transfer->cached.sha256, transfer->destination)) {
+			throw NetworkException("The cached copy of %1 is no longer available" % transfer->url.toString());
+		}
+		return;
+	}
+
+	const QByteArray sha256 = verifyDownload(transfer);
+	QFile::remove(transfer->destination);
+	if (!QFile::rename(transfer->partFile(), transfer->destination)) {
+		throw NetworkException("Unable to move the download to %1" % transfer->destination);
+	}
+	QFile::remove(transfer->validatorFile());
+	if (transfer->cache && !sha256.isEmpty()) {
+		transfer->cache->insert(transfer->url, transfer->destination, DownloadCache::Entry{sha256, transfer->etag, transfer->lastModified});
+	}
+}
+
+void DownloadManager::finish(const std::shared_ptr<Transfer> &transfer, const int code)
+{
+	long responseCode = 0;
+	curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &responseCode);
+	curl_multi_remove_handle(static_cast<CURLM *>(m_multi), transfer->handle);
+	curl_easy_cleanup(transfer->handle);
+	curl_slist_free_all(transfer->headers);
+	transfer->handle = nullptr;
+	transfer->headers = nullptr;
+	if (transfer->device) {
+		transfer->device->close();
+	}
+
+	if (transfer->kind == Transfer::Probe) {
+		finishProbe(transfer, code);
+		return;
+	} else if (transfer->kind == Transfer::Segment) {
+		if (code != CURLE_OK && (transfer->rangeIgnored || transfer->parent->segmentError || !retry(transfer, code))) {
+			if (!transfer->parent->segmentError) {
+				try {
+					if (transfer->rangeIgnored) {
+						throw NetworkException("%1 changed during the download" % transfer->url.toString());
+					}
+					NetworkException::throwIfError(code, transfer->error[0] ? transfer->error : nullptr);
+				} catch (...) {
+					transfer->parent->segmentError = std::current_exception();
+				}
+			}
+			finishSegment(transfer);
+		} else if (code == CURLE_OK) {
+			finishSegment(transfer);
+		}
+		return;
+	}
+
+	std::exception_ptr error;
+	if (code == CURLE_OK) {
+		try {
+			if (!transfer->destination.isEmpty()) {
+				storeDownload(transfer.get(), responseCode);
+			} else {
+				verifyDownload(transfer.get());
+			}
+			transfer->reportResult();
+			transfer->promise.reportFinished();
+		} catch (...) {
+			QFile::remove(transfer->partFile());
+			QFile::remove(transfer->validatorFile());
+			error = std::current_exception();
+			transfer->promise.reportException(error);
+		}
+	} else if (responseCode == 416 && transfer->kind == Transfer::Whole && !transfer->sink && !transfer->destination.isEmpty()
+			   && transfer->offset > 0 && !transfer->promise.isCanceled()) {
+		// the part file doesn't fit what the server has (anymore), start over from the beginning right away
+		QFile::remove(transfer->partFile());
+		QFile::remove(transfer->validatorFile());
+		transfer->error[0] = '\0';
+		transfer->hash.reset();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_front(transfer);
+		return;
+	} else if (!transfer->rangeIgnored && retry(transfer, code)) {
+		return;
+	} else {
+		if (!transfer->destination.isEmpty()) {
+			// keep what we have for the next attempt, unless the server refuses to resume from there
+			if (responseCode == 416 || transfer->validator().isEmpty()) {
+				QFile::remove(transfer->partFile());
+				QFile::remove(transfer->validatorFile());
+			} else {
+				writeValidator(transfer->validatorFile(), transfer->validator());
+			}
+		}
+		try {
+			if (transfer->promise.isCanceled()) {
+				throw NetworkException("The download of %1 was canceled" % transfer->url.toString());
+			} else if (transfer->rangeIgnored) {
+				throw NetworkException("%1 changed during the download" % transfer->url.toString());
+			}
+			NetworkException::throwIfError(code, transfer->error[0] ? transfer->error : nullptr);
+		} catch (...) {
+			error = std::current_exception();
+		}
+		if (transfer->promise.isCanceled()) {
+			transfer->promise.reportCanceled();
+		} else {
+			transfer->promise.reportException(error);
+		}
+	}
+	if (transfer->sink) {
+		transfer->sink->finish(error);
+	}
+	transfer->reportResult = nullptr; // it holds on to the transfer
+	transfer->promise.complete();
+}
+
+void DownloadManager::finishProbe(const std::shared_ptr<Transfer> &transfer, const int code)
+{
+	transfer->kind = Transfer::Whole;
+	transfer->probed = true;
+
+	int segments;
+	qint64 minimumSize;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		segments = m_segments;
+		minimumSize = m_segmentMinimumSize;
+	}
+
+	QFile part(transfer->partFile());
+	if (code == CURLE_OK && transfer->acceptsRanges && !transfer->validator().isEmpty() && transfer->size >= std::max(minimumSize, qint64(segments))
+			&& part.open(QFile::WriteOnly | QFile::Truncate) && part.resize(transfer->size)) {
+		part.close();
+		transfer->notifier.status("Downloading %1 in %2 segments..." % transfer->url.toString() % segments);
+		transfer->pendingSegments = segments;
+		const qint64 segmentSize = transfer->size / segments;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (int i = segments - 1; i >= 0; --i) {
+			const std::shared_ptr<Transfer> segment = std::make_shared<Transfer>(transfer->url, transfer->promise);
+			segment->kind = Transfer::Segment;
+			segment->destination = transfer->destination;
+			segment->parent = transfer;
+			segment->offset = i * segmentSize;
+			segment->end = i == segments - 1 ? transfer->size - 1 : (i + 1) * segmentSize - 1;
+			m_queue.push_front(segment);
+		}
+	} else {
+		// no luck, so fetch it in one piece after all
+		part.remove();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_front(transfer);
+	}
+}
+
+void DownloadManager::finishSegment(const std::shared_ptr<Transfer> &segment)
+{
+	const std::shared_ptr<Transfer> transfer = segment->parent;
+	segment->parent.reset();
+	if (--transfer->pendingSegments > 0) {
+		return;
+	}
+
+	// the segments arrive out of order, so unlike in the other cases we need a second pass to hash the file
+	try {
+		if (transfer->promise.isCanceled()) {
+			transfer->promise.reportCanceled();
+		} else if (transfer->segmentError) {
+			std::rethrow_exception(transfer->segmentError);
+		} else {
+			if (transfer->cache || !transfer->expectedSha256.isEmpty()) {
+				transfer->hash = std::make_unique<QCryptographicHash>(QCryptographicHash::Sha256);
+				QFile part(transfer->partFile());
+				part.open(QFile::ReadOnly);
+				transfer->hash->addData(&part);
+			}
+			storeDownload(transfer.get(), 200);
+			transfer->reportResult();
+			transfer->promise.reportFinished();
+		}
+	} catch (...) {
+		transfer->promise.reportException(std::current_exception());
+	}
+	// the part file has holes, so it can't be resumed from
+	QFile::remove(transfer->partFile());
+	transfer->reportResult = nullptr;
+	transfer->promise.complete();
+}
+
+QT_WARNING_POP
+
+}
+}
+}
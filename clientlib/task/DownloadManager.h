@@ -0,0 +1,121 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <QUrl>
+#include <QPair>
+#include <QVector>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "Task.h"
+#include "DownloadCache.h"
+
+namespace Ralph {
+namespace ClientLib {
+class RingBuffer;
+
+namespace Network {
+
+/** Runs all transfers from a single thread through one curl multi handle
+ *
+ * Connections, DNS lookups and TLS sessions are shared between transfers, and HTTP/2 connections
+ * are multiplexed. At most maxConcurrent() transfers run at the same time, the rest are queued.
+ *
+ * Like tasks, transfers only get queued once their future is started. The batch functions start
+ * all futures right away, so that the transfers overlap.
+ *
+ * Downloads to files go to a .part file next to the destination first. Dropped or stalled
+ * connections are retried a few times, continuing with a Range request where the part file ends,
+ * and a part file left over by a failed download is resumed by the next download to the same
+ * destination. If-Range makes sure that only parts of the same version of the file get combined.
+ *
+ * With setSegments() large files are fetched as several byte ranges in parallel, for servers that
+ * support ranges. This needs a HEAD request upfront and an extra pass over the file for the hash.
+ *
+ * Downloads to files are hashed while they are written. With a cache set, a download whose
+ * expected hash is already in the cache never touches the network, and other cached downloads
+ * are revalidated using the ETag and Last-Modified headers of the previous response.
+ */
+class DownloadManager
+{
+public:
+	explicit DownloadManager(const int maxConcurrent = 8);
+	~DownloadManager();
+
+	static DownloadManager *instance();
+
+	int maxConcurrent() const { return m_maxConcurrent; }
+	void setMaxConcurrent(const int maxConcurrent);
+
+	int segments() const;
+	/// Files of at least minimumSize bytes are fetched in the given number of segments, 1 disables segmenting
+	void setSegments(const int segments, const qint64 minimumSize = 64 * 1024 * 1024);
+
+	std::shared_ptr<DownloadCache> cache() const;
+	void setCache(const std::shared_ptr<DownloadCache> &cache);
+
+	/** destination may also be a directory, in which case the file name is taken from the URL
+	 *
+	 * If sha256 (hex encoded) is given the download fails unless the content matches.
+	 */
+	Future<void> download(const QUrl &url, const QString &destination, const QByteArray &sha256 = QByteArray());
+	Future<QByteArray> get(const QUrl &url);
+	/** Pushes the content into sink as it arrives, and finishes the sink once done
+	 *
+	 * While the sink is full the transfer is paused, without holding up other transfers. Nothing is
+	 * written to disk, so streams neither use nor fill the cache.
+	 */
+	Future<void> stream(const QUrl &url, const std::shared_ptr<RingBuffer> &sink, const QByteArray &sha256 = QByteArray());
+
+	QVector<Future<void>> download(const QVector<QPair<QUrl, QString>> &downloads);
+	QVector<Future<QByteArray>> get(const QVector<QUrl> &urls);
+
+	struct Transfer;
+
+private:
+	int m_maxConcurrent;
+	int m_segments = 1;
+	qint64 m_segmentMinimumSize = 0;
+	std::shared_ptr<DownloadCache> m_cache;
+
+	mutable std::mutex m_mutex;
+	std::deque<std::shared_ptr<Transfer>> m_queue;
+	bool m_stopping = false;
+	std::thread m_thread;
+
+	// only used from m_thread
+	void *m_multi = nullptr;
+	void *m_share = nullptr;
+	QVector<std::shared_ptr<Transfer>> m_active;
+
+	void enqueue(const std::shared_ptr<Transfer> &transfer);
+	void wakeup();
+	void run();
+	void addTransfers();
+	bool startTransfer(const std::shared_ptr<Transfer> &transfer);
+	bool retry(const std::shared_ptr<Transfer> &transfer, const int code);
+	void finish(const std::shared_ptr<Transfer> &transfer, const int code);
+	void finishProbe(const std::shared_ptr<Transfer> &transfer, const int code);
+	void finishSegment(const std::shared_ptr<Transfer> &segment);
+};
+
+}
+}
+}
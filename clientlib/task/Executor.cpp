@@ -0,0 +1,234 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Executor.h"
+
+#include "Functional.h"
+
+namespace Ralph {
+namespace ClientLib {
+
+static thread_local const Executor *currentExecutor = nullptr;
+static thread_local int currentIndex = -1;
+
+Executor::Executor(const std::size_t threads)
+{
+	const std::size_t count = Common::Functional::parallelThreadCount(threads);
+	for (std::size_t i = 0; i < count; ++i) {
+		m_workers.push_back(std::make_unique<Worker>());
+	}
+	for (std::size_t i = 0; i < count; ++i) {
+		m_threads.emplace_back([this, i]()
+		{
+			currentExecutor = this;
+			currentIndex = int(i);
+			work();
+		});
+	}
+}
+Executor::~Executor()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+	for (std::thread &thread : m_threads) {
+		thread.join();
+	}
+	std::list<Spare> spares;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		spares.swap(m_spares);
+	}
+	for (Spare &spare : spares) {
+		spare.thread.join();
+	}
+}
+
+Executor *Executor::instance()
+{
+	static Executor executor;
+	return &executor;
+}
+
+int Executor::currentWorker() const
+{
+	return currentExecutor == this ? currentIndex : -1;
+}
+
+void Executor::post(std::function<void()> &&job)
+{
+	const int index = currentWorker();
+	if (index >= 0) {
+		Worker &worker = *m_workers.at(std::size_t(index));
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.jobs.push_back(std::move(job));
+		++m_pending;
+	} else {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(std::move(job));
+		++m_pending;
+	}
+	{
+		// taking the lock makes sure nobody is between checking for work and going to sleep
+		std::lock_guard<std::mutex> lock(m_mutex);
+		compensate();
+	}
+	m_condition.notify_one();
+}
+
+bool Executor::take(std::function<void()> &job, const bool steal)
+{
+	if (m_pending == 0) {
+		return false;
+	}
+
+	const int index = currentWorker();
+	if (index >= 0) {
+		Worker &worker = *m_workers.at(std::size_t(index));
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (!worker.jobs.empty()) {
+			job = std::move(worker.jobs.back());
+			worker.jobs.pop_back();
+			--m_pending;
+			return true;
+		}
+	}
+	if (!steal) {
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_queue.empty()) {
+			job = std::move(m_queue.front());
+			m_queue.pop_front();
+			--m_pending;
+			return true;
+		}
+	}
+
+	// steal, starting with the neighbour so that not everybody goes for the same victim
+	const std::size_t start = index >= 0 ? std::size_t(index) + 1 : 0;
+	for (std::size_t i = 0; i < m_workers.size(); ++i) {
+		Worker &victim = *m_workers.at((start + i) % m_workers.size());
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty()) {
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			--m_pending;
+			return true;
+		}
+	}
+	return false;
+}
+
+void Executor::work()
+{
+	while (true) {
+		std::function<void()> job;
+		if (take(job, true)) {
+			job();
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_stopping) {
+			return;
+		}
+		m_condition.wait(lock, [this]() { return m_pending > 0 || m_stopping; });
+	}
+}
+
+void Executor::wait(const std::function<bool()> &done)
+{
+	const bool isWorker = currentWorker() >= 0;
+	const bool isOurs = currentExecutor == this; // workers and spares
+	while (!done()) {
+		// only this thread adds to its own deque, so once empty it stays empty while we sleep
+		std::function<void()> job;
+		if (isWorker && take(job, false)) {
+			job();
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (isOurs) {
+			++m_blocked;
+			compensate();
+		}
+		m_waiting.wait(lock, [this, &lock, &done]()
+		{
+			// done might need locks of its own, a notification in the meantime changes the generation
+			const std::uint64_t generation = m_generation;
+			lock.unlock();
+			const bool result = done();
+			lock.lock();
+			return result || generation != m_generation;
+		});
+		if (isOurs) {
+			--m_blocked;
+		}
+	}
+}
+
+void Executor::compensate()
+{
+	if (m_stopping || m_pending == 0 || m_blocked < m_threads.size() + m_runningSpares) {
+		return;
+	}
+	for (auto it = m_spares.begin(); it != m_spares.end();) {
+		if (it->finished) {
+			it->thread.join();
+			it = m_spares.erase(it);
+		} else {
+			++it;
+		}
+	}
+	++m_runningSpares;
+	m_spares.emplace_back();
+	Spare *spare = &m_spares.back();
+	spare->thread = std::thread([this, spare]() { runSpare(spare); });
+}
+
+void Executor::runSpare(Spare *self)
+{
+	currentExecutor = this;
+	currentIndex = -1;
+	while (true) {
+		std::function<void()> job;
+		if (take(job, true)) {
+			job();
+			continue;
+		}
+		// posting checks for blocked threads under the same lock, so nothing queued gets left behind
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_pending == 0 || m_stopping) {
+			--m_runningSpares;
+			self->finished = true;
+			return;
+		}
+	}
+}
+
+void Executor::notify()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_generation;
+	}
+	m_waiting.notify_all();
+}
+
+}
+}
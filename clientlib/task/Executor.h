@@ -0,0 +1,101 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Ralph {
+namespace ClientLib {
+
+/** Fixed size pool of worker threads with one job deque per worker
+ *
+ * Jobs posted from a worker go to the back of its own deque and are taken from there again (newest
+ * first), idle workers steal the oldest jobs from the other deques. Jobs posted from other threads
+ * go to a shared queue.
+ *
+ * Threads that need to block until something is done use wait(). On a worker it runs the jobs the
+ * worker posted itself in the meantime, so that a job awaiting another job it started does not hold
+ * on to a thread without doing anything. Jobs of others are not run there, as they might be waiting
+ * for something further down the stack of the waiting thread. Should all threads end up blocked
+ * like that while jobs are still queued, a spare thread is started that runs jobs until none are
+ * left, so that the jobs they wait for can not be stuck behind them.
+ */
+class Executor
+{
+public:
+	/// @param threads number of worker threads, 0 means one per core
+	explicit Executor(const std::size_t threads = 0);
+	~Executor();
+
+	/// The executor used by tasks started with std::launch::async
+	static Executor *instance();
+
+	std::size_t threadCount() const { return m_threads.size(); }
+
+	void post(std::function<void()> &&job);
+
+	/// Blocks until done returns true, running jobs posted by the calling thread in the meantime
+	void wait(const std::function<bool()> &done);
+	/// Wakes up all threads blocked in wait(), for when whatever they wait for might be done
+	void notify();
+
+private:
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> jobs;
+	};
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::vector<std::thread> m_threads;
+
+	struct Spare
+	{
+		std::thread thread;
+		bool finished = false;
+	};
+	std::list<Spare> m_spares;
+	std::size_t m_runningSpares = 0;
+	std::size_t m_blocked = 0; // our threads in wait()
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition; // idle workers
+	std::condition_variable m_waiting; // threads in wait()
+	std::deque<std::function<void()>> m_queue;
+	std::atomic<std::size_t> m_pending{0};
+	std::uint64_t m_generation = 0;
+	bool m_stopping = false;
+
+	/// @returns the index of the worker the calling thread is, or -1 if it isn't one of ours
+	int currentWorker() const;
+	/// Takes the newest job of the calling worker, or if steal is set any other job
+	bool take(std::function<void()> &job, const bool steal);
+	void work();
+	/// Starts a spare thread if all of ours are blocked in wait() while jobs are queued, m_mutex has to be held
+	void compensate();
+	void runSpare(Spare *self);
+};
+
+}
+}
@@ -33,7 +33,8 @@ public:
 };
 
 void init();
-Future<void> download(const QUrl &url, const QString &destination);
+/// Consults the download cache of DownloadManager first, see DownloadManager::download
+Future<void> download(const QUrl &url, const QString &destination, const QByteArray &sha256 = QByteArray());
 Future<QByteArray> get(const QUrl &url);
 
 }
@@ -21,6 +21,30 @@
 namespace Ralph {
 namespace ClientLib {
 
+// like QProcess::waitForFinished(-1), but kills the process if the task gets canceled
+static void waitForFinished(QProcess *proc, const Notifier &notifier)
+{
+	// waiting in steps sets the error to QProcess::Timedout, which checkExit ignores
+	while (proc->state() != QProcess::NotRunning) {
+		proc->waitForFinished(100);
+		if (proc->state() != QProcess::NotRunning && notifier.isCanceled()) {
+			proc->kill();
+			proc->waitForFinished(-1);
+			notifier.checkCanceled();
+		}
+	}
+}
+
+// throws if the process could not be started, crashed or exited with an error
+static void checkExit(const QProcess *proc, const QString &executable)
+{
+	if (proc->error() == QProcess::FailedToStart || proc->exitStatus() == QProcess::CrashExit) {
+		throw Exception("%1 failed: %2" % executable % proc->errorString());
+	} else if (proc->exitCode() != 0) {
+		throw Exception("%1 failed with exit code %2" % executable % proc->exitCode());
+	}
+}
+
 Process::Process(const QString &executable)
 	: m_executable(executable)
 {
@@ -45,15 +69,9 @@ Future<void> Process::run() const
 		});
 		procPtr->start(QProcess::ReadOnly);
 		procPtr->waitForStarted();
-		procPtr->waitForFinished(-1);
+		waitForFinished(procPtr, notifier);
 
-		if (procPtr->error() != QProcess::UnknownError) {
-			if (procPtr->exitStatus() == QProcess::CrashExit) {
-				throw Exception("%1 failed with exit code %2" % m_executable % procPtr->exitCode());
-			} else {
-				throw Exception("%1 failed: %2" % m_executable % procPtr->errorString());
-			}
-		}
+		checkExit(procPtr, m_executable);
 	});
 }
 Future<QByteArray> Process::runCaptureOutput() const
@@ -71,15 +89,9 @@ Future<QByteArray> Process::runCaptureOutput() const
 		});
 		procPtr->start(QProcess::ReadOnly);
 		procPtr->waitForStarted();
-		procPtr->waitForFinished(-1);
+		waitForFinished(procPtr, notifier);
 
-		if (procPtr->error() != QProcess::UnknownError) {
-			if (procPtr->exitStatus() == QProcess::CrashExit) {
-				throw Exception("%1 failed with exit code %2" % m_executable % procPtr->exitCode());
-			} else {
-				throw Exception("%1 failed: %2" % m_executable % procPtr->errorString());
-			}
-		}
+		checkExit(procPtr, m_executable);
 
 		return procPtr->readAllStandardOutput();
 	});
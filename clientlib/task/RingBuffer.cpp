@@ -0,0 +1,130 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Ralph {
+namespace ClientLib {
+
+RingBuffer::RingBuffer(const std::size_t capacity)
+	: m_data(capacity)
+{
+	open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+qint64 RingBuffer::bytesAvailable() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return qint64(m_size) + QIODevice::bytesAvailable();
+}
+
+bool RingBuffer::push(const char *data, const std::size_t size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_aborted) {
+		return false;
+	} else if (m_data.size() - m_size < size) {
+		m_wantsSpace = true;
+		return false;
+	}
+
+	const std::size_t end = (m_begin + m_size) % m_data.size();
+	const std::size_t first = std::min(size, m_data.size() - end);
+	std::memcpy(m_data.data() + end, data, first);
+	std::memcpy(m_data.data(), data + first, size - first);
+	m_size += size;
+	m_cond.notify_all();
+	return true;
+}
+
+void RingBuffer::setSpaceCallback(const std::function<void()> &callback)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_spaceCallback = callback;
+}
+
+void RingBuffer::finish(const std::exception_ptr &error)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_finished = true;
+	m_error = error;
+	m_cond.notify_all();
+}
+
+void RingBuffer::abort()
+{
+	std::function<void()> callback;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_aborted = true;
+		callback = m_spaceCallback;
+	}
+	if (callback) {
+		callback();
+	}
+}
+bool RingBuffer::isAborted() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_aborted;
+}
+std::exception_ptr RingBuffer::error() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_error;
+}
+
+qint64 RingBuffer::readData(char *data, qint64 maxSize)
+{
+	std::function<void()> callback;
+	std::size_t size;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cond.wait(lock, [this]() { return m_size > 0 || m_finished; });
+		if (m_size == 0) {
+			// also on errors, readers like KCompressionDevice don't cope with -1. See error()
+			return 0;
+		}
+
+		size = std::min(m_size, std::size_t(maxSize));
+		const std::size_t first = std::min(size, m_data.size() - m_begin);
+		std::memcpy(data, m_data.data() + m_begin, first);
+		std::memcpy(data + first, m_data.data(), size - first);
+		m_begin = (m_begin + size) % m_data.size();
+		m_size -= size;
+
+		if (m_wantsSpace && m_size <= m_data.size() / 2) {
+			m_wantsSpace = false;
+			callback = m_spaceCallback;
+		}
+	}
+	if (callback) {
+		callback();
+	}
+	return qint64(size);
+}
+
+qint64 RingBuffer::writeData(const char *data, qint64 maxSize)
+{
+	Q_UNUSED(data)
+	Q_UNUSED(maxSize)
+	return -1;
+}
+
+}
+}
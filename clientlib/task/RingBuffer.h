@@ -0,0 +1,75 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <QIODevice>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace Ralph {
+namespace ClientLib {
+
+/** Bounded pipe between a producing and a consuming thread
+ *
+ * The producer side never blocks: push() takes everything or nothing, a producer that can't wait
+ * (like the download thread) backs off and tries again once the space callback tells it that the
+ * consumer has made room. The consumer reads through the QIODevice interface, reads block until
+ * data is available or the producer calls finish().
+ */
+class RingBuffer : public QIODevice
+{
+public:
+	explicit RingBuffer(const std::size_t capacity = 4 * 1024 * 1024);
+
+	bool isSequential() const override { return true; }
+	qint64 bytesAvailable() const override;
+
+	// producer
+	/// @returns false if there is not enough space, or if the consumer has aborted
+	bool push(const char *data, const std::size_t size);
+	/// Called from the consumer thread once at least half of the buffer is free after push() failed, or on abort()
+	void setSpaceCallback(const std::function<void()> &callback);
+	/// Marks the end of the data, error is kept for the consumer
+	void finish(const std::exception_ptr &error = nullptr);
+
+	// consumer
+	/// Makes further pushes fail, for when the consumer gives up
+	void abort();
+	bool isAborted() const;
+	std::exception_ptr error() const;
+
+protected:
+	qint64 readData(char *data, qint64 maxSize) override;
+	qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::vector<char> m_data;
+	std::size_t m_begin = 0;
+	std::size_t m_size = 0;
+	bool m_finished = false;
+	bool m_aborted = false;
+	bool m_wantsSpace = false;
+	std::exception_ptr m_error;
+	std::function<void()> m_spaceCallback;
+};
+
+}
+}
@@ -18,9 +18,12 @@
 #include <QFutureInterface>
 #include <QFuture>
 #include <QThreadPool>
+#include <QVector>
+#include <atomic>
 
 #include "Functional.h"
 #include "Exception.h"
+#include "task/Executor.h"
 #include "future/Future.h"
 
 namespace Ralph {
@@ -37,22 +40,41 @@ template <typename T>
 class Task : public std::enable_shared_from_this<Task<T>>
 {
 	std::launch m_policy;
+	Executor *m_executor;
 public:
-	explicit Task(std::launch policy) : m_policy(policy) {}
+	/// std::launch::async runs on the shared executor, anything else goes through std::async
+	explicit Task(std::launch policy)
+		: m_policy(policy), m_executor(policy == std::launch::async ? Executor::instance() : nullptr) {}
+	explicit Task(Executor *executor) : m_policy(std::launch::async), m_executor(executor) {}
 	virtual ~Task() {}
 
 	Future<T> start()
 	{
-		m_promise.prime(std::async(m_policy, [this]()
+		auto job = [this]()
 		{
 			try {
 				m_promise.reportStarted();
+				m_promise.checkCanceled();
 				Private::runAndReportResult(this);
 				m_promise.reportFinished();
 			} catch (...) {
-				m_promise.reportException(std::current_exception());
+				// whatever failed after cancellation was requested most likely failed because of it
+				if (m_promise.isCanceled()) {
+					m_promise.reportCanceled();
+				} else {
+					m_promise.reportException(std::current_exception());
+				}
 			}
-		}));
+		};
+		if (m_executor) {
+			m_promise.schedule(m_executor, [this, job]()
+			{
+				job();
+				m_promise.complete();
+			});
+		} else {
+			m_promise.prime(std::async(m_policy, job));
+		}
 		return future();
 	}
 
@@ -78,10 +100,17 @@ public:
 	template <typename T>
 	explicit Notifier(Task<T> *task)
 		: m_promise(task->m_promise) {}
+	explicit Notifier(const Private::BasePromise &promise)
+		: m_promise(promise) {}
 
 	void status(const QString &status) const { m_promise.reportStatus(status); }
 	void progress(const std::size_t current, const std::size_t total) const { m_promise.reportProgress(current, total); }
 
+	/// Long running tasks should check this regularly and stop early if it is true
+	bool isCanceled() const { return m_promise.isCanceled(); }
+	/// Throws CanceledException if isCanceled
+	void checkCanceled() const { m_promise.checkCanceled(); }
+
 	template <typename T>
 	inline T await(const Future<T> &future) const
 	{
@@ -138,8 +167,10 @@ class LambdaTask : public Task<T>
 {
 	Func m_func;
 public:
-	explicit LambdaTask(std::launch policy, Func &&func) : Task<T>(policy), m_func(std::forward<Func>(func)) {}
-	static std::shared_ptr<LambdaTask<T, Func>> make(std::launch policy, Func &&func)
+	template <typename Policy>
+	explicit LambdaTask(Policy policy, Func &&func) : Task<T>(policy), m_func(std::forward<Func>(func)) {}
+	template <typename Policy>
+	static std::shared_ptr<LambdaTask<T, Func>> make(Policy policy, Func &&func)
 	{
 		std::shared_ptr<LambdaTask<T, Func>> ptr = std::make_shared<LambdaTask<T, Func>>(policy, std::forward<Func>(func));
 		ptr->keepAlive(ptr);
@@ -156,8 +187,10 @@ class LambdaTask<void, Func> : public Task<void>
 {
 	Func m_func;
 public:
-	explicit LambdaTask(std::launch policy, Func &&func) : Task<void>(policy), m_func(std::forward<Func>(func)) {}
-	static std::shared_ptr<LambdaTask<void, Func>> make(std::launch policy, Func &&func)
+	template <typename Policy>
+	explicit LambdaTask(Policy policy, Func &&func) : Task<void>(policy), m_func(std::forward<Func>(func)) {}
+	template <typename Policy>
+	static std::shared_ptr<LambdaTask<void, Func>> make(Policy policy, Func &&func)
 	{
 		std::shared_ptr<LambdaTask<void, Func>> ptr = std::make_shared<LambdaTask<void, Func>>(policy, std::forward<Func>(func));
 		ptr->keepAlive(ptr);
@@ -171,6 +204,12 @@ public:
 };
 }
 
+/** Deferred: func runs on whichever thread first waits for the result
+ *
+ * Most tasks wrap blocking work (git, processes, the file system) and are awaited right where they
+ * are created, so running them inline saves a hand-off and keeps them from occupying the workers of
+ * the shared executor. Work that should run in parallel passes std::launch::async or an executor.
+ */
 template <typename Func, typename Type = typename Common::Functional::FunctionTraits<Func>::ReturnType>
 Future<Type> async(Func &&func)
 {
@@ -181,6 +220,113 @@ Future<Type> async(std::launch policy, Func &&func)
 {
 	return Private::LambdaTask<Type, Func>::make(policy, std::forward<Func>(func))->start();
 }
+/// Runs func as a job of executor once the future is started
+template <typename Func, typename Type = typename Common::Functional::FunctionTraits<Func>::ReturnType>
+Future<Type> async(Executor *executor, Func &&func)
+{
+	return Private::LambdaTask<Type, Func>::make(executor, std::forward<Func>(func))->start();
+}
+
+namespace Private {
+template <typename T>
+QVector<Future<void>> toVoid(const QVector<Future<T>> &futures)
+{
+	QVector<Future<void>> out;
+	out.reserve(futures.size());
+	for (const Future<T> &future : futures) {
+		out.append(future);
+	}
+	return out;
+}
+
+template <typename T, typename Func>
+struct Continuation
+{
+	static auto call(Func &func, Future<T> &future) { return func(future.result()); }
+};
+template <typename Func>
+struct Continuation<void, Func>
+{
+	static auto call(Func &func, Future<void> &future) { future.result(); return func(); }
+};
+}
+
+// the continuation is a task that is held until this future finished, exceptions are passed on without calling func
+template <typename T>
+template <typename Func>
+Future<typename Common::Functional::FunctionTraits<Func>::ReturnType> Future<T>::then(Func &&func, Executor *executor)
+{
+	Future<T> self = *this;
+	auto future = async(executor ? executor : Executor::instance(), [self, func]() mutable
+	{
+		return Private::Continuation<T, std::decay_t<Func>>::call(func, self);
+	});
+	future.hold();
+	onFinished([future]() mutable { future.release(); });
+	return future;
+}
+template <typename Func>
+Future<typename Common::Functional::FunctionTraits<Func>::ReturnType> Future<void>::then(Func &&func, Executor *executor)
+{
+	Future<void> self = *this;
+	auto future = async(executor ? executor : Executor::instance(), [self, func]() mutable
+	{
+		return Private::Continuation<void, std::decay_t<Func>>::call(func, self);
+	});
+	future.hold();
+	onFinished([future]() mutable { future.release(); });
+	return future;
+}
+
+/// @returns a future for the results of all futures, in the same order, or the first exception
+template <typename T>
+std::enable_if_t<!std::is_void<T>::value, Future<QVector<T>>>
+whenAll(const QVector<Future<T>> &futures, Executor *executor = nullptr)
+{
+	auto future = async(executor ? executor : Executor::instance(), [futures]()
+	{
+		QVector<T> results;
+		results.reserve(futures.size());
+		for (Future<T> future : futures) {
+			results.append(future.result());
+		}
+		return results;
+	});
+	future.hold();
+	Private::onAllFinished(Private::toVoid(futures), [future]() mutable { future.release(); });
+	return future;
+}
+inline Future<void> whenAll(const QVector<Future<void>> &futures, Executor *executor = nullptr)
+{
+	auto future = async(executor ? executor : Executor::instance(), [futures]()
+	{
+		for (Future<void> future : futures) {
+			future.result();
+		}
+	});
+	future.hold();
+	Private::onAllFinished(futures, [future]() mutable { future.release(); });
+	return future;
+}
+
+/// @returns a future for the index of the first of futures to finish, or -1 if there are none
+template <typename T>
+Future<int> whenAny(const QVector<Future<T>> &futures, Executor *executor = nullptr)
+{
+	executor = executor ? executor : Executor::instance();
+	if (futures.isEmpty()) {
+		return async(executor, []() { return -1; });
+	}
+	const auto index = std::make_shared<std::atomic<int>>(-1);
+	auto future = async(executor, [index]() { return index->load(); });
+	future.hold();
+	Private::onAnyFinished(Private::toVoid(futures), [index, future](const int i) mutable
+	{
+		*index = i;
+		future.release();
+	});
+	return future;
+}
 
 }
 }
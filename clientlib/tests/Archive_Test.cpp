@@ -0,0 +1,140 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QTest>
+#include <QBuffer>
+#include <QTemporaryDir>
+#include <algorithm>
+
+#include <KArchive/KTar>
+#include <KArchive/KZip>
+
+#include "task/Archive.h"
+#include "task/Decompressor.h"
+
+using namespace Ralph::ClientLib;
+
+class Archive_Test : public QObject
+{
+	Q_OBJECT
+public:
+	virtual ~Archive_Test();
+
+private:
+	QTemporaryDir m_dir;
+
+	QString write(KArchive &&archive)
+	{
+		archive.open(QIODevice::WriteOnly);
+		archive.writeFile("include/lib.h", "#pragma once\n");
+		archive.writeFile("bin/tool", QByteArray(100000, 'x'), 0100755);
+		archive.writeSymLink("include/alias.h", "lib.h");
+		archive.close();
+		return archive.fileName();
+	}
+	void verify(const QDir &dir)
+	{
+		QFile header(dir.filePath("include/lib.h"));
+		QVERIFY(header.open(QFile::ReadOnly));
+		QCOMPARE(header.readAll(), QByteArray("#pragma once\n"));
+		QCOMPARE(QFileInfo(dir.filePath("bin/tool")).size(), qint64(100000));
+		QVERIFY(QFileInfo(dir.filePath("bin/tool")).isExecutable());
+		QCOMPARE(QFileInfo(dir.filePath("include/alias.h")).symLinkTarget(), dir.absoluteFilePath("include/lib.h"));
+	}
+
+	// a plain ustar entry, KTar can't write hard links or entries below a symlink
+	static QByteArray tarEntry(const QByteArray &name, const char type, const QByteArray &link, const QByteArray &data = QByteArray())
+	{
+		QByteArray header(512, '\0');
+		const auto field = [&header](const int offset, const QByteArray &value) { std::copy(value.begin(), value.end(), header.begin() + offset); };
+		field(0, name);
+		field(100, "0000644");
+		field(124, QByteArray::number(data.size(), 8).rightJustified(11, '0'));
+		header[156] = type;
+		field(157, link);
+		field(257, QByteArray("ustar\0" "00", 8));
+		int sum = 0;
+		for (int i = 0; i < header.size(); ++i) {
+			sum += (i >= 148 && i < 156) ? ' ' : uchar(header.at(i));
+		}
+		field(148, QByteArray::number(sum, 8).rightJustified(6, '0') + '\0');
+		return header + data + QByteArray((512 - data.size() % 512) % 512, '\0');
+	}
+
+private slots:
+	void detectsCompressionByContent()
+	{
+		QCOMPARE(Archive::detectCompression("\x1f\x8b\x08\x00"), Archive::Compression::GZip);
+		QCOMPARE(Archive::detectCompression("BZh91AY"), Archive::Compression::BZip2);
+		QCOMPARE(Archive::detectCompression(QByteArray("\xfd" "7zXZ\0", 6)), Archive::Compression::Xz);
+		QCOMPARE(Archive::detectCompression("\x28\xb5\x2f\xfd\x04"), Archive::Compression::Zstd);
+		QCOMPARE(Archive::detectCompression("include/"), Archive::Compression::None);
+	}
+	void extractsTar()
+	{
+		// the name doesn't matter, only the content
+		const QString filename = write(KTar(m_dir.filePath("archive.tar.gz")));
+		QFile::rename(filename, m_dir.filePath("tar.bin"));
+		QTemporaryDir destination;
+		Archive::extract(m_dir.filePath("tar.bin"), destination.path()).result();
+		verify(destination.path());
+	}
+	void refusesToExtractThroughLinks()
+	{
+		const QDir outside(m_dir.filePath("outside"));
+		QVERIFY(outside.mkpath("."));
+		QFile secret(outside.filePath("secret"));
+		QVERIFY(secret.open(QFile::WriteOnly));
+		secret.write("secret");
+		secret.close();
+
+		QFile file(m_dir.filePath("evil.tar"));
+		QVERIFY(file.open(QFile::WriteOnly));
+		file.write(tarEntry("evil", '2', outside.absolutePath().toUtf8()));
+		file.write(tarEntry("evil/written", '0', QByteArray(), "owned"));
+		file.write(tarEntry("leak", '2', secret.fileName().toUtf8()));
+		file.write(tarEntry("copy", '1', "leak"));
+		file.write(QByteArray(1024, '\0'));
+		file.close();
+
+		QTemporaryDir destination;
+		QVERIFY_EXCEPTION_THROWN(Archive::extract(file.fileName(), destination.path()).result(), Exception);
+		QVERIFY(!QFile::exists(outside.filePath("written")));
+		QFile copy(QDir(destination.path()).filePath("copy"));
+		QVERIFY(!copy.open(QFile::ReadOnly) || copy.readAll() != "secret");
+	}
+	void extractsZip()
+	{
+		const QString filename = write(KZip(m_dir.filePath("archive.zip")));
+		QTemporaryDir parallel;
+		Archive::extract(filename, parallel.path(), 4).result();
+		verify(parallel.path());
+
+		QFile file(filename);
+		QVERIFY(file.open(QFile::ReadOnly));
+		QBuffer buffer;
+		buffer.setData(file.readAll());
+		buffer.open(QBuffer::ReadOnly);
+		QTemporaryDir streamed;
+		async([&buffer, &streamed](Notifier notifier) { Archive::extractZip(&buffer, streamed.path(), notifier); }).result();
+		verify(streamed.path());
+	}
+};
+
+Archive_Test::~Archive_Test() {}
+
+QTEST_GUILESS_MAIN(Archive_Test)
+
+#include "Archive_Test.moc"
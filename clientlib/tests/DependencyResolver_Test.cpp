@@ -0,0 +1,123 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QTest>
+
+#include "package/DependencyResolver.h"
+#include "package/Package.h"
+
+using namespace Ralph::ClientLib;
+
+class DependencyResolver_Test : public QObject
+{
+	Q_OBJECT
+public:
+	virtual ~DependencyResolver_Test();
+
+private:
+	QVector<std::shared_ptr<Package>> m_packages;
+
+	void add(const QString &name, const QString &version, const QVector<QPair<QString, QString>> &dependencies = {})
+	{
+		std::shared_ptr<Package> pkg = std::make_shared<Package>();
+		pkg->setName(name);
+		pkg->setVersion(Version::fromString(version));
+		pkg->setDependencies(Ralph::Common::Functional::map(dependencies, [](const QPair<QString, QString> &dep)
+		{
+			PackageDependency dependency(dep.first);
+			if (!dep.second.isEmpty()) {
+				dependency.setVersion(VersionRequirement::fromString(dep.second));
+			}
+			return dependency;
+		}));
+		m_packages.append(pkg);
+	}
+	DependencyResolver resolver()
+	{
+		const QVector<std::shared_ptr<Package>> packages = m_packages;
+		return DependencyResolver([packages](const QString &name)
+		{
+			QVector<const Package *> out;
+			for (const auto &pkg : packages) {
+				if (pkg->name() == name) {
+					out.append(pkg.get());
+				}
+			}
+			return out;
+		});
+	}
+	static QStringList describe(const QVector<const Package *> &packages)
+	{
+		QStringList out;
+		for (const Package *pkg : packages) {
+			out.append(pkg->name() + ' ' + pkg->version().toString());
+		}
+		out.sort();
+		return out;
+	}
+
+private slots:
+	void init()
+	{
+		m_packages.clear();
+	}
+
+	void backtracks()
+	{
+		add("app", "1.0", {{"a", ""}, {"c", ""}});
+		add("a", "2.0", {{"b", ">=2.0"}});
+		add("a", "1.0", {{"b", "<2.0"}});
+		add("b", "2.0");
+		add("b", "1.0");
+		add("c", "1.0", {{"b", "<2.0"}});
+
+		DependencyResolver res = resolver();
+		res.require("app");
+		const QVector<const Package *> result = res.resolve();
+		QCOMPARE(describe(result), QStringList({"a 1.0", "app 1.0", "b 1.0", "c 1.0"}));
+		QCOMPARE(result.last()->name(), QStringLiteral("app"));
+		QVERIFY(res.conflicts() > 0);
+	}
+	void prefersNewest()
+	{
+		add("a", "1.0");
+		add("a", "1.2");
+		add("a", "1.1");
+
+		DependencyResolver res = resolver();
+		res.require("a", VersionRequirement::fromString("<=1.1"));
+		QCOMPARE(describe(res.resolve()), QStringList({"a 1.1"}));
+	}
+	void explainsUnsatisfiable()
+	{
+		add("x", "1.0", {{"y", ">=2.0"}});
+		add("y", "1.0");
+
+		DependencyResolver res = resolver();
+		res.require("x");
+		try {
+			res.resolve();
+			QFAIL("resolve() should have thrown");
+		} catch (UnresolvableException &e) {
+			QVERIFY(e.cause().contains("x 1.0 depends on y >=2.0"));
+		}
+	}
+};
+
+DependencyResolver_Test::~DependencyResolver_Test() {}
+
+QTEST_GUILESS_MAIN(DependencyResolver_Test)
+
+#include "DependencyResolver_Test.moc"
@@ -0,0 +1,105 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QTest>
+#include <QCryptographicHash>
+#include <QTemporaryDir>
+#include <ctime>
+
+#include <utime.h>
+
+#include "task/DownloadCache.h"
+
+using namespace Ralph::ClientLib::Network;
+
+class DownloadCache_Test : public QObject
+{
+	Q_OBJECT
+public:
+	virtual ~DownloadCache_Test();
+
+private:
+	QTemporaryDir m_dir;
+
+	// @returns the hash of the file
+	QByteArray write(const QString &name, const QByteArray &data)
+	{
+		QFile file(m_dir.filePath(name));
+		file.open(QFile::WriteOnly | QFile::Truncate);
+		file.write(data);
+		return QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex();
+	}
+	static void setLastUsed(const QString &filename, const std::time_t lastUsed)
+	{
+		utimbuf times{lastUsed, lastUsed};
+		QCOMPARE(::utime(QFile::encodeName(filename).constData(), &times), 0);
+	}
+
+private slots:
+	void test_insertAndRetrieve()
+	{
+		DownloadCache cache(m_dir.filePath("cache-retrieve"));
+		const QByteArray sha256 = write("a", "content of a");
+		cache.insert(QUrl("http://example.org/a"), m_dir.filePath("a"), DownloadCache::Entry{sha256, "\"etag\"", QByteArray()});
+
+		QVERIFY(cache.contains(sha256));
+		const DownloadCache::Entry entry = cache.entry(QUrl("http://example.org/a"));
+		QCOMPARE(entry.sha256, sha256);
+		QCOMPARE(entry.etag, QByteArray("\"etag\""));
+		QVERIFY(!cache.entry(QUrl("http://example.org/b")).isValid());
+
+		// the copy can be modified without touching the cache
+		QVERIFY(cache.retrieve(sha256, m_dir.filePath("retrieved")));
+		QFile retrieved(m_dir.filePath("retrieved"));
+		QVERIFY(retrieved.open(QFile::ReadWrite));
+		QCOMPARE(retrieved.readAll(), QByteArray("content of a"));
+		retrieved.write("changed");
+		retrieved.close();
+		QVERIFY(cache.contains(sha256));
+		QVERIFY(cache.retrieve(sha256, m_dir.filePath("retrieved")));
+		QCOMPARE(retrieved.open(QFile::ReadOnly) ? retrieved.readAll() : QByteArray(), QByteArray("content of a"));
+
+		QVERIFY(!cache.retrieve(QByteArray(64, '0'), m_dir.filePath("missing")));
+	}
+	void test_evictLeastRecentlyUsed()
+	{
+		DownloadCache cache(m_dir.filePath("cache-evict"), 250);
+		const QByteArray a = write("a", QByteArray(100, 'a'));
+		const QByteArray b = write("b", QByteArray(100, 'b'));
+		const QByteArray c = write("c", QByteArray(100, 'c'));
+		cache.insert(QUrl("http://example.org/a"), m_dir.filePath("a"), DownloadCache::Entry{a, QByteArray(), QByteArray()});
+		cache.insert(QUrl("http://example.org/b"), m_dir.filePath("b"), DownloadCache::Entry{b, QByteArray(), QByteArray()});
+		QVERIFY(cache.contains(a));
+		QVERIFY(cache.contains(b));
+
+		// a was added first, but b was used less recently
+		const std::time_t now = std::time(nullptr);
+		setLastUsed(cache.path(a), now - 200);
+		setLastUsed(cache.path(b), now - 100);
+		QVERIFY(cache.retrieve(a, m_dir.filePath("retrieved-a")));
+
+		cache.insert(QUrl("http://example.org/c"), m_dir.filePath("c"), DownloadCache::Entry{c, QByteArray(), QByteArray()});
+		QVERIFY(cache.contains(a));
+		QVERIFY(!cache.contains(b));
+		QVERIFY(cache.contains(c));
+		QVERIFY(!cache.entry(QUrl("http://example.org/b")).isValid());
+	}
+};
+
+DownloadCache_Test::~DownloadCache_Test() {}
+
+QTEST_GUILESS_MAIN(DownloadCache_Test)
+
+#include "DownloadCache_Test.moc"
@@ -0,0 +1,399 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QTest>
+#include <QCryptographicHash>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include "task/DownloadManager.h"
+#include "task/Network.h"
+
+using namespace Ralph::ClientLib;
+using namespace Ralph::ClientLib::Network;
+
+// serves files over HTTP/1.1 from a thread of its own, one connection at a time, with just enough of ranges and validators
+class TestServer
+{
+public:
+	struct File
+	{
+		QByteArray content;
+		QByteArray etag;
+		QByteArray lastModified;
+	};
+	struct Request
+	{
+		QByteArray method;
+		QByteArray path;
+		QMap<QByteArray, QByteArray> headers; // names in lower case
+		int status = 0; // of the response
+	};
+
+	explicit TestServer()
+	{
+		std::promise<quint16> portPromise;
+		std::future<quint16> portFuture = portPromise.get_future();
+		m_thread = std::thread([this](std::promise<quint16> port)
+		{
+			QTcpServer server;
+			server.listen(QHostAddress::LocalHost);
+			port.set_value(server.serverPort());
+			while (!m_stopping) {
+				if (server.waitForNewConnection(100)) {
+					std::unique_ptr<QTcpSocket> socket(server.nextPendingConnection());
+					socket->setParent(nullptr);
+					handle(socket.get());
+				}
+			}
+		}, std::move(portPromise));
+		m_port = portFuture.get();
+	}
+	~TestServer()
+	{
+		m_stopping = true;
+		m_thread.join();
+	}
+
+	QUrl url(const QString &path) const { return QUrl(QString("http://127.0.0.1:%1/%2").arg(m_port).arg(path)); }
+	void setFile(const QByteArray &path, const File &file)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_files.insert("/" + path, file);
+	}
+	QVector<Request> requests() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_requests;
+	}
+
+private:
+	std::thread m_thread;
+	std::atomic<bool> m_stopping{false};
+	quint16 m_port = 0;
+
+	mutable std::mutex m_mutex;
+	QMap<QByteArray, File> m_files;
+	QVector<Request> m_requests;
+
+	static QByteArray reason(const int status)
+	{
+		switch (status) {
+		case 200: return "OK";
+		case 206: return "Partial Content";
+		case 304: return "Not Modified";
+		case 404: return "Not Found";
+		case 416: return "Range Not Satisfiable";
+		default: return "Unknown";
+		}
+	}
+
+	void handle(QTcpSocket *socket)
+	{
+		QByteArray data;
+		while (!data.contains("\r\n\r\n") && socket->waitForReadyRead(5000)) {
+			data += socket->readAll();
+		}
+		const QList<QByteArray> lines = data.left(data.indexOf("\r\n\r\n")).split('\n');
+		Request request;
+		const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+		request.method = requestLine.value(0);
+		request.path = requestLine.value(1);
+		for (int i = 1; i < lines.size(); ++i) {
+			const int colon = lines.at(i).indexOf(':');
+			if (colon > 0) {
+				request.headers.insert(lines.at(i).left(colon).trimmed().toLower(), lines.at(i).mid(colon + 1).trimmed());
+			}
+		}
+
+		QList<QPair<QByteArray, QByteArray>> headers;
+		QByteArray body;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			request.status = respond(request, headers, body);
+			m_requests.append(request);
+		}
+
+		QByteArray response = "HTTP/1.1 " + QByteArray::number(request.status) + ' ' + reason(request.status) + "\r\n";
+		for (const auto &header : headers) {
+			response += header.first + ": " + header.second + "\r\n";
+		}
+		response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+		response += "Connection: close\r\n\r\n";
+		if (request.method != "HEAD") {
+			response += body;
+		}
+		socket->write(response);
+		while (socket->bytesToWrite() > 0 && socket->waitForBytesWritten(5000)) {}
+		socket->disconnectFromHost();
+		if (socket->state() != QAbstractSocket::UnconnectedState) {
+			socket->waitForDisconnected(5000);
+		}
+	}
+
+	// m_mutex has to be held
+	int respond(const Request &request, QList<QPair<QByteArray, QByteArray>> &headers, QByteArray &body) const
+	{
+		if (!m_files.contains(request.path)) {
+			return 404;
+		}
+		const File file = m_files.value(request.path);
+		headers.append(qMakePair(QByteArray("Accept-Ranges"), QByteArray("bytes")));
+		if (!file.etag.isEmpty()) {
+			headers.append(qMakePair(QByteArray("ETag"), file.etag));
+		}
+		if (!file.lastModified.isEmpty()) {
+			headers.append(qMakePair(QByteArray("Last-Modified"), file.lastModified));
+		}
+
+		if (request.headers.contains("if-none-match") && request.headers.value("if-none-match") == file.etag) {
+			return 304;
+		}
+
+		const QByteArray range = request.headers.value("range");
+		const QByteArray ifRange = request.headers.value("if-range");
+		const bool sameVersion = ifRange.isEmpty() || ifRange == file.etag || ifRange == file.lastModified;
+		if (range.startsWith("bytes=") && sameVersion) {
+			const QList<QByteArray> bounds = range.mid(6).split('-');
+			const int first = bounds.value(0).toInt();
+			const int last = bounds.value(1).isEmpty() ? file.content.size() - 1 : std::min(bounds.value(1).toInt(), file.content.size() - 1);
+			if (first >= file.content.size()) {
+				headers.append(qMakePair(QByteArray("Content-Range"), "bytes */" + QByteArray::number(file.content.size())));
+				return 416;
+			}
+			headers.append(qMakePair(QByteArray("Content-Range"), "bytes " + QByteArray::number(first) + '-' + QByteArray::number(last)
+									 + '/' + QByteArray::number(file.content.size())));
+			body = file.content.mid(first, last - first + 1);
+			return 206;
+		}
+		body = file.content;
+		return 200;
+	}
+};
+
+class DownloadManager_Test : public QObject
+{
+	Q_OBJECT
+public:
+	virtual ~DownloadManager_Test();
+
+private:
+	QTemporaryDir m_dir;
+
+	static QByteArray content(const int size)
+	{
+		QByteArray out;
+		out.reserve(size);
+		for (int i = 0; i < size; ++i) {
+			out.append(char('a' + i % 26));
+		}
+		return out;
+	}
+	static QByteArray sha256(const QByteArray &data) { return QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex(); }
+	static QByteArray read(const QString &filename)
+	{
+		QFile file(filename);
+		return file.open(QFile::ReadOnly) ? file.readAll() : QByteArray();
+	}
+	static void write(const QString &filename, const QByteArray &data)
+	{
+		QFile file(filename);
+		QVERIFY(file.open(QFile::WriteOnly | QFile::Truncate));
+		file.write(data);
+	}
+
+private slots:
+	void initTestCase()
+	{
+		Network::init();
+	}
+
+	void test_download()
+	{
+		TestServer server;
+		const QByteArray data = content(100000);
+		server.setFile("file", TestServer::File{data, "\"v1\"", QByteArray()});
+		const QString destination = m_dir.filePath("download");
+
+		DownloadManager manager;
+		manager.download(server.url("file"), destination, sha256(data)).result();
+		QCOMPARE(read(destination), data);
+		QVERIFY(!QFile::exists(destination + ".part"));
+		QCOMPARE(server.requests().size(), 1);
+		QCOMPARE(server.requests().first().status, 200);
+	}
+	void test_batch()
+	{
+		TestServer server;
+		QVector<QByteArray> contents;
+		QVector<QPair<QUrl, QString>> downloads;
+		for (int i = 0; i < 5; ++i) {
+			contents.append(content(10000 + i));
+			server.setFile("file" + QByteArray::number(i), TestServer::File{contents.last(), QByteArray(), QByteArray()});
+			downloads.append(qMakePair(server.url("file" + QString::number(i)), m_dir.filePath("batch" + QString::number(i))));
+		}
+
+		// more than may run at the same time, so some get queued
+		DownloadManager manager(2);
+		const QVector<Future<void>> futures = manager.download(downloads);
+		for (int i = 0; i < futures.size(); ++i) {
+			Future<void> future = futures.at(i);
+			future.result();
+			QCOMPARE(read(downloads.at(i).second), contents.at(i));
+		}
+
+		QVector<QUrl> urls;
+		for (const auto &download : downloads) {
+			urls.append(download.first);
+		}
+		const QVector<Future<QByteArray>> gets = manager.get(urls);
+		for (int i = 0; i < gets.size(); ++i) {
+			Future<QByteArray> future = gets.at(i);
+			QCOMPARE(future.result(), contents.at(i));
+		}
+		QCOMPARE(server.requests().size(), 10);
+	}
+	void test_resume()
+	{
+		TestServer server;
+		const QByteArray data = content(100000);
+		server.setFile("file", TestServer::File{data, "\"v1\"", QByteArray()});
+		const QString destination = m_dir.filePath("resume");
+
+		// left over by an earlier download that failed half way
+		write(destination + ".part", data.left(40000));
+		write(destination + ".part.validator", "\"v1\"");
+
+		DownloadManager manager;
+		manager.download(server.url("file"), destination, sha256(data)).result();
+		QCOMPARE(read(destination), data);
+		const QVector<TestServer::Request> requests = server.requests();
+		QCOMPARE(requests.size(), 1);
+		QCOMPARE(requests.first().headers.value("range"), QByteArray("bytes=40000-"));
+		QCOMPARE(requests.first().headers.value("if-range"), QByteArray("\"v1\""));
+		QCOMPARE(requests.first().status, 206);
+	}
+	void test_resumeChangedFile()
+	{
+		TestServer server;
+		const QByteArray data = content(100000);
+		server.setFile("file", TestServer::File{data, "\"v2\"", QByteArray()});
+		const QString destination = m_dir.filePath("changed");
+
+		// If-Range doesn't match, so the server sends all of the new version
+		write(destination + ".part", QByteArray(40000, 'x'));
+		write(destination + ".part.validator", "\"v1\"");
+
+		DownloadManager manager;
+		manager.download(server.url("file"), destination, sha256(data)).result();
+		QCOMPARE(read(destination), data);
+		QCOMPARE(server.requests().size(), 1);
+		QCOMPARE(server.requests().first().status, 200);
+	}
+	void test_rangeNotSatisfiable()
+	{
+		TestServer server;
+		const QByteArray data = content(100000);
+		server.setFile("file", TestServer::File{data, "\"v1\"", QByteArray()});
+		const QString destination = m_dir.filePath("416");
+
+		// longer than the file, the server can't continue from there
+		write(destination + ".part", data + data);
+		write(destination + ".part.validator", "\"v1\"");
+
+		DownloadManager manager;
+		manager.download(server.url("file"), destination, sha256(data)).result();
+		QCOMPARE(read(destination), data);
+		const QVector<TestServer::Request> requests = server.requests();
+		QCOMPARE(requests.size(), 2);
+		QCOMPARE(requests.at(0).status, 416);
+		QVERIFY(!requests.at(1).headers.contains("range"));
+		QCOMPARE(requests.at(1).status, 200);
+	}
+	void test_segments()
+	{
+		TestServer server;
+		const QByteArray data = content(100003);
+		server.setFile("file", TestServer::File{data, "\"v1\"", QByteArray()});
+		const QString destination = m_dir.filePath("segmented");
+
+		DownloadManager manager;
+		manager.setSegments(4, 1000);
+		manager.download(server.url("file"), destination, sha256(data)).result();
+		QCOMPARE(read(destination), data);
+		const QVector<TestServer::Request> requests = server.requests();
+		QCOMPARE(requests.size(), 5);
+		QCOMPARE(requests.first().method, QByteArray("HEAD"));
+		for (int i = 1; i < requests.size(); ++i) {
+			QCOMPARE(requests.at(i).status, 206);
+			QCOMPARE(requests.at(i).headers.value("if-range"), QByteArray("\"v1\""));
+		}
+	}
+	void test_revalidate()
+	{
+		TestServer server;
+		const QByteArray data = content(100000);
+		server.setFile("file", TestServer::File{data, "\"v1\"", "Mon, 01 Jan 2024 00:00:00 GMT"});
+		const QString destination = m_dir.filePath("revalidated");
+
+		DownloadManager manager;
+		manager.setCache(std::make_shared<DownloadCache>(m_dir.filePath("cache-revalidate")));
+		manager.download(server.url("file"), destination).result();
+		QFile::remove(destination);
+
+		// not modified, so the content comes out of the cache
+		manager.download(server.url("file"), destination).result();
+		QCOMPARE(read(destination), data);
+		QVector<TestServer::Request> requests = server.requests();
+		QCOMPARE(requests.size(), 2);
+		QCOMPARE(requests.at(1).headers.value("if-none-match"), QByteArray("\"v1\""));
+		QCOMPARE(requests.at(1).headers.value("if-modified-since"), QByteArray("Mon, 01 Jan 2024 00:00:00 GMT"));
+		QCOMPARE(requests.at(1).status, 304);
+
+		// modified, so it is downloaded again
+		const QByteArray newData = content(50000);
+		server.setFile("file", TestServer::File{newData, "\"v2\"", QByteArray()});
+		manager.download(server.url("file"), destination).result();
+		QCOMPARE(read(destination), newData);
+		requests = server.requests();
+		QCOMPARE(requests.size(), 3);
+		QCOMPARE(requests.at(2).status, 200);
+	}
+	void test_checksumMismatch()
+	{
+		TestServer server;
+		const QByteArray data = content(100000);
+		server.setFile("file", TestServer::File{data, "\"v1\"", QByteArray()});
+		const QString destination = m_dir.filePath("mismatch");
+
+		DownloadManager manager;
+		manager.setCache(std::make_shared<DownloadCache>(m_dir.filePath("cache-mismatch")));
+		QVERIFY_EXCEPTION_THROWN(manager.download(server.url("file"), destination, sha256("something else")).result(), NetworkException);
+		QVERIFY(!QFile::exists(destination));
+		QVERIFY(!QFile::exists(destination + ".part"));
+		QVERIFY(!manager.cache()->entry(server.url("file")).isValid());
+	}
+};
+
+DownloadManager_Test::~DownloadManager_Test() {}
+
+QTEST_GUILESS_MAIN(DownloadManager_Test)
+
+#include "DownloadManager_Test.moc"
@@ -21,6 +21,7 @@
 #include "future/Promise.h"
 #include "future/FutureOperators.h"
 #include "task/Task.h"
+#include "task/Executor.h"
 
 using namespace Ralph::ClientLib;
 using namespace std::literals;
@@ -108,6 +109,95 @@ private slots:
 		QCOMPARE(status.at(0), QList<QVariant>() << "asdf");
 		QCOMPARE(status.at(1), QList<QVariant>() << "fdsa");
 	}
+	void executorRunsNestedAwaits()
+	{
+		// with a single worker this only finishes if awaiting runs the queued tasks
+		Executor executor(1);
+		std::function<Future<int>(int)> chain = [&executor, &chain](const int depth)
+		{
+			return async(&executor, [&chain, depth](Notifier notifier)
+			{
+				return depth == 0 ? 0 : 1 + notifier.await(chain(depth - 1));
+			});
+		};
+		QCOMPARE(chain(50).result(), 50);
+	}
+	void executorCompensatesBlockedWorkers()
+	{
+		// the only worker waits for a job queued behind it, which then has to run on a spare thread
+		Executor executor(1);
+		std::atomic<bool> set{false};
+		std::atomic<bool> done{false};
+		executor.post([&executor, &set, &done]()
+		{
+			executor.wait([&set]() { return set.load(); });
+			done = true;
+		});
+		executor.post([&executor, &set]()
+		{
+			set = true;
+			executor.notify();
+		});
+		QTRY_VERIFY(done.load());
+	}
+	void continuations()
+	{
+		QCOMPARE(async(std::launch::async, []() { return 20; }).then([](const int x) { return x + 1; }).then([](const int x) { return x * 2; }).result(), 42);
+		QVERIFY_EXCEPTION_THROWN(async(std::launch::async, []() -> int { throw Exception("failed"); }).then([](const int x) { return x; }).result(), Exception);
+
+		QVector<Future<int>> futures;
+		for (int i = 0; i < 10; ++i) {
+			futures.append(async(std::launch::async, [i]() { return i; }));
+		}
+		QCOMPARE(whenAll(futures).result(), QVector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+		const int any = whenAny(futures).result();
+		QVERIFY(any >= 0 && any < 10);
+		QCOMPARE(whenAny(QVector<Future<int>>()).result(), -1);
+	}
+	void deferredContinuations()
+	{
+		// deferred futures are run by the executor job that waits for them, exactly once
+		std::atomic<int> runs{0};
+		Future<int> deferred = async([&runs]() { ++runs; return 20; });
+		Future<int> doubled = deferred.then([](const int x) { return x * 2; });
+		Future<int> incremented = deferred.then([](const int x) { return x + 1; });
+		QCOMPARE(deferred.result(), 20);
+		QCOMPARE(doubled.result(), 40);
+		QCOMPARE(incremented.result(), 21);
+		QCOMPARE(runs.load(), 1);
+
+		// with a single worker, a continuation of a deferred future must not wait for it from the worker
+		Executor executor(1);
+		QVector<Future<int>> futures;
+		for (int i = 0; i < 10; ++i) {
+			futures.append(async([i]() { return i; }).then([](const int x) { return x; }, &executor));
+		}
+		QCOMPARE(whenAll(futures, &executor).result().size(), 10);
+	}
+	void cancellation()
+	{
+		auto spin = []()
+		{
+			return async(std::launch::async, [](Notifier notifier)
+			{
+				while (true) {
+					notifier.checkCanceled();
+					std::this_thread::yield();
+				}
+			});
+		};
+
+		Future<void> canceled = spin();
+		canceled.start();
+		canceled.cancel();
+		QVERIFY_EXCEPTION_THROWN(canceled.result(), CanceledException);
+
+		// the deadline of the outer task applies to what it awaits
+		Future<void> outer = async(std::launch::async, [spin](Notifier notifier) { notifier.await(spin()); });
+		outer.setTimeout(10ms);
+		QVERIFY_EXCEPTION_THROWN(outer.result(), CanceledException);
+		QVERIFY(outer.isCanceled());
+	}
 	void futureOperators()
 	{
 		QCOMPARE((async([]() { return 42; }) + async([]() { return 2; })).result(), 44);
@@ -0,0 +1,84 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QTest>
+#include <QDataStream>
+
+#include "package/Package.h"
+#include "package/PackageMirror.h"
+#include "package/PackageDependency.h"
+#include "package/steps/InstallationStep.h"
+#include "Requirement.h"
+#include "ActionContext.h"
+#include "Json.h"
+
+using namespace Ralph::ClientLib;
+
+class Package_Test : public QObject
+{
+	Q_OBJECT
+public:
+	virtual ~Package_Test();
+
+private slots:
+	void streamRoundTrip()
+	{
+		const QByteArray json = R"({
+			"name": "RapidJSON",
+			"version": "1.0.2",
+			"paths": { "cmake": "lib/cmake" },
+			"dependencies": [ { "name": "gtest", "version": ">=1.7", "optional": true, "config": { "build.type": "release" } } ],
+			"mirrors": [ { "git": "https://github.com/miloyip/rapidjson.git#v1.0.2", "steps": [ "cmake-config", { "type": "cmake-build", "targets": ["install"] } ],
+						   "requirements": [ { "type": "or", "or": [ { "os": "linux" }, { "type": "buildType", "config": "debug" } ] } ] } ]
+		})";
+		std::unique_ptr<const Package> original(Package::fromJson(Json::ensureDocument(json)));
+
+		QByteArray data;
+		{
+			QDataStream str(&data, QIODevice::WriteOnly);
+			str << *original;
+		}
+		Package copy;
+		{
+			QDataStream str(data);
+			str >> copy;
+			QCOMPARE(str.status(), QDataStream::Ok);
+		}
+
+		QCOMPARE(copy.name(), original->name());
+		QVERIFY(copy.version() == original->version());
+		QCOMPARE(copy.paths(), original->paths());
+
+		QCOMPARE(copy.dependencies().size(), 1);
+		QCOMPARE(copy.dependencies().first().package(), QStringLiteral("gtest"));
+		QCOMPARE(copy.dependencies().first().version().toString(), original->dependencies().first().version().toString());
+		QCOMPARE(copy.dependencies().first().isOptional(), true);
+		QCOMPARE(copy.dependencies().first().config().get(PackageConfiguration::BuildType), QVariant("release"));
+
+		QCOMPARE(copy.mirrors().size(), 1);
+		const PackageMirror mirror = copy.mirrors().first();
+		QCOMPARE(mirror.steps().size(), 3);
+		QCOMPARE(mirror.steps().at(0)->type(), QStringLiteral("git-clone"));
+		QCOMPARE(mirror.steps().at(0)->toJson(), original->mirrors().first().steps().at(0)->toJson());
+		QCOMPARE(mirror.steps().at(2)->toJson(), original->mirrors().first().steps().at(2)->toJson());
+		QCOMPARE(mirror.requirement()->toJson(), original->mirrors().first().requirement()->toJson());
+	}
+};
+
+Package_Test::~Package_Test() {}
+
+QTEST_GUILESS_MAIN(Package_Test)
+
+#include "Package_Test.moc"
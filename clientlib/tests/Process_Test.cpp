@@ -0,0 +1,63 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QTest>
+
+#include "task/Process.h"
+
+using namespace Ralph::ClientLib;
+
+class Process_Test : public QObject
+{
+	Q_OBJECT
+public:
+	virtual ~Process_Test();
+
+private:
+	static Process process(const QString &executable, const QVector<QString> &arguments = {})
+	{
+		Process proc(executable);
+		proc.setArguments(arguments);
+		return proc;
+	}
+
+private slots:
+	void test_run()
+	{
+		process("true").run().result();
+		QVERIFY_EXCEPTION_THROWN(process("false").run().result(), Exception);
+		QVERIFY_EXCEPTION_THROWN(process("ralph-does-not-exist").run().result(), Exception);
+	}
+	void test_longRunning()
+	{
+		// outlives the interval in which cancellation is checked
+		process("sleep", {"1"}).run().result();
+		QCOMPARE(process("sh", {"-c", "sleep 1; echo done"}).runCaptureOutput().result(), QByteArray("done\n"));
+	}
+	void test_cancel()
+	{
+		const Process proc = process("sleep", {"10"});
+		Future<void> future = proc.run();
+		future.start();
+		future.cancel();
+		QVERIFY_EXCEPTION_THROWN(future.result(), CanceledException);
+	}
+};
+
+Process_Test::~Process_Test() {}
+
+QTEST_GUILESS_MAIN(Process_Test)
+
+#include "Process_Test.moc"
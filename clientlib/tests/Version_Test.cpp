@@ -0,0 +1,134 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <QTest>
+#include <algorithm>
+
+#include "Version.h"
+
+using namespace Ralph::ClientLib;
+
+class Version_Test : public QObject
+{
+	Q_OBJECT
+public:
+	virtual ~Version_Test();
+
+private:
+	static Version v(const QString &string) { return Version::fromString(string); }
+
+	// straight forward comparison of the string representation, without any of the shortcuts
+	static int reference(const QString &a, const QString &b)
+	{
+		const QStringList sectionsA = a.split('-');
+		const QStringList sectionsB = b.split('-');
+		for (int i = 0; i < std::max(sectionsA.size(), sectionsB.size()); ++i) {
+			const QStringList segmentsA = i < sectionsA.size() ? sectionsA.at(i).split('.') : QStringList();
+			const QStringList segmentsB = i < sectionsB.size() ? sectionsB.at(i).split('.') : QStringList();
+			for (int j = 0; j < std::max(segmentsA.size(), segmentsB.size()); ++j) {
+				const QString segA = j < segmentsA.size() ? segmentsA.at(j) : QStringLiteral("0");
+				const QString segB = j < segmentsB.size() ? segmentsB.at(j) : QStringLiteral("0");
+				bool intA = false, intB = false;
+				const int numA = segA.toInt(&intA);
+				const int numB = segB.toInt(&intB);
+				if (intA && intB) {
+					if (numA != numB) {
+						return numA < numB ? -1 : 1;
+					}
+				} else if (intA || intB) {
+					return intA ? -1 : 1;
+				} else if (segA != segB) {
+					return segA < segB ? -1 : 1;
+				}
+			}
+		}
+		return 0;
+	}
+
+private slots:
+	void missingSegmentsAreZero()
+	{
+		QVERIFY(v("1.0") == v("1.0.0.0"));
+		QVERIFY(v("1") == v("1.0.0.0.0.0"));
+		QVERIFY(v("1.0-0") == v("1.0"));
+		QVERIFY(v("1.0.0.0.1") > v("1.0"));
+		QVERIFY(v("1.0") != v("1.0.0.1"));
+	}
+	void integersBeforeStrings()
+	{
+		QVERIFY(v("1.0") < v("1.0-a"));
+		QVERIFY(v("1.9") < v("1.a"));
+		QVERIFY(v("1.a") > v("1.65535"));
+		QVERIFY(v("1.alpha") < v("1.beta"));
+		QVERIFY(v("1.rc") < v("1.rc1"));
+		QVERIFY(v("a") > v("99999"));
+	}
+	void moreThanFourSegments()
+	{
+		// the first four segments are equal, so the keys are too
+		QVERIFY(v("1.2.3.4.5") < v("1.2.3.4.6"));
+		QVERIFY(v("1.2.3.4.6") > v("1.2.3.4.5"));
+		QVERIFY(v("1.2.3.4.5") > v("1.2.3.4"));
+		QVERIFY(v("1.2.3.4.5.6.7") == v("1.2.3.4.5.6.7.0"));
+		QVERIFY(v("1.2.3.4.a") > v("1.2.3.4.9"));
+	}
+	void multipleSections()
+	{
+		QVERIFY(v("1.0-2") < v("1.0-10"));
+		QVERIFY(v("1.0-beta") > v("1.0-alpha"));
+		QVERIFY(v("1.0.0.0.1") > v("1.0-5"));
+		QVERIFY(v("1.1-0") > v("1.0-99"));
+		QVERIFY(v("1.0-1.2") == v("1.0.0-1.2.0"));
+		QVERIFY(v("1.0-1-2") > v("1.0-1"));
+		QVERIFY(v("2.0-rc1") < v("2.0-rc2"));
+	}
+	void keyMatchesSlowPath()
+	{
+		// mixes versions that get a key with ones that do not (strings or too large numbers in the first four segments)
+		const QStringList versions = {
+			"0", "1", "1.0", "1.0.0.0", "1.0.0.0.1", "1.2", "1.2.3", "1.2.3.4", "1.2.3.4.5", "1.10",
+			"1.65535", "1.65536", "1.100000", "65535", "65536", "20161231", "1.a", "1.0-a", "1.0-1", "1.0-10",
+			"1.2-rc1", "1.2.0-rc2", "1.2.3-alpha.1", "2.0.0.0-1", "a", "a.1", "3.0.65535.65535", "3.0.65536"
+		};
+		for (const QString &a : versions) {
+			for (const QString &b : versions) {
+				const int expected = reference(a, b);
+				const Version versionA = v(a);
+				const Version versionB = v(b);
+				if ((versionA < versionB) != (expected < 0) || (versionA == versionB) != (expected == 0) || (versionA > versionB) != (expected > 0)) {
+					QFAIL(qPrintable(QStringLiteral("Wrong order of %1 and %2").arg(a, b)));
+				}
+			}
+		}
+	}
+	void packedRoundTrip()
+	{
+		for (const QString &string : {"1.2.3", "1.2.3.4.5-rc1", "beta@2.0-a.b", "1.100000"}) {
+			const Version original = v(string);
+			const Version copy = Version::fromPacked(original.toPacked());
+			QCOMPARE(copy.toString(), original.toString());
+			QCOMPARE(copy.typeString(), original.typeString());
+			QCOMPARE(copy.type(), original.type());
+			QVERIFY(copy == original);
+			QVERIFY(copy < v("999"));
+		}
+	}
+};
+
+Version_Test::~Version_Test() {}
+
+QTEST_GUILESS_MAIN(Version_Test)
+
+#include "Version_Test.moc"
@@ -0,0 +1,15 @@
+# Copyright (C) 2016 Jan Dalheimer <jan@dalheimer.de>
+# This work is free. You can redistribute it and/or modify it under the
+# terms of the Do What The Fuck You Want To Public License, Version 2,
+# as published by Sam Hocevar. See http://www.wtfpl.net/ for more details.
+
+find_package(PkgConfig QUIET)
+pkg_search_module(PC_ZSTD libzstd)
+
+find_path(ZSTD_INCLUDE_DIRS NAMES zstd.h HINTS ${PC_ZSTD_INCLUDEDIR} ${PC_ZSTD_INCLUDE_DIRS})
+find_library(ZSTD_LIBRARIES NAMES zstd HINTS ${PC_ZSTD_LIBDIR} ${PC_ZSTD_LIBRARY_DIRS})
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(Zstd DEFAULT_MSG ZSTD_LIBRARIES ZSTD_INCLUDE_DIRS)
+
+mark_as_advanced(PC_ZSTD_INCLUDEDIR PC_ZSTD_INCLUDE_DIRS PC_ZSTD_LIBDIR PC_ZSTD_LIBRARY_DIRS ZSTD_INCLUDE_DIRS ZSTD_LIBRARIES)
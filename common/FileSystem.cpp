@@ -16,9 +16,23 @@
 #include "FileSystem.h"
 
 #include <QDir>
+#include <QDirIterator>
 #include <QSaveFile>
 #include <QFileInfo>
 
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
 void FS::ensureExists(const QDir &dir)
 {
 	if (!QDir().mkpath(dir.absolutePath()))
@@ -106,19 +120,147 @@ QByteArray FS::read(const QString &filename)
 	return data;
 }
 
-void FS::copy(const QString &from, const QString &to)
+// removes to if it exists, without looking first
+static void removeExisting(const QString &to)
 {
-	FS::ensureExists(QFileInfo(to).dir());
-	if (exists(to))
+#ifdef Q_OS_UNIX
+	if (::unlink(QFile::encodeName(to).constData()) != 0 && errno != ENOENT)
+	{
+		throw FS::FileSystemException("Unable to remove " + to + ": " + QString::fromLocal8Bit(strerror(errno)));
+	}
+#else
+	if (FS::exists(to))
+	{
+		FS::remove(to);
+	}
+#endif
+}
+
+#ifdef Q_OS_LINUX
+// a reflink shares the data until either side is modified, copy_file_range at least avoids the
+// round trip through user space (and reflinks too on some filesystems)
+static bool copyInKernel(const QString &from, const QString &to)
+{
+	const int in = ::open(QFile::encodeName(from).constData(), O_RDONLY | O_CLOEXEC);
+	if (in < 0)
+	{
+		return false;
+	}
+	struct stat info;
+	if (::fstat(in, &info) != 0)
+	{
+		::close(in);
+		return false;
+	}
+	const int out = ::open(QFile::encodeName(to).constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, info.st_mode & 07777);
+	if (out < 0)
+	{
+		::close(in);
+		return false;
+	}
+
+	bool success = false;
+#ifdef FICLONE
+	success = ::ioctl(out, FICLONE, in) == 0;
+#endif
+#ifdef __NR_copy_file_range
+	if (!success)
+	{
+		off_t remaining = info.st_size;
+		while (remaining > 0)
+		{
+			const long copied = ::syscall(__NR_copy_file_range, in, nullptr, out, nullptr, std::size_t(remaining), 0u);
+			if (copied <= 0)
+			{
+				break;
+			}
+			remaining -= copied;
+		}
+		success = remaining == 0;
+	}
+#endif
+	success = success && ::fchmod(out, info.st_mode & 07777) == 0;
+	::close(in);
+	if (::close(out) != 0 || !success)
 	{
-		remove(to);
+		::unlink(QFile::encodeName(to).constData());
+		return false;
 	}
+	return true;
+}
+#endif
+
+// expects the directory of to to exist, and to to not exist
+static void copyFile(const QString &from, const QString &to)
+{
+#ifdef Q_OS_LINUX
+	if (copyInKernel(from, to))
+	{
+		return;
+	}
+#endif
 	QFile file(from);
 	if (!file.copy(to))
 	{
-		throw FileSystemException("Error copying file to " + to + ": " + file.errorString());
+		throw FS::FileSystemException("Error copying file to " + to + ": " + file.errorString());
 	}
 }
+static bool hardLink(const QString &from, const QString &to)
+{
+#ifdef Q_OS_UNIX
+	return ::link(QFile::encodeName(from).constData(), QFile::encodeName(to).constData()) == 0;
+#else
+	Q_UNUSED(from)
+	Q_UNUSED(to)
+	return false;
+#endif
+}
+// the target as stored in the link, not resolved like QFileInfo::symLinkTarget
+static QString symLinkTarget(const QFileInfo &link)
+{
+#ifdef Q_OS_UNIX
+	char buffer[4096];
+	const ssize_t length = ::readlink(QFile::encodeName(link.absoluteFilePath()).constData(), buffer, sizeof(buffer));
+	if (length >= 0 && std::size_t(length) < sizeof(buffer))
+	{
+		return QFile::decodeName(QByteArray(buffer, int(length)));
+	}
+#endif
+	return link.symLinkTarget();
+}
+
+static void transferFile(const QFileInfo &from, const QString &to, const FS::Transfer how)
+{
+	removeExisting(to);
+	if (how == FS::Transfer::Move && QFile::rename(from.absoluteFilePath(), to))
+	{
+		return;
+	}
+
+	if (from.isSymLink())
+	{
+		if (!QFile::link(symLinkTarget(from), to))
+		{
+			throw FS::FileSystemException("Unable to create link " + to);
+		}
+	}
+	else if (how != FS::Transfer::HardLink || !hardLink(from.absoluteFilePath(), to))
+	{
+		copyFile(from.absoluteFilePath(), to);
+	}
+	// renaming only fails across filesystems
+	if (how == FS::Transfer::Move)
+	{
+		FS::remove(from.absoluteFilePath());
+	}
+}
+
+void FS::copy(const QString &from, const QString &to)
+{
+	FS::ensureExists(QFileInfo(to).dir());
+	removeExisting(to);
+	copyFile(from, to);
+}
 void FS::copy(const QString &from, const QDir &to)
 {
 	copy(from, to.absoluteFilePath(QFileInfo(from).fileName()));
@@ -126,8 +268,17 @@ void FS::copy(const QString &from, const QDir &to)
 
 void FS::move(const QString &from, const QString &to)
 {
-	copy(from, to);
-	remove(from);
+	FS::ensureExists(QFileInfo(to).dir());
+	transferFile(QFileInfo(from), to, Transfer::Move);
+}
+void FS::link(const QString &from, const QString &to)
+{
+	FS::ensureExists(QFileInfo(to).dir());
+	removeExisting(to);
+	if (!hardLink(from, to))
+	{
+		copyFile(from, to);
+	}
 }
 
 bool FS::exists(const QString &filename)
@@ -151,25 +302,27 @@ void FS::removeEmptyRecursive(const QDir &dir)
 		remove(dir);
 	}
 }
-void FS::mergeDirectoryInto(const QDir &source, const QDir &destination)
+void FS::mergeDirectoryInto(const QDir &source, const QDir &destination, const Transfer how)
 {
-	// ensure the directory itself exists
-	if (!FS::exists(destination))
-	{
-		FS::ensureExists(destination.absolutePath());
-	}
-	// and then move all the contents
-	for (const QFileInfo &entry :
-		 source.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot))
+	FS::ensureExists(destination);
+	// the iterator takes the type from the directory entry, without a stat for each file
+	QDirIterator it(source.absolutePath(), QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+	while (it.hasNext())
 	{
-		if (entry.isFile())
+		it.next();
+		const QFileInfo entry = it.fileInfo();
+		const QString target = destination.absoluteFilePath(entry.fileName());
+		if (entry.isDir() && !entry.isSymLink())
 		{
-			copy(entry.absoluteFilePath(), destination.absoluteFilePath(entry.fileName()));
+			if (how == Transfer::Move && !exists(target) && QDir().rename(entry.absoluteFilePath(), target))
+			{
+				continue;
+			}
+			mergeDirectoryInto(QDir(entry.absoluteFilePath()), QDir(target), how);
 		}
 		else
 		{
-			mergeDirectoryInto(QDir(entry.absoluteFilePath()),
-							   destination.absoluteFilePath(entry.fileName()));
+			transferFile(entry, target, how);
 		}
 	}
 }
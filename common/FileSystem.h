@@ -27,13 +27,24 @@ namespace FS
 {
 DECLARE_EXCEPTION(FileSystem);
 
+enum class Transfer
+{
+	Copy, // reflinked where the filesystem supports it (btrfs, xfs), which is as cheap as the others
+	HardLink, // shares the data with the source, only for files that are never modified in place
+	Move
+};
+
 void ensureExists(const QDir &dir);
 void remove(const QString &filename);
 void remove(const QDir &dir);
 void remove(const QFileInfo &info);
+/// Reflinks or copies in the kernel where possible, with a plain copy as the fallback
 void copy(const QString &from, const QString &to);
 void copy(const QString &from, const QDir &to);
+/// Renames, or copies and removes if from and to are on different filesystems
 void move(const QString &from, const QString &to);
+/// Hard links, or copies if from and to are on different filesystems
+void link(const QString &from, const QString &to);
 void write(const QString &filename, const QByteArray &data);
 void touch(const QString &filename);
 bool exists(const QString &filename);
@@ -43,5 +54,10 @@ QByteArray read(const QString &filename);
 void chunkedTransfer(QIODevice *from, QIODevice *to);
 
 void removeEmptyRecursive(const QDir &dir);
-void mergeDirectoryInto(const QDir &source, const QDir &destination);
+/** Transfers the content of source into destination, replacing files that exist in both
+ *
+ * Symlinks are recreated instead of followed. Moving renames whole subdirectories that don't
+ * exist in destination yet, and leaves the (then partially empty) source behind.
+ */
+void mergeDirectoryInto(const QDir &source, const QDir &destination, const Transfer how = Transfer::Copy);
 }
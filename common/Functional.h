@@ -19,6 +19,7 @@
 #include "functional/ContainerTraits.h"
 #include "functional/FunctionTraits.h"
 #include "functional/Map.h"
+#include "functional/Parallel.h"
 #include "functional/Filter.h"
 #include "functional/Each.h"
 #include "functional/Tap.h"
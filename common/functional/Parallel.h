@@ -0,0 +1,108 @@
+/* Copyright 2016 Jan Dalheimer <jan@dalheimer.de>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Base.h"
+#include "ContainerTraits.h"
+#include "FunctionTraits.h"
+
+namespace Ralph {
+namespace Common {
+namespace Functional {
+
+/// @returns the number of worker threads to use for threads, where 0 means one per core
+inline std::size_t parallelThreadCount(const std::size_t threads = 0)
+{
+	return threads > 0 ? threads : std::max<std::size_t>(1, std::thread::hardware_concurrency());
+}
+
+/** Like map2, but calls func concurrently from up to parts jobs on executor (0 means one per thread of executor)
+ *
+ * Executor is anything providing post(std::function<void()> &&), wait(const std::function<bool()> &),
+ * notify() and threadCount(), like ClientLib::Executor. The calling thread takes part as well.
+ * The output has the same order as the input, independent of the order in which the calls finish.
+ * If func throws no new calls are started and the first exception is rethrown once all jobs stopped.
+ */
+template <typename OutputContainer, typename InputContainer, typename Func, typename Executor>
+auto parallelMap2(const InputContainer &input, Func &&func, Executor *executor, const std::size_t parts = 0, std::enable_if_t<FunctionTraits<Func>::arity == 1>* = nullptr)
+{
+	static_assert(ContainerTraits<InputContainer>::IsContainer::value, "error: the input is not a container");
+	static_assert(ContainerTraits<OutputContainer>::IsContainer::value, "error: the output is not a container");
+	using InputType = typename ContainerTraits<InputContainer>::IteratorTraits::value_type;
+	using ResultType = std::decay_t<typename FunctionTraits<Func>::ReturnType>;
+
+	std::vector<const InputType *> items;
+	for (const auto &item : input) {
+		items.push_back(&item);
+	}
+	std::vector<ResultType> results(items.size());
+
+	std::atomic<std::size_t> next(0);
+	std::atomic<bool> failed(false);
+	std::exception_ptr exception;
+	std::mutex exceptionMutex;
+	auto worker = [&]()
+	{
+		for (std::size_t i = next++; i < items.size() && !failed; i = next++) {
+			try {
+				results[i] = func(*items[i]);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(exceptionMutex);
+				if (!exception) {
+					exception = std::current_exception();
+				}
+				failed = true;
+			}
+		}
+	};
+
+	const std::size_t jobCount = std::min(parts > 0 ? parts : std::max<std::size_t>(1, executor->threadCount()), items.size());
+	std::atomic<std::size_t> running(jobCount > 0 ? jobCount - 1 : 0);
+	for (std::size_t i = 1; i < jobCount; ++i) {
+		executor->post([&worker, &running, executor]()
+		{
+			worker();
+			// nothing on the stack of the caller may be touched once it sees the last job finish
+			--running;
+			executor->notify();
+		});
+	}
+	worker();
+	executor->wait([&running]() { return running == 0; });
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+
+	OutputContainer output;
+	std::move(results.begin(), results.end(), ContainerTraits<OutputContainer>::InsertionIterator(output));
+	return output;
+}
+template <typename Container, typename Func, typename Executor>
+auto parallelMap(const Container &input, Func &&func, Executor *executor, const std::size_t parts = 0, std::enable_if_t<FunctionTraits<Func>::arity == 1>* = nullptr)
+{
+	using OutputContainer = typename ContainerTraits<Container>::template ContainerType<std::decay_t<typename FunctionTraits<Func>::ReturnType>>;
+	return parallelMap2<OutputContainer, Container, Func, Executor>(input, std::forward<Func>(func), executor, parts);
+}
+}
+}
+}
@@ -15,7 +15,10 @@
 
 #include "Functional.h"
 
+#include <condition_variable>
 #include <functional>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <map>
 #include <set>
@@ -23,6 +26,7 @@
 #include <unordered_set>
 #include <cassert>
 #include <iostream>
+#include <stdexcept>
 
 using namespace Ralph::Common::Functional;
 
@@ -168,6 +172,63 @@ void test_map()
 	std::map<int, string> expectedOut9 = std::map<int, string>(expectedOut8.begin(), expectedOut8.end());
 	assert(out9 == expectedOut9);
 }
+// the least parallelMap needs to run on, every job gets a thread of its own
+class TestExecutor
+{
+public:
+	~TestExecutor()
+	{
+		for (std::thread &thread : m_threads) {
+			thread.join();
+		}
+	}
+
+	std::size_t threadCount() const { return 4; }
+	void post(std::function<void()> &&job) { m_threads.emplace_back(std::move(job)); }
+	void wait(const std::function<bool()> &done)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_condition.wait(lock, done);
+	}
+	void notify()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+		}
+		m_condition.notify_all();
+	}
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::vector<std::thread> m_threads;
+};
+void test_parallelMap()
+{
+	using std::vector;
+
+	TestExecutor executor;
+
+	vector<int> in1(1000);
+	for (std::size_t i = 0; i < in1.size(); ++i) {
+		in1[i] = int(i);
+	}
+
+	// order of the input is kept, no matter how many jobs
+	for (const std::size_t threads : std::initializer_list<std::size_t>{1, 2, 4, 0}) {
+		vector<int> out1 = parallelMap(in1, [](int i) { return i * 2; }, &executor, threads);
+		assert(out1 == map(in1, [](int i) { return i * 2; }));
+	}
+
+	// exceptions are passed on
+	bool caught = false;
+	try {
+		parallelMap(in1, [](int i) { if (i == 500) { throw std::runtime_error("error"); } return i; }, &executor, 4);
+	} catch (std::runtime_error &) {
+		caught = true;
+	}
+	assert(caught);
+}
 void test_filter()
 {
 	using std::vector;
@@ -196,6 +257,7 @@ int main()
 	test_FunctionTraits();
 	test_ContainerTraits();
 	test_map();
+	test_parallelMap();
 	test_filter();
 	test_Collection();
 